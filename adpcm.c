@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include "adpcm.h"
+
+#define ADPCM_STEP_MIN 127
+#define ADPCM_STEP_MAX 24576
+
+static const int adpcm_step_scale[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    230, 230, 230, 230, 307, 409, 512, 614,
+};
+
+static const int adpcm_diff_lookup[16] = {
+    1, 3, 5, 7, 9, 11, 13, 15,
+    -1, -3, -5, -7, -9, -11, -13, -15,
+};
+
+void adpcm_init(adpcm_state_t *state)
+{
+    state->predictor = 0;
+    state->step = ADPCM_STEP_MIN;
+}
+
+static void adpcm_update(adpcm_state_t *state, uint8_t nibble)
+{
+    // Both the encoder and the decoder have to walk the exact same state or
+    // the hardware will drift away from what we encoded against.
+    state->predictor += (state->step * adpcm_diff_lookup[nibble]) / 8;
+    if (state->predictor > 32767)
+    {
+        state->predictor = 32767;
+    }
+    if (state->predictor < -32768)
+    {
+        state->predictor = -32768;
+    }
+
+    state->step = (state->step * adpcm_step_scale[nibble]) >> 8;
+    if (state->step < ADPCM_STEP_MIN)
+    {
+        state->step = ADPCM_STEP_MIN;
+    }
+    if (state->step > ADPCM_STEP_MAX)
+    {
+        state->step = ADPCM_STEP_MAX;
+    }
+}
+
+uint8_t adpcm_encode_sample(adpcm_state_t *state, int16_t sample)
+{
+    int delta = (int)sample - state->predictor;
+    uint8_t nibble = 0;
+
+    if (delta < 0)
+    {
+        nibble = 8;
+        delta = -delta;
+    }
+
+    int magnitude = (delta * 4) / state->step;
+    nibble |= magnitude > 7 ? 7 : magnitude;
+
+    adpcm_update(state, nibble);
+    return nibble;
+}
+
+int16_t adpcm_decode_sample(adpcm_state_t *state, uint8_t nibble)
+{
+    adpcm_update(state, nibble & 0xF);
+    return (int16_t)state->predictor;
+}
+
+unsigned int adpcm_encoded_length(unsigned int num_samples)
+{
+    return (num_samples + 1) / 2;
+}
+
+void adpcm_encode(const int16_t *pcm, unsigned int num_samples, uint8_t *adpcm)
+{
+    adpcm_state_t state;
+    adpcm_init(&state);
+
+    for (unsigned int i = 0; i < num_samples; i += 2)
+    {
+        uint8_t low = adpcm_encode_sample(&state, pcm[i]);
+        uint8_t high = 0;
+
+        if (i + 1 < num_samples)
+        {
+            high = adpcm_encode_sample(&state, pcm[i + 1]);
+        }
+
+        adpcm[i / 2] = low | (high << 4);
+    }
+}
+
+void adpcm_decode(const uint8_t *adpcm, unsigned int num_samples, int16_t *pcm)
+{
+    adpcm_state_t state;
+    adpcm_init(&state);
+
+    for (unsigned int i = 0; i < num_samples; i++)
+    {
+        uint8_t byte = adpcm[i / 2];
+        pcm[i] = adpcm_decode_sample(&state, (i & 1) ? (byte >> 4) : (byte & 0xF));
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef __ADPCM_H
+#define __ADPCM_H
+
+#include <stdint.h>
+
+// Yamaha 4-bit ADPCM, which is what the AICA plays natively when a sound
+// is registered with AUDIO_FORMAT_4BIT. Two samples are packed per byte,
+// low nibble first.
+typedef struct
+{
+    int predictor;
+    int step;
+} adpcm_state_t;
+
+void adpcm_init(adpcm_state_t *state);
+uint8_t adpcm_encode_sample(adpcm_state_t *state, int16_t sample);
+int16_t adpcm_decode_sample(adpcm_state_t *state, uint8_t nibble);
+
+// Number of bytes needed to hold num_samples of encoded audio.
+unsigned int adpcm_encoded_length(unsigned int num_samples);
+
+void adpcm_encode(const int16_t *pcm, unsigned int num_samples, uint8_t *adpcm);
+void adpcm_decode(const uint8_t *adpcm, unsigned int num_samples, int16_t *pcm);
+
+#endif
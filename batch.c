@@ -0,0 +1,850 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "batch.h"
+#include "sim.h"
+
+#define NO_LABEL 0xFF
+
+// What aging leaves in a cell that got old enough to clear. Nothing lives
+// anywhere near this long.
+#define BATCH_EXPIRED 0xFF
+
+// How many boards have to need solving at once before flooding across all of
+// them beats walking each one's chains on its own.
+#define BATCH_FLOOD_LANES 32
+
+// What a chain has run into so far, packed into a byte so it can be flooded
+// along the chain like the labels are. The low bits are the colors every end
+// so far agrees on, starting from all of them.
+#define TOUCH_COLORS 0x07
+#define TOUCH_IMPOSSIBLE 0x08
+#define TOUCH_OPEN 0x10
+#define TOUCH_END 0x20
+#define TOUCH_NOTHING TOUCH_COLORS
+
+static const unsigned int bits[4] = { PIPE_CONN_N, PIPE_CONN_E, PIPE_CONN_S, PIPE_CONN_W };
+static const int offset_x[4] = { 0, 1, 0, -1 };
+static const int offset_y[4] = { -1, 0, 1, 0 };
+
+static void batch_sound(int sound, void *user)
+{
+    // The scratch playfield only ever starts games, which makes no noise.
+}
+
+static uint64_t batch_time(void *user)
+{
+    return 0;
+}
+
+static playfield_platform_t batch_platform = { &batch_sound, &batch_time, 0 };
+
+batch_t *batch_new(unsigned int count)
+{
+    batch_t *batch = malloc(sizeof(batch_t));
+    memset(batch, 0, sizeof(batch_t));
+    batch->count = count;
+
+    batch->block = calloc(BATCH_CELLS * count, 1);
+    batch->pipe = calloc(BATCH_CELLS * count, 1);
+    batch->color = calloc(BATCH_CELLS * count, 1);
+    batch->age = calloc(BATCH_CELLS * count, 1);
+    batch->upnext_block = calloc(UPNEXT_AMOUNT * count, 1);
+    batch->upnext_pipe = calloc(UPNEXT_AMOUNT * count, 1);
+    batch->sounds = calloc(PLAYFIELD_SOUND_COUNT * count, sizeof(uint32_t));
+
+    batch->score = calloc(count, sizeof(int32_t));
+    batch->timeleft = calloc(count, sizeof(float));
+    batch->running = calloc(count, 1);
+    batch->curx = calloc(count, sizeof(int16_t));
+    batch->cury = calloc(count, sizeof(int16_t));
+    batch->upnext_rotation = calloc(count, sizeof(int32_t));
+    batch->seed = calloc(count, sizeof(uint32_t));
+    batch->rng = calloc(count, sizeof(rng_t));
+
+    batch->dirty = calloc(count, 1);
+    batch->changes = calloc(BATCH_CHANGES * count, 1);
+    batch->filled = calloc(count, 1);
+
+    batch->lanes = calloc(count, sizeof(uint32_t));
+    batch->lane_pipe = calloc(BATCH_CELLS * count, 1);
+    batch->link = calloc(BATCH_CELLS * count, 1);
+    batch->label = malloc((BATCH_CELLS + 1) * count);
+    batch->touch = malloc((BATCH_CELLS + 1) * count);
+    batch->activated = calloc(count, 1);
+    batch->wrong = calloc(count, 1);
+    batch->cleared = calloc(count, 1);
+
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        int x = cell % PLAYFIELD_WIDTH;
+        int y = cell / PLAYFIELD_WIDTH;
+
+        batch->source[cell][0] = y == 0 ? (2 * PLAYFIELD_HEIGHT) + PLAYFIELD_WIDTH + x : -1;
+        batch->source[cell][1] = x == PLAYFIELD_WIDTH - 1 ? PLAYFIELD_HEIGHT + y : -1;
+        batch->source[cell][2] = y == PLAYFIELD_HEIGHT - 1 ? (2 * PLAYFIELD_HEIGHT) + x : -1;
+        batch->source[cell][3] = x == 0 ? y : -1;
+
+        for (int direction = 0; direction < 4; direction++)
+        {
+            int neighbor = cell + offset_x[direction] + (offset_y[direction] * PLAYFIELD_WIDTH);
+            batch->neighbor[cell][direction] = batch->source[cell][direction] >= 0 ? BATCH_CELLS : neighbor;
+        }
+    }
+
+    // Borrow the light sources from a real game, so they can't disagree.
+    playfield_rules_t rules;
+    playfield_default_rules(&rules);
+    batch->scratch = playfield_new(&batch_platform, &rules, 0, PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT);
+    playfield_run(batch->scratch, 0);
+    for (int i = 0; i < BATCH_SOURCES; i++)
+    {
+        batch->sources[i] = batch->scratch->sources[i].color;
+    }
+
+    return batch;
+}
+
+void batch_free(batch_t *batch)
+{
+    free(batch->block);
+    free(batch->pipe);
+    free(batch->color);
+    free(batch->age);
+    free(batch->upnext_block);
+    free(batch->upnext_pipe);
+    free(batch->sounds);
+    free(batch->score);
+    free(batch->timeleft);
+    free(batch->running);
+    free(batch->curx);
+    free(batch->cury);
+    free(batch->upnext_rotation);
+    free(batch->seed);
+    free(batch->rng);
+    free(batch->dirty);
+    free(batch->changes);
+    free(batch->filled);
+    free(batch->lanes);
+    free(batch->lane_pipe);
+    free(batch->link);
+    free(batch->label);
+    free(batch->touch);
+    free(batch->activated);
+    free(batch->wrong);
+    free(batch->cleared);
+    playfield_free(batch->scratch);
+    free(batch);
+}
+
+void batch_run(batch_t *batch, unsigned int board, uint32_t seed)
+{
+    // Let the real engine start the game, then take it over.
+    playfield_run(batch->scratch, seed);
+    batch_import(batch, board, batch->scratch);
+}
+
+void batch_export(batch_t *batch, unsigned int board, playfield_t *playfield)
+{
+    unsigned int count = batch->count;
+
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        playfield_entry_t *entry = playfield->entries + cell;
+        entry->block = batch->block[(cell * count) + board];
+        entry->pipe = batch->pipe[(cell * count) + board];
+        entry->color = batch->color[(cell * count) + board];
+        entry->age = batch->age[(cell * count) + board];
+    }
+    for (int slot = 0; slot < UPNEXT_AMOUNT; slot++)
+    {
+        memset(&playfield->upnext[slot], 0, sizeof(playfield_entry_t));
+        playfield->upnext[slot].block = batch->upnext_block[(slot * count) + board];
+        playfield->upnext[slot].pipe = batch->upnext_pipe[(slot * count) + board];
+    }
+
+    playfield->score = batch->score[board];
+    playfield->timeleft = batch->timeleft[board];
+    playfield->running = batch->running[board];
+    playfield->curx = batch->curx[board];
+    playfield->cury = batch->cury[board];
+    playfield->upnext_rotation = batch->upnext_rotation[board];
+    playfield->seed = batch->seed[board];
+    memcpy(&playfield->rng, &batch->rng[board], sizeof(rng_t));
+    playfield_rehash(playfield);
+}
+
+void batch_import(batch_t *batch, unsigned int board, playfield_t *playfield)
+{
+    unsigned int count = batch->count;
+
+    batch->filled[board] = 0;
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        playfield_entry_t *entry = playfield->entries + cell;
+        batch->filled[board] += entry->block != BLOCK_TYPE_NONE;
+        batch->block[(cell * count) + board] = entry->block;
+        batch->pipe[(cell * count) + board] = entry->pipe;
+        batch->color[(cell * count) + board] = entry->color;
+        batch->age[(cell * count) + board] = entry->age;
+    }
+    for (int slot = 0; slot < UPNEXT_AMOUNT; slot++)
+    {
+        batch->upnext_block[(slot * count) + board] = playfield->upnext[slot].block;
+        batch->upnext_pipe[(slot * count) + board] = playfield->upnext[slot].pipe;
+    }
+
+    batch->score[board] = playfield->score;
+    batch->timeleft[board] = playfield->timeleft;
+    batch->running[board] = playfield->running;
+    batch->curx[board] = playfield->curx;
+    batch->cury[board] = playfield->cury;
+    batch->upnext_rotation[board] = playfield->upnext_rotation;
+    batch->seed[board] = playfield->seed;
+    memcpy(&batch->rng[board], &playfield->rng, sizeof(rng_t));
+    batch->dirty[board] = BATCH_CHANGES + 1;
+}
+
+static void batch_change(batch_t *batch, unsigned int board, int cell)
+{
+    // Remember where a block was placed or cleared, so the next solve only
+    // has to look at the chains around it.
+    uint8_t changed = batch->dirty[board];
+    if (changed < BATCH_CHANGES)
+    {
+        batch->changes[(changed * batch->count) + board] = cell;
+    }
+    if (changed <= BATCH_CHANGES)
+    {
+        batch->dirty[board] = changed + 1;
+    }
+}
+
+static void batch_generate_upnext(batch_t *batch, unsigned int board)
+{
+    // Has to draw exactly what playfield_generate_upnext() would.
+    unsigned int count = batch->count;
+    rng_t *rng = &batch->rng[board];
+
+    for (int slot = 0; slot < UPNEXT_AMOUNT; slot++)
+    {
+        if (batch->upnext_block[(slot * count) + board] == BLOCK_TYPE_NONE)
+        {
+            int color = rng_range(rng, 4) + BLOCK_TYPE_PURPLE;
+            int corner = rng_range(rng, 4) + batch->upnext_rotation[board];
+            int second = rng_range(rng, 2);
+
+            batch->upnext_block[(slot * count) + board] = color;
+            batch->upnext_pipe[(slot * count) + board] = bits[corner % 4] | bits[(corner + (second > 0 ? 2 : 1)) % 4];
+            batch->upnext_rotation[board]++;
+        }
+    }
+
+    batch->timeleft[board] = PLACE_TIME;
+}
+
+static void batch_place(batch_t *batch, unsigned int board, int cell)
+{
+    unsigned int count = batch->count;
+    unsigned int at = (cell * count) + board;
+
+    batch->block[at] = batch->upnext_block[board];
+    batch->pipe[at] = batch->upnext_pipe[board];
+    batch->color[at] = SOURCE_COLOR_NONE;
+    batch->age[at] = 0;
+    batch->sounds[(PLAYFIELD_SOUND_DROP * count) + board]++;
+    batch->filled[board]++;
+    batch_change(batch, board, cell);
+
+    for (int slot = 0; slot < UPNEXT_AMOUNT - 1; slot++)
+    {
+        batch->upnext_block[(slot * count) + board] = batch->upnext_block[((slot + 1) * count) + board];
+        batch->upnext_pipe[(slot * count) + board] = batch->upnext_pipe[((slot + 1) * count) + board];
+    }
+    batch->upnext_block[((UPNEXT_AMOUNT - 1) * count) + board] = BLOCK_TYPE_NONE;
+    batch->upnext_pipe[((UPNEXT_AMOUNT - 1) * count) + board] = PIPE_CONN_NONE;
+    batch_generate_upnext(batch, board);
+}
+
+static int batch_cursor_drop(batch_t *batch, unsigned int board)
+{
+    int cell = (batch->cury[board] * PLAYFIELD_WIDTH) + batch->curx[board];
+
+    if (batch->block[(cell * batch->count) + board] == BLOCK_TYPE_NONE && batch->upnext_block[board] != BLOCK_TYPE_NONE)
+    {
+        batch_place(batch, board, cell);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void batch_drop_anywhere(batch_t *batch, unsigned int board)
+{
+    // Same as playfield_drop_anywhere().
+    unsigned int count = batch->count;
+
+    if (batch->timeleft[board] <= 0.0 && batch->upnext_block[board] != BLOCK_TYPE_NONE)
+    {
+        if (batch_cursor_drop(batch, board))
+        {
+            return;
+        }
+
+        int available = BATCH_CELLS - batch->filled[board];
+        if (available)
+        {
+            int location = rng_range(&batch->rng[board], available);
+            for (int cell = 0; cell < BATCH_CELLS; cell++)
+            {
+                if (batch->block[(cell * count) + board] == BLOCK_TYPE_NONE)
+                {
+                    if (location == 0)
+                    {
+                        batch_place(batch, board, cell);
+                        break;
+                    }
+                    location--;
+                }
+            }
+        }
+    }
+}
+
+static inline uint8_t batch_combine(uint8_t touch, uint8_t other)
+{
+    // How playfield_combine_color() merges what's at either end of a pipe,
+    // without any branches so it vectorizes. Two colors can only share a
+    // chain when one is all of the other, and a chain only ever has two
+    // ends, so the order things get merged in doesn't matter.
+    uint8_t mine = touch & TOUCH_COLORS;
+    uint8_t theirs = other & TOUCH_COLORS;
+    uint8_t both = mine & theirs;
+    uint8_t clash = (both != mine) & (both != theirs);
+
+    return both | ((touch | other) & ~TOUCH_COLORS) | (clash * TOUCH_IMPOSSIBLE);
+}
+
+static void batch_flood(batch_t *batch, unsigned int used)
+{
+    // Gets what every chain touched for every lane at once by labeling every
+    // chain, working out what's past each loose end and flooding that along
+    // the chain too. Everything walks across lanes with no branches, so it
+    // vectorizes, but every pass costs the same however few lanes there are.
+    uint8_t *pipe = batch->lane_pipe;
+    uint8_t *link = batch->link;
+    uint8_t *label = batch->label;
+    uint8_t *touch = batch->touch;
+
+    // The spare planes past the last cell are where every edge cell's
+    // neighbor off the board points, and nothing is ever in them. Where
+    // they are depends on how many lanes there are.
+    memset(label + (BATCH_CELLS * used), NO_LABEL, used);
+    memset(touch + (BATCH_CELLS * used), TOUCH_NOTHING, used);
+
+    // Which ends of every pipe connect to the neighboring pipe. Swapping the
+    // halves of a pipe turns north into south and east into west, so it
+    // connects back wherever that lines up with this pipe.
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        uint8_t *here = link + (cell * used);
+        uint8_t *mine = pipe + (cell * used);
+
+        memset(here, 0, used);
+        for (int direction = 0; direction < 4; direction++)
+        {
+            if (batch->source[cell][direction] >= 0)
+            {
+                continue;
+            }
+
+            uint8_t *theirs = pipe + (batch->neighbor[cell][direction] * used);
+            uint8_t bit = bits[direction];
+            for (unsigned int lane = 0; lane < used; lane++)
+            {
+                uint8_t back = ((theirs[lane] << 2) | (theirs[lane] >> 2)) & 0x0F;
+                here[lane] |= mine[lane] & back & bit;
+            }
+        }
+    }
+
+    // Flood the lowest cell number along every chain.
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        uint8_t *here = label + (cell * used);
+        uint8_t *mine = pipe + (cell * used);
+        for (unsigned int lane = 0; lane < used; lane++)
+        {
+            here[lane] = mine[lane] ? cell : NO_LABEL;
+        }
+    }
+
+    uint8_t changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int step = 0; step < BATCH_CELLS; step++)
+            {
+                // Sweep forwards and then backwards, so long chains settle
+                // in a couple of passes no matter which way they run.
+                int cell = pass == 0 ? step : BATCH_CELLS - 1 - step;
+                uint8_t *here = label + (cell * used);
+                uint8_t *links = link + (cell * used);
+
+                // Off the edge points at the spare plane, which never has a
+                // link to it anyway.
+                const uint8_t *north = label + (batch->neighbor[cell][0] * used);
+                const uint8_t *east = label + (batch->neighbor[cell][1] * used);
+                const uint8_t *south = label + (batch->neighbor[cell][2] * used);
+                const uint8_t *west = label + (batch->neighbor[cell][3] * used);
+
+                for (unsigned int lane = 0; lane < used; lane++)
+                {
+                    uint8_t linked = links[lane];
+                    uint8_t lowest = here[lane];
+                    uint8_t n = north[lane] | ((linked & PIPE_CONN_N) ? 0 : NO_LABEL);
+                    uint8_t e = east[lane] | ((linked & PIPE_CONN_E) ? 0 : NO_LABEL);
+                    uint8_t s = south[lane] | ((linked & PIPE_CONN_S) ? 0 : NO_LABEL);
+                    uint8_t w = west[lane] | ((linked & PIPE_CONN_W) ? 0 : NO_LABEL);
+
+                    lowest = n < lowest ? n : lowest;
+                    lowest = e < lowest ? e : lowest;
+                    lowest = s < lowest ? s : lowest;
+                    lowest = w < lowest ? w : lowest;
+                    changed |= lowest ^ here[lane];
+                    here[lane] = lowest;
+                }
+            }
+        }
+    }
+
+    // Work out what's past every loose end of every block.
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        uint8_t *mine = pipe + (cell * used);
+        uint8_t *links = link + (cell * used);
+        uint8_t *here = label + (cell * used);
+        uint8_t *touches = touch + (cell * used);
+
+        memset(touches, TOUCH_NOTHING, used);
+        for (int direction = 0; direction < 4; direction++)
+        {
+            int source = batch->source[cell][direction];
+            uint8_t bit = bits[direction];
+            if (source >= 0)
+            {
+                // Runs off the edge, which is only any good if there's a
+                // light there.
+                uint8_t color = batch->sources[source];
+                uint8_t end = color ? (color | TOUCH_END) : (TOUCH_NOTHING | TOUCH_IMPOSSIBLE | TOUCH_END);
+                for (unsigned int lane = 0; lane < used; lane++)
+                {
+                    uint8_t loose = (mine[lane] & bit) ? end : TOUCH_NOTHING;
+                    touches[lane] = batch_combine(touches[lane], loose);
+                }
+            }
+            else
+            {
+                // Runs into an empty cell or a pipe that doesn't connect
+                // back, which could still be fixed unless that pipe is part
+                // of this very chain.
+                uint8_t *there = label + (batch->neighbor[cell][direction] * used);
+                for (unsigned int lane = 0; lane < used; lane++)
+                {
+                    uint8_t end = there[lane] == here[lane] ? TOUCH_IMPOSSIBLE : TOUCH_OPEN;
+                    uint8_t loose = ((mine[lane] & bit) & ~links[lane]) ? (end | TOUCH_NOTHING | TOUCH_END) : TOUCH_NOTHING;
+                    touches[lane] = batch_combine(touches[lane], loose);
+                }
+            }
+        }
+    }
+
+    // And spread that along every chain the same way the labels went.
+    changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int step = 0; step < BATCH_CELLS; step++)
+            {
+                int cell = pass == 0 ? step : BATCH_CELLS - 1 - step;
+                uint8_t *here = touch + (cell * used);
+                uint8_t *links = link + (cell * used);
+
+                const uint8_t *north = touch + (batch->neighbor[cell][0] * used);
+                const uint8_t *east = touch + (batch->neighbor[cell][1] * used);
+                const uint8_t *south = touch + (batch->neighbor[cell][2] * used);
+                const uint8_t *west = touch + (batch->neighbor[cell][3] * used);
+
+                for (unsigned int lane = 0; lane < used; lane++)
+                {
+                    // Read every neighbor whether it's linked or not, since
+                    // a branch here would stop this from vectorizing.
+                    uint8_t linked = links[lane];
+                    uint8_t merged = here[lane];
+                    uint8_t n = north[lane];
+                    uint8_t e = east[lane];
+                    uint8_t s = south[lane];
+                    uint8_t w = west[lane];
+
+                    merged = batch_combine(merged, (linked & PIPE_CONN_N) ? n : TOUCH_NOTHING);
+                    merged = batch_combine(merged, (linked & PIPE_CONN_E) ? e : TOUCH_NOTHING);
+                    merged = batch_combine(merged, (linked & PIPE_CONN_S) ? s : TOUCH_NOTHING);
+                    merged = batch_combine(merged, (linked & PIPE_CONN_W) ? w : TOUCH_NOTHING);
+                    changed |= merged ^ here[lane];
+                    here[lane] = merged;
+                }
+            }
+        }
+    }
+}
+
+static inline uint8_t batch_result(uint8_t touched)
+{
+    // A chain with no loose ends loops back on itself, and one with an open
+    // end is lit by nothing yet. Otherwise both ends are lights, which agree
+    // on the colors left over.
+    uint8_t impossible = !(touched & TOUCH_END) || (touched & TOUCH_IMPOSSIBLE);
+    uint8_t lit = impossible || (touched & TOUCH_OPEN) ? SOURCE_COLOR_NONE : touched & TOUCH_COLORS;
+    return impossible ? SOURCE_COLOR_IMPOSSIBLE : lit;
+}
+
+static uint8_t batch_links(batch_t *batch, unsigned int board, int cell)
+{
+    // Which ends of one pipe connect to the neighboring pipe, same as the
+    // flood works out for every cell at once.
+    unsigned int count = batch->count;
+    uint8_t mine = batch->pipe[(cell * count) + board];
+    uint8_t links = 0;
+
+    for (int direction = 0; direction < 4; direction++)
+    {
+        if (batch->source[cell][direction] < 0)
+        {
+            uint8_t theirs = batch->pipe[(batch->neighbor[cell][direction] * count) + board];
+            uint8_t back = ((theirs << 2) | (theirs >> 2)) & 0x0F;
+            links |= mine & back & bits[direction];
+        }
+    }
+
+    return links;
+}
+
+static void batch_walk(batch_t *batch, unsigned int board)
+{
+    // The same answer as flooding, for one board, by walking only the chains
+    // that run through or end next to something that was placed or cleared,
+    // just like playfield_solve_dirty() does. Nothing else on the board can
+    // have changed color, so this costs about as much as the scalar engine
+    // no matter how many other boards there are.
+    unsigned int count = batch->count;
+    uint8_t *pipe = batch->pipe;
+    uint8_t *color = batch->color;
+    uint8_t *age = batch->age;
+    uint8_t wanted[BATCH_CELLS];
+    uint8_t seen[BATCH_CELLS];
+    uint8_t links[BATCH_CELLS];
+    uint8_t chain[BATCH_CELLS];
+    uint8_t activated = 0;
+    uint8_t wrong = 0;
+    uint8_t stamp = 0;
+
+    uint8_t changed = batch->dirty[board];
+    memset(wanted, changed > BATCH_CHANGES, sizeof(wanted));
+    memset(seen, 0, sizeof(seen));
+    for (int change = 0; change < changed && change < BATCH_CHANGES; change++)
+    {
+        int cell = batch->changes[(change * count) + board];
+        wanted[cell] = 1;
+        for (int direction = 0; direction < 4; direction++)
+        {
+            if (batch->source[cell][direction] < 0)
+            {
+                wanted[batch->neighbor[cell][direction]] = 1;
+            }
+        }
+    }
+    batch->dirty[board] = 0;
+
+    for (int start = 0; start < BATCH_CELLS; start++)
+    {
+        if (!wanted[start] || seen[start] || !pipe[(start * count) + board])
+        {
+            continue;
+        }
+
+        // Every block has two ends, so following whichever link doesn't go
+        // back where we came from walks the whole chain. One that doesn't
+        // loop needs walking both ways from where we started.
+        int length = 0;
+        stamp++;
+        seen[start] = stamp;
+        links[start] = batch_links(batch, board, start);
+        chain[length++] = start;
+
+        uint8_t ways = links[start];
+        while (ways)
+        {
+            uint8_t way = ways & -ways;
+            ways &= ~way;
+
+            int at = start;
+            while (1)
+            {
+                int next = batch->neighbor[at][__builtin_ctz(way)];
+                if (seen[next])
+                {
+                    break;
+                }
+                seen[next] = stamp;
+                links[next] = batch_links(batch, board, next);
+                chain[length++] = next;
+
+                uint8_t back = ((way << 2) | (way >> 2)) & 0x0F;
+                way = links[next] & ~back;
+                if (!way)
+                {
+                    break;
+                }
+                at = next;
+            }
+        }
+
+        // Merge what's past every loose end, the same way as the flood works
+        // it out.
+        uint8_t touched = TOUCH_NOTHING;
+        for (int i = 0; i < length; i++)
+        {
+            int cell = chain[i];
+            uint8_t loose = pipe[(cell * count) + board] & ~links[cell];
+            while (loose)
+            {
+                uint8_t bit = loose & -loose;
+                loose &= ~bit;
+
+                int direction = __builtin_ctz(bit);
+                int source = batch->source[cell][direction];
+                if (source >= 0)
+                {
+                    uint8_t light = batch->sources[source];
+                    touched = batch_combine(touched, light ? (light | TOUCH_END) : (TOUCH_NOTHING | TOUCH_IMPOSSIBLE | TOUCH_END));
+                }
+                else
+                {
+                    uint8_t self = seen[batch->neighbor[cell][direction]] == stamp;
+                    touched = batch_combine(touched, (self ? TOUCH_IMPOSSIBLE : TOUCH_OPEN) | TOUCH_NOTHING | TOUCH_END);
+                }
+            }
+        }
+
+        uint8_t result = batch_result(touched);
+        for (int i = 0; i < length; i++)
+        {
+            unsigned int at = (chain[i] * count) + board;
+            if (result != color[at])
+            {
+                age[at] = 0;
+                wrong |= result == SOURCE_COLOR_IMPOSSIBLE;
+                activated |= result != SOURCE_COLOR_IMPOSSIBLE && result != SOURCE_COLOR_NONE;
+                color[at] = result;
+            }
+        }
+    }
+
+    batch->sounds[(PLAYFIELD_SOUND_ACTIVATE * count) + board] += activated;
+    batch->sounds[(PLAYFIELD_SOUND_BAD * count) + board] += wrong;
+}
+
+void batch_solve(batch_t *batch)
+{
+    // Every block is a pipe with two ends, so blocks that connect to each
+    // other form chains that either loop or have exactly two loose ends.
+    // playfield_check_connections() walks these one at a time, lighting any
+    // chain that runs between two sources that agree on color and marking
+    // impossible any chain that loops, runs off the edge somewhere without a
+    // source, dead ends into itself, or joins sources that can never agree.
+    // Here we work out what every chain touched on every board that needs
+    // it and then color every block by that.
+    unsigned int count = batch->count;
+    uint32_t *lanes = batch->lanes;
+    uint8_t *pipe = batch->lane_pipe;
+    uint8_t *touch = batch->touch;
+
+    // A board that nothing was placed on or cleared from since last time
+    // would come out exactly the same, and most steps that's nearly all of
+    // them. When only a few boards changed, walking their chains beats
+    // flooding, which costs the same for a handful of lanes as for a full
+    // vector of them.
+    unsigned int used = 0;
+    for (unsigned int board = 0; board < count; board++)
+    {
+        if (batch->dirty[board])
+        {
+            lanes[used++] = board;
+        }
+    }
+    if (used < BATCH_FLOOD_LANES)
+    {
+        for (unsigned int lane = 0; lane < used; lane++)
+        {
+            batch_walk(batch, lanes[lane]);
+        }
+        return;
+    }
+
+    // Otherwise they're packed side by side into lanes and flooded together.
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        uint8_t *from = batch->pipe + (cell * count);
+        uint8_t *to = pipe + (cell * used);
+        for (unsigned int lane = 0; lane < used; lane++)
+        {
+            to[lane] = from[lanes[lane]];
+        }
+    }
+    for (unsigned int lane = 0; lane < used; lane++)
+    {
+        batch->dirty[lanes[lane]] = 0;
+    }
+    batch_flood(batch, used);
+
+    // Color every block by its chain, and reset the age of anything that
+    // changed just like playfield_check_connections() does.
+    memset(batch->activated, 0, used);
+    memset(batch->wrong, 0, used);
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        uint8_t *mine = pipe + (cell * used);
+        uint8_t *color = batch->color + (cell * count);
+        uint8_t *age = batch->age + (cell * count);
+        uint8_t *touches = touch + (cell * used);
+
+        for (unsigned int lane = 0; lane < used; lane++)
+        {
+            unsigned int board = lanes[lane];
+            uint8_t result = mine[lane] ? batch_result(touches[lane]) : SOURCE_COLOR_NONE;
+
+            uint8_t different = result != color[board];
+            age[board] = different ? 0 : age[board];
+            batch->wrong[lane] |= different & (result == SOURCE_COLOR_IMPOSSIBLE);
+            batch->activated[lane] |= different & (result != SOURCE_COLOR_IMPOSSIBLE) & (result != SOURCE_COLOR_NONE);
+            color[board] = result;
+        }
+    }
+
+    for (unsigned int lane = 0; lane < used; lane++)
+    {
+        unsigned int board = lanes[lane];
+        batch->sounds[(PLAYFIELD_SOUND_ACTIVATE * count) + board] += batch->activated[lane];
+        batch->sounds[(PLAYFIELD_SOUND_BAD * count) + board] += batch->wrong[lane];
+    }
+}
+
+static void batch_age(batch_t *batch)
+{
+    // Same as the first half of playfield_age(), for every running board.
+    // Aging walks across boards with no branches, marking anything old enough
+    // to clear with an age nothing else can have, and only the rare plane
+    // where something got marked goes back to clear it.
+    static const int mult[8] = {0, 1, 1, 2, 1, 2, 2, 4};
+    unsigned int count = batch->count;
+    uint8_t *running = batch->running;
+
+    memset(batch->cleared, 0, count);
+    for (int cell = 0; cell < BATCH_CELLS; cell++)
+    {
+        uint8_t *block = batch->block + (cell * count);
+        uint8_t *pipe = batch->pipe + (cell * count);
+        uint8_t *color = batch->color + (cell * count);
+        uint8_t *age = batch->age + (cell * count);
+
+        // Only blocks ever get colored, so there's no need to look at them.
+        uint8_t any = 0;
+        for (unsigned int board = 0; board < count; board++)
+        {
+            uint8_t lit = running[board] & (color[board] != SOURCE_COLOR_NONE);
+            uint8_t old = lit & (age[board] > MAX_AGE);
+            age[board] = old ? BATCH_EXPIRED : age[board] + lit;
+            any |= old;
+        }
+
+        if (!any)
+        {
+            continue;
+        }
+
+        for (unsigned int board = 0; board < count; board++)
+        {
+            if (age[board] == BATCH_EXPIRED)
+            {
+                int impossible = color[board] == SOURCE_COLOR_IMPOSSIBLE;
+                batch->score[board] += impossible ? -5 : mult[color[board] & 7] * 5;
+                batch->cleared[board] |= !impossible;
+                batch->filled[board]--;
+                batch_change(batch, board, cell);
+                block[board] = BLOCK_TYPE_NONE;
+                pipe[board] = PIPE_CONN_NONE;
+                color[board] = SOURCE_COLOR_NONE;
+                age[board] = 0;
+            }
+        }
+    }
+
+    for (unsigned int board = 0; board < count; board++)
+    {
+        batch->sounds[(PLAYFIELD_SOUND_CLEAR * count) + board] += batch->cleared[board];
+    }
+}
+
+void batch_step(batch_t *batch, const int16_t *drops)
+{
+    unsigned int count = batch->count;
+
+    // Only one block can land per step, since a drop resets the place timer.
+    for (unsigned int board = 0; board < count; board++)
+    {
+        if (!batch->running[board])
+        {
+            continue;
+        }
+
+        if (drops[board] != BATCH_NO_DROP)
+        {
+            batch->curx[board] = drops[board] % PLAYFIELD_WIDTH;
+            batch->cury[board] = drops[board] / PLAYFIELD_WIDTH;
+            batch_cursor_drop(batch, board);
+        }
+        batch_drop_anywhere(batch, board);
+
+        // Same as playfield_game_over(), the game ends once every cell has
+        // a block in it, and then like control_tick() the board doesn't age
+        // or run its timer down.
+        if (batch->filled[board] == BATCH_CELLS)
+        {
+            batch->running[board] = 0;
+        }
+    }
+
+    // Each of these only solves the boards that placed or cleared something.
+    batch_solve(batch);
+    batch_age(batch);
+    batch_solve(batch);
+
+    for (unsigned int board = 0; board < count; board++)
+    {
+        if (!batch->running[board])
+        {
+            continue;
+        }
+
+        if (batch->score[board] < 0)
+        {
+            batch->score[board] = 0;
+        }
+        batch->timeleft[board] -= (float)(1.0 / (float)SIM_TICK_RATE);
+    }
+}
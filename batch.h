@@ -0,0 +1,116 @@
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include <stdint.h>
+#include "rng.h"
+#include "playfield.h"
+
+// Lots of boards stepped together, for bots and balance runs on the host.
+// Every field of every cell is kept in its own plane with all the boards
+// side by side, so the loops that solve connections and age beams walk
+// across boards rather than across cells and the compiler can vectorize
+// them. Solving only looks at boards that placed or cleared something. A
+// few of those get their changed chains walked one board at a time, and
+// lots of them get packed together and flooded across all at once. Boards
+// play by the default rules only, and a step does the same thing to a board
+// as moving the cursor to the drop (if asked to) and running control_tick()
+// on a single playfield with the drop button pressed.
+#define BATCH_CELLS (PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT)
+#define BATCH_SOURCES ((PLAYFIELD_WIDTH * 2) + (PLAYFIELD_HEIGHT * 2))
+
+#if BATCH_CELLS >= 255
+#error "Batch labels don't fit in a byte for boards this big!"
+#endif
+
+// Pass this instead of a cell to not drop anything on a board this step.
+#define BATCH_NO_DROP -1
+
+// How many placed or cleared cells a board remembers between solves. Any
+// more than this and the whole board gets solved.
+#define BATCH_CHANGES 16
+
+typedef struct
+{
+    unsigned int count;
+
+    // One entry per cell per board, indexed by (cell * count) + board.
+    uint8_t *block;
+    uint8_t *pipe;
+    uint8_t *color;
+    uint8_t *age;
+
+    // Indexed by (slot * count) + board.
+    uint8_t *upnext_block;
+    uint8_t *upnext_pipe;
+
+    // Indexed by (sound * count) + board, counting every PLAYFIELD_SOUND_*
+    // each board would have played.
+    uint32_t *sounds;
+
+    // One of each per board.
+    int32_t *score;
+    float *timeleft;
+    uint8_t *running;
+    int16_t *curx;
+    int16_t *cury;
+    int32_t *upnext_rotation;
+    uint32_t *seed;
+    rng_t *rng;
+
+    // Light sources around the edge, the same for every board.
+    uint8_t sources[BATCH_SOURCES];
+
+    // Which cell is next to every cell in every direction (or the spare
+    // plane past the last cell when that's off the edge), and which source
+    // is past the edge (or -1 when it isn't).
+    int16_t neighbor[BATCH_CELLS][4];
+    int16_t source[BATCH_CELLS][4];
+
+    // Per board, how many blocks it placed or cleared since it was last
+    // solved (or more than BATCH_CHANGES once there's too many to keep), since
+    // solving a board that didn't change gives the same answer it did last
+    // time. Which cells those were, indexed by (change * count) + board. And
+    // how many blocks it has, so nothing has to count them.
+    uint8_t *dirty;
+    uint8_t *changes;
+    uint8_t *filled;
+
+    // Scratch space for solving, packed by lane instead of by board, with
+    // which board every lane is. Labels are cell numbers, so they fit in a
+    // byte as long as boards stay smaller than 255 cells.
+    uint32_t *lanes;
+    uint8_t *lane_pipe;
+    uint8_t *link;
+    uint8_t *label;
+    uint8_t *touch;
+    uint8_t *activated;
+    uint8_t *wrong;
+    uint8_t *cleared;
+
+    // Used to start boards, so they start exactly like a playfield does.
+    playfield_t *scratch;
+} batch_t;
+
+batch_t *batch_new(unsigned int count);
+void batch_free(batch_t *batch);
+
+// Start a fresh game on one board, same as playfield_run().
+void batch_run(batch_t *batch, unsigned int board, uint32_t seed);
+
+// Step every running board once. Drops has a cell (y * width + x) or
+// BATCH_NO_DROP for every board.
+void batch_step(batch_t *batch, const int16_t *drops);
+
+// Copy one board out into a playfield of the default size, for looking at
+// or hashing with playfield_state_hash().
+void batch_export(batch_t *batch, unsigned int board, playfield_t *playfield);
+
+// The other way, copy a playfield of the default size into one board.
+void batch_import(batch_t *batch, unsigned int board, playfield_t *playfield);
+
+// Solve connections on every board that changed since it was last solved,
+// same as playfield_check_connections() on each of them. Stepping already
+// does this, it's only here for checking the solver on its own.
+void batch_solve(batch_t *batch);
+
+#endif
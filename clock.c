@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <naomi/thread.h>
+#include <naomi/timer.h>
+#include "clock.h"
+
+// How long the backing timer runs before we have to re-arm it.
+#define CLOCK_PERIOD 60000000
+
+// Which timer is running and what the clock read when it started. Rolling
+// over fills in the slot that isn't in use and then flips to it, so readers
+// that don't take the lock always see a whole one.
+typedef struct
+{
+    int timer;
+    uint64_t base;
+} clock_slot_t;
+
+static mutex_t clock_lock;
+static clock_slot_t clock_slots[2] = { { -1, 0 }, { -1, 0 } };
+static uint32_t clock_generation = 0;
+
+void clock_init()
+{
+    mutex_init(&clock_lock);
+    clock_slots[0].base = 0;
+    clock_slots[0].timer = timer_start(CLOCK_PERIOD);
+    __atomic_store_n(&clock_generation, 0, __ATOMIC_RELEASE);
+}
+
+uint64_t clock_us()
+{
+    mutex_lock(&clock_lock);
+
+    uint32_t generation = __atomic_load_n(&clock_generation, __ATOMIC_RELAXED);
+    clock_slot_t *slot = &clock_slots[generation & 1];
+    uint32_t left = timer_left(slot->timer);
+    if (left == 0)
+    {
+        // Timer ran out, roll it over into the base and start another. The
+        // old timer only gets stopped once nobody can start reading it.
+        clock_slot_t *next = &clock_slots[(generation + 1) & 1];
+        next->timer = timer_start(CLOCK_PERIOD);
+        next->base = slot->base + CLOCK_PERIOD;
+        __atomic_store_n(&clock_generation, generation + 1, __ATOMIC_RELEASE);
+        timer_stop(slot->timer);
+
+        slot = next;
+        left = CLOCK_PERIOD;
+    }
+
+    uint64_t now = slot->base + (CLOCK_PERIOD - left);
+    mutex_unlock(&clock_lock);
+    return now;
+}
+
+uint64_t clock_peek()
+{
+    while (1)
+    {
+        uint32_t generation = __atomic_load_n(&clock_generation, __ATOMIC_ACQUIRE);
+        clock_slot_t *slot = &clock_slots[generation & 1];
+        uint64_t base = slot->base;
+        uint32_t left = timer_left(slot->timer);
+
+        // Only retry if the clock rolled over while we were reading it,
+        // since then the timer we read might have been stopped.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&clock_generation, __ATOMIC_RELAXED) == generation)
+        {
+            return base + (CLOCK_PERIOD - left);
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#include <stdint.h>
+
+// Monotonic microsecond clock that can be read from any thread. It is built
+// on a single long-running libnaomi timer, so it must be read at least once a
+// minute to stay accurate, which the input thread takes care of.
+void clock_init();
+uint64_t clock_us();
+
+// The same clock without taking the lock or ever touching the timer, for
+// anything that has to stay out of the way of other threads, like tracing.
+// Sticks at the end of the timer's period if nobody has called clock_us()
+// to roll it over, which the input thread never lets happen.
+uint64_t clock_peek();
+
+#endif
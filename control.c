@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include <string.h>
+#include "control.h"
+#include "profiler.h"
+
+void control_init(control_t *control, playfield_t *playfield, void (*start)(void *user), void *user)
+{
+    memset(control, 0, sizeof(control_t));
+    control->playfield = playfield;
+    control->start = start;
+    control->user = user;
+    control_reset(control);
+}
+
+void control_reset(control_t *control)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        repeat_reset(&control->repeats[i]);
+    }
+}
+
+void control_input(control_t *control, sim_tick_t *tick)
+{
+    playfield_t *playfield = control->playfield;
+    uint32_t pressed = tick->pressed;
+    uint32_t held = tick->held;
+    uint32_t released = tick->released;
+    int dragging = 0;
+
+    // Handle drag modifier.
+    if (playfield->rules.dragging)
+    {
+        if (held & INPUT_BUTTON3)
+        {
+            dragging = 1;
+
+            if (pressed & INPUT_UP)
+            {
+                playfield_cursor_drag(playfield, CURSOR_MOVE_UP);
+            }
+            if (pressed & INPUT_DOWN)
+            {
+                playfield_cursor_drag(playfield, CURSOR_MOVE_DOWN);
+            }
+            if (pressed & INPUT_LEFT)
+            {
+                playfield_cursor_drag(playfield, CURSOR_MOVE_LEFT);
+            }
+            if (pressed & INPUT_RIGHT)
+            {
+                playfield_cursor_drag(playfield, CURSOR_MOVE_RIGHT);
+            }
+        }
+        else if(released & INPUT_BUTTON3)
+        {
+            // Let go of a drag, lets reset repeats.
+            for (int i = 0; i < 4; i++)
+            {
+                repeat_reset(&control->repeats[i]);
+            }
+        }
+    }
+
+    // Handle normal cursor movement.
+    if (!dragging)
+    {
+        if (pressed & INPUT_UP)
+        {
+            repeat_press(&control->repeats[0], tick->time);
+            playfield_cursor_move(playfield, CURSOR_MOVE_UP);
+        }
+        else if (repeat_update(&control->repeats[0], held & INPUT_UP, tick->time))
+        {
+            playfield_cursor_move(playfield, CURSOR_MOVE_UP);
+        }
+        if (pressed & INPUT_DOWN)
+        {
+            repeat_press(&control->repeats[1], tick->time);
+            playfield_cursor_move(playfield, CURSOR_MOVE_DOWN);
+        }
+        else if (repeat_update(&control->repeats[1], held & INPUT_DOWN, tick->time))
+        {
+            playfield_cursor_move(playfield, CURSOR_MOVE_DOWN);
+        }
+        if (pressed & INPUT_LEFT)
+        {
+            repeat_press(&control->repeats[2], tick->time);
+            playfield_cursor_move(playfield, CURSOR_MOVE_LEFT);
+        }
+        else if (repeat_update(&control->repeats[2], held & INPUT_LEFT, tick->time))
+        {
+            playfield_cursor_move(playfield, CURSOR_MOVE_LEFT);
+        }
+        if (pressed & INPUT_RIGHT)
+        {
+            repeat_press(&control->repeats[3], tick->time);
+            playfield_cursor_move(playfield, CURSOR_MOVE_RIGHT);
+        }
+        else if (repeat_update(&control->repeats[3], held & INPUT_RIGHT, tick->time))
+        {
+            playfield_cursor_move(playfield, CURSOR_MOVE_RIGHT);
+        }
+
+        if (playfield->rules.rotation)
+        {
+            if (pressed & INPUT_BUTTON1)
+            {
+                playfield_cursor_rotate(playfield, CURSOR_ROTATE_LEFT);
+            }
+            if (pressed & INPUT_BUTTON2)
+            {
+                playfield_cursor_rotate(playfield, CURSOR_ROTATE_RIGHT);
+            }
+        }
+        else if (playfield->rules.dragging)
+        {
+            if (pressed & INPUT_BUTTON1)
+            {
+                playfield_cursor_swap(playfield, SWAP_DIRECTION_HORIZONTAL);
+            }
+            if (pressed & INPUT_BUTTON2)
+            {
+                playfield_cursor_swap(playfield, SWAP_DIRECTION_VERTICAL);
+            }
+        }
+        else if (playfield->rules.placing)
+        {
+            if (pressed & INPUT_BUTTON1)
+            {
+                playfield_cursor_drop(playfield);
+            }
+        }
+    }
+
+    if (playfield->rules.placing)
+    {
+        playfield_drop_anywhere(playfield);
+    }
+}
+
+int control_tick(control_t *control, sim_tick_t *tick)
+{
+    playfield_t *playfield = control->playfield;
+    int result = 0;
+
+    // Remember what the board looked like so we know if a press changed it.
+    uint32_t input_hash = 0;
+    if (control->watch && tick->first_press)
+    {
+        input_hash = playfield_state_hash(playfield);
+    }
+
+    PROFILER_BEGIN(PROFILER_PHASE_RUNNING);
+    int running = playfield_running(playfield);
+    PROFILER_END(PROFILER_PHASE_RUNNING);
+
+    PROFILER_BEGIN(PROFILER_PHASE_HANDLING);
+    if (running)
+    {
+        control_input(control, tick);
+    }
+    else if ((tick->pressed & INPUT_START) && control->start)
+    {
+        control->start(control->user);
+        control_reset(control);
+    }
+    PROFILER_END(PROFILER_PHASE_HANDLING);
+
+    if (control->watch && tick->first_press && playfield_state_hash(playfield) != input_hash)
+    {
+        result |= CONTROL_CHANGED;
+    }
+
+    PROFILER_BEGIN(PROFILER_PHASE_RUNNING);
+    running = playfield_running(playfield);
+    PROFILER_END(PROFILER_PHASE_RUNNING);
+
+    if (running)
+    {
+        // Age the playfield so we can get rid of any beams that have stuck
+        // around too long.
+        PROFILER_BEGIN(PROFILER_PHASE_AGE);
+        playfield_age(playfield);
+        PROFILER_END(PROFILER_PHASE_AGE);
+
+        if (playfield->rules.placing)
+        {
+            // Make sure there's some time limit for placing.
+            playfield_decrease_placetime(playfield, 1.0 / (float)SIM_TICK_RATE);
+        }
+        result |= CONTROL_RUNNING;
+    }
+
+    return result;
+}
@@ -0,0 +1,50 @@
+#ifndef __CONTROL_H
+#define __CONTROL_H
+
+#include <stdint.h>
+#include "repeat.h"
+#include "sim.h"
+#include "playfield.h"
+
+// Turns one tick worth of controls into cursor moves, drops, drags and so
+// on, according to the playfield's rules. This is shared by the game and by
+// everything that plays games back on the host, so that a given stream of
+// ticks always does exactly the same thing to a playfield.
+typedef struct
+{
+    playfield_t *playfield;
+
+    // Cursor repeat tracking.
+    repeat_t repeats[4];
+
+    // Called when START is pressed with no game going, to start one with
+    // playfield_run(). Can be null for bots that start games themselves.
+    void (*start)(void *user);
+    void *user;
+
+    // Set to have control_tick() work out whether a tick's presses changed
+    // the board, which costs a couple of state hashes on ticks with a press.
+    int watch;
+} control_t;
+
+// Returned by control_tick(). RUNNING if a game is still going after the
+// tick, and CHANGED if watching and a press this tick changed the board.
+#define CONTROL_RUNNING 0x1
+#define CONTROL_CHANGED 0x2
+
+void control_init(control_t *control, playfield_t *playfield, void (*start)(void *user), void *user);
+
+// Forget any held directions, call this whenever a new game starts.
+void control_reset(control_t *control);
+
+// Handle a tick of input for a game in progress, including dropping the
+// upnext block if the place timer ran out.
+void control_input(control_t *control, sim_tick_t *tick);
+
+// Everything the game does with one tick. Handles its input if a game is
+// going, or starts one if START was pressed, and then if the game is still
+// going ages the board and runs the place timer down. The game and every
+// host tool that plays games go through this.
+int control_tick(control_t *control, sim_tick_t *tick);
+
+#endif
@@ -0,0 +1,883 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <naomi/video.h>
+#include "playfield.h"
+#include "sim.h"
+#include "hint.h"
+#include "draw.h"
+
+void view_init(view_t *view, playfield_t *playfield, int width, int height)
+{
+    // Room for the sources on either side, and the up next column wherever
+    // it goes.
+    int across = (width / BLOCK_WIDTH) - 2;
+    int down = (height / BLOCK_HEIGHT) - 2;
+    if (playfield->rules.placing)
+    {
+        if (playfield->vertical)
+        {
+            down -= 3;
+        }
+        else
+        {
+            across -= 3;
+        }
+    }
+
+    view->left = 0;
+    view->top = 0;
+    view->width = across < playfield->width ? across : playfield->width;
+    view->height = down < playfield->height ? down : playfield->height;
+    if (view->width < 1)
+    {
+        view->width = 1;
+    }
+    if (view->height < 1)
+    {
+        view->height = 1;
+    }
+
+    view_follow(view, playfield);
+}
+
+static int view_scroll(int start, int size, int total, int cursor)
+{
+    // Keep the margin from swallowing the whole view on tiny ones.
+    int margin = VIEW_MARGIN < ((size - 1) / 2) ? VIEW_MARGIN : ((size - 1) / 2);
+
+    if (cursor < start + margin)
+    {
+        start = cursor - margin;
+    }
+    if (cursor > start + size - 1 - margin)
+    {
+        start = cursor - (size - 1 - margin);
+    }
+    if (start > total - size)
+    {
+        start = total - size;
+    }
+    if (start < 0)
+    {
+        start = 0;
+    }
+    return start;
+}
+
+void view_follow(view_t *view, playfield_t *playfield)
+{
+    view->left = view_scroll(view->left, view->width, playfield->width, playfield->curx);
+    view->top = view_scroll(view->top, view->height, playfield->height, playfield->cury);
+}
+
+void playfield_metrics(playfield_t *playfield, view_t *view, int *width, int *height)
+{
+    int across = view ? view->width : playfield->width;
+    int down = view ? view->height : playfield->height;
+
+    if (playfield->vertical)
+    {
+        *width = (across + 2) * BLOCK_WIDTH;
+        *height = (down + 2) * BLOCK_HEIGHT;
+
+        if (playfield->rules.placing)
+        {
+            *height += BLOCK_WIDTH * 3;
+        }
+    }
+    else
+    {
+        *width = (across + 2) * BLOCK_WIDTH;
+        *height = (down + 2) * BLOCK_HEIGHT;
+
+        if (playfield->rules.placing)
+        {
+            *width += BLOCK_WIDTH * 3;
+        }
+    }
+}
+
+static void *playfield_block_sprite(sprites_t *sprites, playfield_entry_t *cur)
+{
+    switch(cur->block)
+    {
+        case BLOCK_TYPE_PURPLE:
+        {
+            return sprites->block_purple;
+            break;
+        }
+        case BLOCK_TYPE_ORANGE:
+        {
+            return sprites->block_orange;
+            break;
+        }
+        case BLOCK_TYPE_BLUE:
+        {
+            return sprites->block_blue;
+            break;
+        }
+        case BLOCK_TYPE_GREEN:
+        {
+            return sprites->block_green;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static void *playfield_pipe_sprite(sprites_t *sprites, playfield_entry_t *cur)
+{
+    switch(cur->pipe)
+    {
+        case PIPE_CONN_E | PIPE_CONN_W:
+        {
+            return sprites->pipe_ew;
+        }
+        case PIPE_CONN_N | PIPE_CONN_S:
+        {
+            return sprites->pipe_ns;
+        }
+        case PIPE_CONN_N | PIPE_CONN_E:
+        {
+            return sprites->pipe_ne;
+        }
+        case PIPE_CONN_N | PIPE_CONN_W:
+        {
+            return sprites->pipe_nw;
+        }
+        case PIPE_CONN_S | PIPE_CONN_E:
+        {
+            return sprites->pipe_se;
+        }
+        case PIPE_CONN_S | PIPE_CONN_W:
+        {
+            return sprites->pipe_sw;
+        }
+    }
+
+    return 0;
+}
+
+static void *playfield_color_sprite(sprites_t *sprites, playfield_entry_t *cur)
+{
+    if (cur->color == SOURCE_COLOR_IMPOSSIBLE)
+    {
+        return sprites->impossible;
+    }
+
+    switch(cur->pipe)
+    {
+        case PIPE_CONN_E | PIPE_CONN_W:
+        {
+            if (cur->color == SOURCE_COLOR_RED)
+            {
+                return sprites->red_ew;
+            }
+            if (cur->color == SOURCE_COLOR_GREEN)
+            {
+                return sprites->green_ew;
+            }
+            if (cur->color == SOURCE_COLOR_BLUE)
+            {
+                return sprites->blue_ew;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE))
+            {
+                return sprites->magenta_ew;
+            }
+            if (cur->color == (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->cyan_ew;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN))
+            {
+                return sprites->yellow_ew;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->white_ew;
+            }
+            break;
+        }
+        case PIPE_CONN_N | PIPE_CONN_S:
+        {
+            if (cur->color == SOURCE_COLOR_RED)
+            {
+                return sprites->red_ns;
+            }
+            if (cur->color == SOURCE_COLOR_GREEN)
+            {
+                return sprites->green_ns;
+            }
+            if (cur->color == SOURCE_COLOR_BLUE)
+            {
+                return sprites->blue_ns;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE))
+            {
+                return sprites->magenta_ns;
+            }
+            if (cur->color == (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->cyan_ns;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN))
+            {
+                return sprites->yellow_ns;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->white_ns;
+            }
+            break;
+        }
+        case PIPE_CONN_N | PIPE_CONN_E:
+        {
+            if (cur->color == SOURCE_COLOR_RED)
+            {
+                return sprites->red_ne;
+            }
+            if (cur->color == SOURCE_COLOR_GREEN)
+            {
+                return sprites->green_ne;
+            }
+            if (cur->color == SOURCE_COLOR_BLUE)
+            {
+                return sprites->blue_ne;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE))
+            {
+                return sprites->magenta_ne;
+            }
+            if (cur->color == (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->cyan_ne;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN))
+            {
+                return sprites->yellow_ne;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->white_ne;
+            }
+            break;
+        }
+        case PIPE_CONN_N | PIPE_CONN_W:
+        {
+            if (cur->color == SOURCE_COLOR_RED)
+            {
+                return sprites->red_nw;
+            }
+            if (cur->color == SOURCE_COLOR_GREEN)
+            {
+                return sprites->green_nw;
+            }
+            if (cur->color == SOURCE_COLOR_BLUE)
+            {
+                return sprites->blue_nw;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE))
+            {
+                return sprites->magenta_nw;
+            }
+            if (cur->color == (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->cyan_nw;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN))
+            {
+                return sprites->yellow_nw;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->white_nw;
+            }
+            break;
+        }
+        case PIPE_CONN_S | PIPE_CONN_E:
+        {
+            if (cur->color == SOURCE_COLOR_RED)
+            {
+                return sprites->red_se;
+            }
+            if (cur->color == SOURCE_COLOR_GREEN)
+            {
+                return sprites->green_se;
+            }
+            if (cur->color == SOURCE_COLOR_BLUE)
+            {
+                return sprites->blue_se;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE))
+            {
+                return sprites->magenta_se;
+            }
+            if (cur->color == (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->cyan_se;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN))
+            {
+                return sprites->yellow_se;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->white_se;
+            }
+            break;
+        }
+        case PIPE_CONN_S | PIPE_CONN_W:
+        {
+            if (cur->color == SOURCE_COLOR_RED)
+            {
+                return sprites->red_sw;
+            }
+            if (cur->color == SOURCE_COLOR_GREEN)
+            {
+                return sprites->green_sw;
+            }
+            if (cur->color == SOURCE_COLOR_BLUE)
+            {
+                return sprites->blue_sw;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE))
+            {
+                return sprites->magenta_sw;
+            }
+            if (cur->color == (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->cyan_sw;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN))
+            {
+                return sprites->yellow_sw;
+            }
+            if (cur->color == (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE))
+            {
+                return sprites->white_sw;
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+// The place timer is the only thing drawn that changes smoothly, so it's
+// the only thing alpha goes into. Blocks, drops and the cursor move a whole
+// cell at a time, and the cursor has to show exactly the cell a drop lands
+// in, so drawing it partway between cells would be wrong as well as a tick
+// late. Lit beams look the same however old they are until they clear.
+static int playfield_countdown(playfield_t *playfield, float alpha)
+{
+    int left = ((int)(playfield->timeleft - (alpha / (float)SIM_TICK_RATE))) + 1;
+    if (left > 5)
+    {
+        left = 5;
+    }
+    if (left < 0)
+    {
+        left = 0;
+    }
+    return left;
+}
+
+void playfield_draw(int x, int y, playfield_t *playfield, view_t *view, sprites_t *sprites, hint_t *hint, float alpha)
+{
+    int xoff = 0;
+    int yoff = 0;
+
+    view_t whole = { 0, 0, playfield->width, playfield->height };
+    if (view == 0)
+    {
+        view = &whole;
+    }
+
+    if (playfield->vertical)
+    {
+        if (playfield->rules.placing)
+        {
+            yoff += BLOCK_HEIGHT * 2;
+
+            video_draw_box(
+                x + BLOCK_WIDTH - PLAYFIELD_BORDER,
+                y,
+                x + (BLOCK_WIDTH * (1 + UPNEXT_AMOUNT)) + (PLAYFIELD_BORDER - 1),
+                y + (BLOCK_HEIGHT) + (PLAYFIELD_BORDER + 2),
+                rgb(255, 255, 255)
+            );
+            video_draw_box(
+                x + BLOCK_WIDTH - PLAYFIELD_BORDER - 1,
+                y + 1,
+                x + (BLOCK_WIDTH * (1 + UPNEXT_AMOUNT)) + (PLAYFIELD_BORDER),
+                y + (BLOCK_HEIGHT) + (PLAYFIELD_BORDER + 3),
+                rgb(255, 255, 255)
+            );
+
+            for (int i = 0; i < UPNEXT_AMOUNT; i++)
+            {
+                playfield_entry_t *cur = &playfield->upnext[i];
+                void *blocksprite = playfield_block_sprite(sprites, cur);
+                void *pipesprite = playfield_pipe_sprite(sprites, cur);
+                int xloc = x + (BLOCK_WIDTH * (i + 1));
+                int yloc = y + PLAYFIELD_BORDER + 1;
+
+                if (blocksprite != 0)
+                {
+                    video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, blocksprite);
+
+                    // Only draw pipes if there are blocks.
+                    if (pipesprite != 0)
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, pipesprite);
+                    }
+                }
+            }
+
+            if (playfield->running && playfield->rules.placetimer)
+            {
+                int left = playfield_countdown(playfield, alpha);
+
+                video_draw_debug_text(
+                    x + 12, y + 12,
+                    rgb(255, 255, 255),
+                    "%d", left
+                );
+            }
+
+            char message[128];
+            memset(message, 0, 128);
+            if (playfield_game_over(playfield))
+            {
+                strcpy(message, "Game over!");
+            }
+            else if (!playfield->running)
+            {
+                strcpy(message, "Press start!");
+            }
+
+            // Draw score and such.
+            video_draw_debug_text(
+                x + xoff + BLOCK_WIDTH, y + yoff + (BLOCK_HEIGHT * (view->height + 2)) + 12,
+                rgb(255, 255, 255),
+                "Score: %d\n\n%s",
+                playfield->score,
+                message
+            );
+        }
+    }
+    else
+    {
+        if (playfield->rules.placing)
+        {
+            video_draw_box(
+                x + (BLOCK_WIDTH * (view->width + 4)) - PLAYFIELD_BORDER,
+                y + BLOCK_HEIGHT - PLAYFIELD_BORDER,
+                x + (BLOCK_WIDTH * (view->width + 5)) + (PLAYFIELD_BORDER - 1),
+                y + BLOCK_HEIGHT * (1 + UPNEXT_AMOUNT) + (PLAYFIELD_BORDER - 1),
+                rgb(255, 255, 255)
+            );
+            video_draw_box(
+                x + (BLOCK_WIDTH * (view->width + 4)) - PLAYFIELD_BORDER - 1,
+                y + BLOCK_HEIGHT - PLAYFIELD_BORDER - 1,
+                x + (BLOCK_WIDTH * (view->width + 5)) + (PLAYFIELD_BORDER),
+                y + BLOCK_HEIGHT * (1 + UPNEXT_AMOUNT) + (PLAYFIELD_BORDER),
+                rgb(255, 255, 255)
+            );
+
+            for (int i = 0; i < UPNEXT_AMOUNT; i++)
+            {
+                playfield_entry_t *cur = &playfield->upnext[i];
+                void *blocksprite = playfield_block_sprite(sprites, cur);
+                void *pipesprite = playfield_pipe_sprite(sprites, cur);
+                int xloc = x + (BLOCK_WIDTH * (view->width + 4));
+                int yloc = y + (BLOCK_HEIGHT * (i + 1));
+
+                if (blocksprite != 0)
+                {
+                    video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, blocksprite);
+
+                    // Only draw pipes if there are blocks.
+                    if (pipesprite != 0)
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, pipesprite);
+                    }
+                }
+            }
+
+            if (playfield->running && playfield->rules.placetimer)
+            {
+                int left = playfield_countdown(playfield, alpha);
+
+                video_draw_debug_text(
+                    x + (BLOCK_WIDTH * (view->width + 3)) + 12, y + BLOCK_HEIGHT + 12,
+                    rgb(255, 255, 255),
+                    "%d", left
+                );
+            }
+
+            char message[128];
+            memset(message, 0, 128);
+            if (playfield_game_over(playfield))
+            {
+                strcpy(message, "Game over!");
+            }
+            else if (!playfield->running)
+            {
+                strcpy(message, "Press start!");
+            }
+
+            // Draw score and such.
+            video_draw_debug_text(
+                x + (BLOCK_WIDTH * (view->width + 2)) + 12, y + (BLOCK_HEIGHT * (view->height)),
+                rgb(255, 255, 255),
+                "Score: %d\n\n%s",
+                playfield->score,
+                message
+            );
+        }
+    }
+
+    video_draw_box(
+        x + xoff + BLOCK_WIDTH - PLAYFIELD_BORDER,
+        y + yoff + BLOCK_HEIGHT - PLAYFIELD_BORDER,
+        x + xoff + (BLOCK_WIDTH * (view->width + 1)) + (PLAYFIELD_BORDER - 1),
+        y + yoff + (BLOCK_HEIGHT * (view->height + 1)) + (PLAYFIELD_BORDER - 1),
+        rgb(255, 255, 255)
+    );
+    video_draw_box(
+        x + xoff + BLOCK_WIDTH - PLAYFIELD_BORDER - 1,
+        y + yoff + BLOCK_HEIGHT - PLAYFIELD_BORDER - 1,
+        x + xoff + (BLOCK_WIDTH * (view->width + 1)) + PLAYFIELD_BORDER,
+        y + yoff + (BLOCK_HEIGHT * (view->height + 1)) + PLAYFIELD_BORDER,
+        rgb(255, 255, 255)
+    );
+
+    // Sources only get drawn along the edges of the board that are in view.
+    int top = view->top == 0 ? -1 : view->top;
+    int bottom = (view->top + view->height) == playfield->height ? playfield->height : (view->top + view->height - 1);
+    int left = view->left == 0 ? -1 : view->left;
+    int right = (view->left + view->width) == playfield->width ? playfield->width : (view->left + view->width - 1);
+
+    for (int pheight = top; pheight <= bottom; pheight++)
+    {
+        for (int pwidth = left; pwidth <= right; pwidth++)
+        {
+            int xloc = x + xoff + ((pwidth - view->left + 1) * BLOCK_WIDTH);
+            int yloc = y + yoff + ((pheight - view->top + 1) * BLOCK_HEIGHT);
+
+            // First, draw the blocks on the playfield.
+            if (pheight >= 0 && pheight < playfield->height && pwidth >= 0 && pwidth < playfield->width)
+            {
+                playfield_entry_t *cur = playfield_entry(playfield, pwidth, pheight);
+                void *blocksprite = 0;
+
+                // Handle displaying cursor ghost.
+                if (cur->block == BLOCK_TYPE_NONE)
+                {
+                    // Point out the best places for the next block.
+                    if (hint != 0 && playfield->running && playfield->rules.placing && hint_best(hint, pwidth, pheight))
+                    {
+                        video_draw_box(xloc + 2, yloc + 2, xloc + BLOCK_WIDTH - 3, yloc + BLOCK_HEIGHT - 3, rgb(255, 255, 0));
+                        video_draw_box(xloc + 3, yloc + 3, xloc + BLOCK_WIDTH - 4, yloc + BLOCK_HEIGHT - 4, rgb(255, 255, 0));
+                    }
+
+                    if (playfield->rules.placing && playfield->upnext->block != BLOCK_TYPE_NONE && playfield->curx == pwidth && playfield->cury == pheight)
+                    {
+                        blocksprite = sprites->block_gray;
+                        cur = playfield->upnext;
+                    }
+                }
+                else
+                {
+                    blocksprite = playfield_block_sprite(sprites, cur);
+                }
+
+                void *pipesprite = playfield_pipe_sprite(sprites, cur);
+                void *colorsprite = playfield_color_sprite(sprites, cur);
+
+                if (blocksprite != 0)
+                {
+                    video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, blocksprite);
+
+                    // Only draw pipes if there are blocks.
+                    if (pipesprite != 0)
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, pipesprite);
+
+                        // Only draw colors if there are pipes.
+                        if (colorsprite != 0)
+                        {
+                            video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, colorsprite);
+                        }
+                    }
+                }
+            }
+
+            // Now draw sources around the edges.
+            source_entry_t *source = 0;
+            void *sourcesprite = 0;
+            void *pipecolorsprite = 0;
+            if (pwidth == -1)
+            {
+                if (pheight >= 0 && pheight < playfield->height)
+                {
+                    source = playfield->sources + pheight;
+                    sourcesprite = sprites->source_e;
+                    playfield_entry_t *adj = playfield_entry(playfield, 0, pheight);
+                    if (adj->pipe & PIPE_CONN_W)
+                    {
+                        switch(adj->color)
+                        {
+                            case SOURCE_COLOR_RED:
+                            {
+                                pipecolorsprite = sprites->red_e;
+                                break;
+                            }
+                            case SOURCE_COLOR_GREEN:
+                            {
+                                pipecolorsprite = sprites->green_e;
+                                break;
+                            }
+                            case SOURCE_COLOR_BLUE:
+                            {
+                                pipecolorsprite = sprites->blue_e;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->magenta_e;
+                                break;
+                            }
+                            case (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->cyan_e;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN):
+                            {
+                                pipecolorsprite = sprites->yellow_e;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->white_e;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            else if (pwidth == playfield->width)
+            {
+                if (pheight >= 0 && pheight < playfield->height)
+                {
+                    source = playfield->sources + playfield->height + pheight;
+                    sourcesprite = sprites->source_w;
+                    playfield_entry_t *adj = playfield_entry(playfield, playfield->width - 1, pheight);
+                    if (adj->pipe & PIPE_CONN_E)
+                    {
+                        switch(adj->color)
+                        {
+                            case SOURCE_COLOR_RED:
+                            {
+                                pipecolorsprite = sprites->red_w;
+                                break;
+                            }
+                            case SOURCE_COLOR_GREEN:
+                            {
+                                pipecolorsprite = sprites->green_w;
+                                break;
+                            }
+                            case SOURCE_COLOR_BLUE:
+                            {
+                                pipecolorsprite = sprites->blue_w;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->magenta_w;
+                                break;
+                            }
+                            case (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->cyan_w;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN):
+                            {
+                                pipecolorsprite = sprites->yellow_w;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->white_w;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            else if (pheight == playfield->height)
+            {
+                if (pwidth >= 0 && pwidth < playfield->width)
+                {
+                    source = playfield->sources + (2 * playfield->height) + pwidth;
+                    sourcesprite = sprites->source_n;
+                    playfield_entry_t *adj = playfield_entry(playfield, pwidth, playfield->height - 1);
+                    if (adj->pipe & PIPE_CONN_S)
+                    {
+                        switch(adj->color)
+                        {
+                            case SOURCE_COLOR_RED:
+                            {
+                                pipecolorsprite = sprites->red_n;
+                                break;
+                            }
+                            case SOURCE_COLOR_GREEN:
+                            {
+                                pipecolorsprite = sprites->green_n;
+                                break;
+                            }
+                            case SOURCE_COLOR_BLUE:
+                            {
+                                pipecolorsprite = sprites->blue_n;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->magenta_n;
+                                break;
+                            }
+                            case (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->cyan_n;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN):
+                            {
+                                pipecolorsprite = sprites->yellow_n;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->white_n;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            else if (pheight == -1)
+            {
+                if (pwidth >= 0 && pwidth < playfield->width)
+                {
+                    source = playfield->sources + (2 * playfield->height) + playfield->width + pwidth;
+                    sourcesprite = sprites->source_s;
+                    playfield_entry_t *adj = playfield_entry(playfield, pwidth, 0);
+                    if (adj->pipe & PIPE_CONN_N)
+                    {
+                        switch(adj->color)
+                        {
+                            case SOURCE_COLOR_RED:
+                            {
+                                pipecolorsprite = sprites->red_s;
+                                break;
+                            }
+                            case SOURCE_COLOR_GREEN:
+                            {
+                                pipecolorsprite = sprites->green_s;
+                                break;
+                            }
+                            case SOURCE_COLOR_BLUE:
+                            {
+                                pipecolorsprite = sprites->blue_s;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->magenta_s;
+                                break;
+                            }
+                            case (SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->cyan_s;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN):
+                            {
+                                pipecolorsprite = sprites->yellow_s;
+                                break;
+                            }
+                            case (SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE):
+                            {
+                                pipecolorsprite = sprites->white_s;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (source != 0)
+            {
+                if (source->color != SOURCE_COLOR_NONE)
+                {
+                    video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sourcesprite);
+                }
+                if (pipecolorsprite != 0)
+                {
+                    video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, pipecolorsprite);
+                }
+
+                switch(source->color)
+                {
+                    case SOURCE_COLOR_RED:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_red);
+                        break;
+                    }
+                    case SOURCE_COLOR_GREEN:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_green);
+                        break;
+                    }
+                    case SOURCE_COLOR_BLUE:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_blue);
+                        break;
+                    }
+                    case SOURCE_COLOR_RED | SOURCE_COLOR_BLUE:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_magenta);
+                        break;
+                    }
+                    case SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_cyan);
+                        break;
+                    }
+                    case SOURCE_COLOR_RED | SOURCE_COLOR_GREEN:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_yellow);
+                        break;
+                    }
+                    case SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE:
+                    {
+                        video_draw_sprite(xloc, yloc, BLOCK_WIDTH, BLOCK_HEIGHT, sprites->source_white);
+                        break;
+                    }
+                }
+            }
+
+            // Finally, draw the cursor
+            if (playfield->running && pwidth == playfield->curx && pheight == playfield->cury)
+            {
+                video_draw_sprite(xloc + CURSOR_OFFSET_X, yloc + CURSOR_OFFSET_Y, CURSOR_WIDTH, CURSOR_HEIGHT, sprites->cursor);
+            }
+        }
+    }
+}
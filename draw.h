@@ -0,0 +1,164 @@
+#ifndef __DRAW_H
+#define __DRAW_H
+
+#include "playfield.h"
+#include "hint.h"
+
+// Drawing a playfield, its sources and its up next column. Only ever talks
+// to libnaomi's video calls, so the host can draw against a stub to time it.
+
+#define BLOCK_WIDTH 32
+#define BLOCK_HEIGHT 32
+
+#define CURSOR_WIDTH 64
+#define CURSOR_HEIGHT 64
+#define CURSOR_OFFSET_X -16
+#define CURSOR_OFFSET_Y -16
+
+#define PLAYFIELD_BORDER 2
+
+// Every sprite the playfield is drawn with.
+typedef struct
+{
+    void *cursor;
+    void *impossible;
+
+    void *block_purple;
+    void *block_orange;
+    void *block_blue;
+    void *block_green;
+    void *block_gray;
+
+    void *pipe_ns;
+    void *red_ns;
+    void *green_ns;
+    void *blue_ns;
+    void *cyan_ns;
+    void *magenta_ns;
+    void *yellow_ns;
+    void *white_ns;
+
+    void *pipe_ew;
+    void *red_ew;
+    void *green_ew;
+    void *blue_ew;
+    void *cyan_ew;
+    void *magenta_ew;
+    void *yellow_ew;
+    void *white_ew;
+
+    void *pipe_ne;
+    void *red_ne;
+    void *green_ne;
+    void *blue_ne;
+    void *cyan_ne;
+    void *magenta_ne;
+    void *yellow_ne;
+    void *white_ne;
+
+    void *pipe_se;
+    void *red_se;
+    void *green_se;
+    void *blue_se;
+    void *cyan_se;
+    void *magenta_se;
+    void *yellow_se;
+    void *white_se;
+
+    void *pipe_nw;
+    void *red_nw;
+    void *green_nw;
+    void *blue_nw;
+    void *cyan_nw;
+    void *magenta_nw;
+    void *yellow_nw;
+    void *white_nw;
+
+    void *pipe_sw;
+    void *red_sw;
+    void *green_sw;
+    void *blue_sw;
+    void *cyan_sw;
+    void *magenta_sw;
+    void *yellow_sw;
+    void *white_sw;
+
+    void *source_n;
+    void *source_e;
+    void *source_w;
+    void *source_s;
+
+    void *source_red;
+    void *source_green;
+    void *source_blue;
+    void *source_cyan;
+    void *source_magenta;
+    void *source_yellow;
+    void *source_white;
+
+    void *red_n;
+    void *green_n;
+    void *blue_n;
+    void *cyan_n;
+    void *magenta_n;
+    void *yellow_n;
+    void *white_n;
+
+    void *red_s;
+    void *green_s;
+    void *blue_s;
+    void *cyan_s;
+    void *magenta_s;
+    void *yellow_s;
+    void *white_s;
+
+    void *red_e;
+    void *green_e;
+    void *blue_e;
+    void *cyan_e;
+    void *magenta_e;
+    void *yellow_e;
+    void *white_e;
+
+    void *red_w;
+    void *green_w;
+    void *blue_w;
+    void *cyan_w;
+    void *magenta_w;
+    void *yellow_w;
+    void *white_w;
+} sprites_t;
+
+// Boards too big for the screen get drawn through a view onto part of them,
+// which scrolls to keep the cursor at least this many cells from its edges.
+#define VIEW_MARGIN 2
+
+typedef struct
+{
+    // The top left cell on screen, and how many cells across and down fit,
+    // not counting the sources around the edge.
+    int left;
+    int top;
+    int width;
+    int height;
+} view_t;
+
+// Fit a view onto playfield into width by height pixels, leaving room for
+// the sources, border and up next column.
+void view_init(view_t *view, playfield_t *playfield, int width, int height);
+
+// Scroll the view so the cursor stays on screen.
+void view_follow(view_t *view, playfield_t *playfield);
+
+// How much room a playfield takes up on screen, including the up next
+// column and score when they're shown. View can be 0 for the whole board.
+void playfield_metrics(playfield_t *playfield, view_t *view, int *width, int *height);
+
+// Draw the playfield with its top left at x, y. Only the cells in view are
+// drawn, or the whole board if view is 0. Alpha is how far into the next
+// simulation tick we are, which only the place timer countdown uses since
+// everything else on the board moves a cell at a time. Hint can be 0 to not
+// point out where the next block should go.
+void playfield_draw(int x, int y, playfield_t *playfield, view_t *view, sprites_t *sprites, hint_t *hint, float alpha);
+
+#endif
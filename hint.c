@@ -0,0 +1,374 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "playfield.h"
+#include "hint.h"
+
+// Clearing a lit chain always beats anything that only gets a chain closer
+// to a source, no matter how long that chain is.
+#define HINT_LIT_BONUS 1000
+
+// Covering up a source with a block that doesn't face it means that source
+// can't be used until the block clears.
+#define HINT_BLOCKED_SOURCE 3
+
+void hint_init(hint_t *hint, playfield_t *playfield)
+{
+    memset(hint, 0, sizeof(hint_t));
+    hint->playfield = playfield;
+    hint->scores = malloc(sizeof(int) * playfield->width * playfield->height);
+    hint->visited = calloc(playfield->width * playfield->height, 1);
+
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        hint->scores[i] = HINT_UNAVAILABLE;
+    }
+    for (int i = 0; i < HINT_BEST; i++)
+    {
+        hint->best[i] = -1;
+    }
+}
+
+void hint_free(hint_t *hint)
+{
+    free(hint->scores);
+    free(hint->visited);
+    hint->scores = 0;
+    hint->visited = 0;
+}
+
+static unsigned int hint_source(playfield_t *playfield, int x, int y)
+{
+    // Same layout as playfield_set_source().
+    if (x == -1)
+    {
+        return playfield->sources[y].color;
+    }
+    if (x == playfield->width)
+    {
+        return playfield->sources[playfield->height + y].color;
+    }
+    if (y == playfield->height)
+    {
+        return playfield->sources[(2 * playfield->height) + x].color;
+    }
+    return playfield->sources[(2 * playfield->height) + playfield->width + x].color;
+}
+
+// Moves x, y one cell in the out direction, and returns which side of that
+// cell we came in from.
+static unsigned int hint_step(int *x, int *y, unsigned int out)
+{
+    switch(out)
+    {
+        case PIPE_CONN_N:
+            (*y)--;
+            return PIPE_CONN_S;
+        case PIPE_CONN_S:
+            (*y)++;
+            return PIPE_CONN_N;
+        case PIPE_CONN_E:
+            (*x)++;
+            return PIPE_CONN_W;
+        default:
+            (*x)--;
+            return PIPE_CONN_E;
+    }
+}
+
+// Follow the chain leaving x, y in the out direction until it ends, and
+// return what's at the far end the same way the solver's impossible pass
+// would see it: a source's color, SOURCE_COLOR_NONE if the chain could
+// still go somewhere, or SOURCE_COLOR_IMPOSSIBLE.
+static unsigned int hint_trace(playfield_t *playfield, uint8_t *visited, int x, int y, unsigned int out, int *length)
+{
+    while (1)
+    {
+        unsigned int in = hint_step(&x, &y, out);
+        if (x < 0 || y < 0 || x >= playfield->width || y >= playfield->height)
+        {
+            unsigned int color = hint_source(playfield, x, y);
+            return color ? color : SOURCE_COLOR_IMPOSSIBLE;
+        }
+
+        // Running into any part of our own chain, connected or not, is
+        // something no later block can ever fix.
+        int cell = x + (y * playfield->width);
+        if (visited[cell])
+        {
+            return SOURCE_COLOR_IMPOSSIBLE;
+        }
+
+        playfield_entry_t *cur = playfield->entries + cell;
+        if (cur->block == BLOCK_TYPE_NONE || (cur->pipe & in) == 0)
+        {
+            return SOURCE_COLOR_NONE;
+        }
+
+        visited[cell] = 1;
+        (*length)++;
+
+        out = cur->pipe & (~in);
+        if (out == 0)
+        {
+            return SOURCE_COLOR_NONE;
+        }
+    }
+}
+
+// Walks the same way hint_trace() did and unmarks everything it marked, so
+// the next evaluation gets a clean slate without clearing the whole board.
+// Marked cells always form a path out from where the block would go, so
+// this stops at the first cell that isn't marked or doesn't connect.
+static void hint_untrace(playfield_t *playfield, uint8_t *visited, int x, int y, unsigned int out)
+{
+    while (1)
+    {
+        unsigned int in = hint_step(&x, &y, out);
+        if (x < 0 || y < 0 || x >= playfield->width || y >= playfield->height)
+        {
+            return;
+        }
+
+        int cell = x + (y * playfield->width);
+        playfield_entry_t *cur = playfield->entries + cell;
+        if (!visited[cell] || cur->block == BLOCK_TYPE_NONE || (cur->pipe & in) == 0)
+        {
+            return;
+        }
+
+        visited[cell] = 0;
+        out = cur->pipe & (~in);
+        if (out == 0)
+        {
+            return;
+        }
+    }
+}
+
+int hint_evaluate(playfield_t *playfield, uint8_t *visited, int x, int y, unsigned int pipe)
+{
+    static const int mult[8] = {0, 1, 1, 2, 1, 2, 2, 4};
+
+    // The block only exists in here, as the start of the trace, so the
+    // playfield is only ever read.
+    visited[x + (y * playfield->width)] = 1;
+
+    int length = 1;
+    unsigned int color = SOURCE_COLOR_NONE;
+    int ends = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned int out = pipe & (1 << i);
+        if (out == 0)
+        {
+            continue;
+        }
+
+        unsigned int end = hint_trace(playfield, visited, x, y, out, &length);
+        if (end == SOURCE_COLOR_IMPOSSIBLE)
+        {
+            color = SOURCE_COLOR_IMPOSSIBLE;
+            break;
+        }
+        if (end == SOURCE_COLOR_NONE)
+        {
+            continue;
+        }
+
+        // Same nesting rule as the solver, the chain takes on whichever
+        // color has fewer bands in it.
+        ends++;
+        if (color == SOURCE_COLOR_NONE || (end & color) == end)
+        {
+            color = end;
+        }
+        else if ((end & color) != color)
+        {
+            color = SOURCE_COLOR_IMPOSSIBLE;
+            break;
+        }
+    }
+
+    visited[x + (y * playfield->width)] = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (pipe & (1 << i))
+        {
+            hint_untrace(playfield, visited, x, y, pipe & (1 << i));
+        }
+    }
+
+    int score;
+    if (color == SOURCE_COLOR_IMPOSSIBLE)
+    {
+        // Everything in the chain clears for a penalty.
+        score = -5 * length;
+    }
+    else if (ends == 2)
+    {
+        // Lights up, everything in the chain clears for points.
+        score = HINT_LIT_BONUS + (mult[color & 7] * 5 * length);
+    }
+    else if (ends == 1)
+    {
+        // Heading somewhere from a source, the longer the better.
+        score = length;
+    }
+    else
+    {
+        score = 0;
+    }
+
+    // Penalize sitting next to a source without facing it.
+    if (y == 0 && !(pipe & PIPE_CONN_N) && hint_source(playfield, x, -1))
+    {
+        score -= HINT_BLOCKED_SOURCE;
+    }
+    if (y == playfield->height - 1 && !(pipe & PIPE_CONN_S) && hint_source(playfield, x, playfield->height))
+    {
+        score -= HINT_BLOCKED_SOURCE;
+    }
+    if (x == 0 && !(pipe & PIPE_CONN_W) && hint_source(playfield, -1, y))
+    {
+        score -= HINT_BLOCKED_SOURCE;
+    }
+    if (x == playfield->width - 1 && !(pipe & PIPE_CONN_E) && hint_source(playfield, playfield->width, y))
+    {
+        score -= HINT_BLOCKED_SOURCE;
+    }
+
+    return score;
+}
+
+static uint64_t hint_signature(playfield_t *playfield)
+{
+    // The playfield's hash already covers every block's pipe and every
+    // source, which is everything on the board a score depends on, so this
+    // costs the same on any size board. The up next block and whether we're
+    // running get mixed in on top.
+    uint64_t extra = playfield->upnext[0].pipe | (playfield->upnext[0].block << 4) | (playfield->running << 8);
+    return playfield->zobrist ^ ((extra + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+static int hint_placeable(playfield_t *playfield, int x, int y)
+{
+    if (playfield_entry(playfield, x, y)->block != BLOCK_TYPE_NONE)
+    {
+        return 0;
+    }
+
+    // With gravity, only score the cell a block dropped in this column
+    // would actually land on.
+    if (playfield->rules.gravity && y < playfield->height - 1)
+    {
+        return playfield_entry(playfield, x, y + 1)->block != BLOCK_TYPE_NONE;
+    }
+
+    return 1;
+}
+
+static void hint_pick_best(hint_t *hint)
+{
+    int cells = hint->playfield->width * hint->playfield->height;
+
+    for (int i = 0; i < HINT_BEST; i++)
+    {
+        hint->best[i] = -1;
+    }
+
+    // Only bother pointing out cells that actually do something useful.
+    for (int cell = 0; cell < cells; cell++)
+    {
+        int score = hint->scores[cell];
+        if (score <= 0)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < HINT_BEST; i++)
+        {
+            if (hint->best[i] < 0 || score > hint->scores[hint->best[i]])
+            {
+                memmove(&hint->best[i + 1], &hint->best[i], sizeof(int) * (HINT_BEST - 1 - i));
+                hint->best[i] = cell;
+                break;
+            }
+        }
+    }
+}
+
+int hint_update(hint_t *hint, uint32_t budget)
+{
+    playfield_t *playfield = hint->playfield;
+    int cells = playfield->width * playfield->height;
+
+    uint64_t signature = hint_signature(playfield);
+    if (signature != hint->signature || hint->next > cells)
+    {
+        hint->signature = signature;
+        hint->next = 0;
+    }
+    if (hint->next == cells)
+    {
+        return 0;
+    }
+
+    unsigned int pipe = PIPE_CONN_NONE;
+    if (playfield->running && playfield->rules.placing && playfield->upnext[0].block != BLOCK_TYPE_NONE)
+    {
+        pipe = playfield->upnext[0].pipe;
+    }
+
+    uint64_t start = playfield->platform->time(playfield->platform->user);
+    int scored = 0;
+    while (hint->next < cells)
+    {
+        int x = hint->next % playfield->width;
+        int y = hint->next / playfield->width;
+
+        if (pipe != PIPE_CONN_NONE && hint_placeable(playfield, x, y))
+        {
+            hint->scores[hint->next] = hint_evaluate(playfield, hint->visited, x, y, pipe);
+            scored++;
+        }
+        else
+        {
+            hint->scores[hint->next] = HINT_UNAVAILABLE;
+        }
+        hint->next++;
+
+        if ((playfield->platform->time(playfield->platform->user) - start) >= budget)
+        {
+            break;
+        }
+    }
+
+    hint->evaluations += scored;
+    if (hint->next == cells)
+    {
+        hint_pick_best(hint);
+    }
+    return scored;
+}
+
+int hint_best(hint_t *hint, int x, int y)
+{
+    int cell = x + (y * hint->playfield->width);
+
+    // The old best cells stay up while a new board gets scored, so don't
+    // point at any that have been filled since.
+    if (hint->playfield->entries[cell].block != BLOCK_TYPE_NONE)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < HINT_BEST; i++)
+    {
+        if (hint->best[i] == cell)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
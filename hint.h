@@ -0,0 +1,56 @@
+#ifndef __HINT_H
+#define __HINT_H
+
+#include <stdint.h>
+#include "playfield.h"
+
+// Placement hints. Scores every empty cell for the block at the front of
+// up next by tracing what would happen if it were dropped there, without
+// ever touching the playfield itself. Scoring is spread out over as many
+// frames as it takes, a few cells at a time, so it never eats more of a
+// frame than it's given. The best few cells get highlighted when drawing.
+#define HINT_BEST 3
+
+// Score for cells the block can't go, or that haven't been scored yet.
+#define HINT_UNAVAILABLE (-1000000)
+
+typedef struct
+{
+    playfield_t *playfield;
+
+    // One score per cell, indexed the same as the playfield's entries.
+    int *scores;
+    // Scratch space for tracing pipes.
+    uint8_t *visited;
+
+    // The next cell to score, and what the board and up next block looked
+    // like when we started scoring, so we know when to start over.
+    int next;
+    uint64_t signature;
+
+    // The best cells from the last time every cell got scored, best first,
+    // or -1. These stay up while a changed board is being rescored.
+    int best[HINT_BEST];
+
+    // How many cells have been scored in total, for diagnostics.
+    unsigned int evaluations;
+} hint_t;
+
+void hint_init(hint_t *hint, playfield_t *playfield);
+void hint_free(hint_t *hint);
+
+// Score cells until they're all done or budget microseconds of platform
+// time have gone by, whichever is first. Always scores at least one cell
+// when there's one left to score. Returns how many cells got scored.
+int hint_update(hint_t *hint, uint32_t budget);
+
+// Whether the cell at x, y is one of the best places for the next block.
+int hint_best(hint_t *hint, int x, int y);
+
+// Score a single cell for a block with the given pipe, using visited as
+// scratch space that's at least as big as the board. Visited has to start
+// out all zeros, and is left that way. This is what hint_update() calls for
+// every cell.
+int hint_evaluate(playfield_t *playfield, uint8_t *visited, int x, int y, unsigned int pipe);
+
+#endif
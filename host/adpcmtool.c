@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "adpcm.h"
+
+// Host-side companion to adpcm.c. Used by the ROM build to convert the raw
+// 16-bit sound effects to 4-bit ADPCM, and by us to check how much quality
+// and sound RAM the conversion costs. Sound effects that come out of the
+// round trip noisier than MIN_SNR_DB are left as 16-bit PCM instead, since
+// the sound RAM saved isn't worth an audibly worse sound.
+
+#define MIN_SNR_DB 20.0
+
+void *file_load(const char * const path, unsigned int *length)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp)
+    {
+        unsigned int size;
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+
+        void *data = malloc(size ? size : 1);
+        if (data)
+        {
+            if (fread(data, 1, size, fp) != size)
+            {
+                free(data);
+                data = 0;
+                size = 0;
+            }
+        }
+        else
+        {
+            size = 0;
+        }
+
+        fclose(fp);
+        *length = size;
+        return data;
+    }
+    else
+    {
+        *length = 0;
+        return 0;
+    }
+}
+
+// Round trips a sound through the codec exactly as the AICA would play it
+// and returns the signal to noise ratio in dB, or infinity if it came back
+// untouched.
+double round_trip_snr(const int16_t *pcm, unsigned int num_samples)
+{
+    uint8_t *adpcm = malloc(adpcm_encoded_length(num_samples) + 1);
+    int16_t *decoded = malloc(sizeof(int16_t) * (num_samples + 1));
+    adpcm_encode(pcm, num_samples, adpcm);
+    adpcm_decode(adpcm, num_samples, decoded);
+
+    double signal = 0.0;
+    double noise = 0.0;
+    for (unsigned int s = 0; s < num_samples; s++)
+    {
+        double diff = (double)pcm[s] - (double)decoded[s];
+        signal += (double)pcm[s] * (double)pcm[s];
+        noise += diff * diff;
+    }
+
+    free(decoded);
+    free(adpcm);
+    return noise > 0.0 ? 10.0 * log10(signal / noise) : INFINITY;
+}
+
+int write_file(const char * const path, const void *data, unsigned int length)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Could not open %s for writing!\n", path);
+        return 1;
+    }
+
+    fwrite(data, 1, length, fp);
+    fclose(fp);
+    return 0;
+}
+
+int encode(const char * const inpath, const char * const outpath)
+{
+    unsigned int length;
+    int16_t *pcm = file_load(inpath, &length);
+    if (!pcm)
+    {
+        fprintf(stderr, "Could not load %s!\n", inpath);
+        return 1;
+    }
+
+    unsigned int num_samples = length / 2;
+    unsigned int encoded_length = adpcm_encoded_length(num_samples);
+    uint8_t *adpcm = malloc(encoded_length ? encoded_length : 1);
+    adpcm_encode(pcm, num_samples, adpcm);
+    int failed = write_file(outpath, adpcm, encoded_length);
+
+    free(adpcm);
+    free(pcm);
+    return failed;
+}
+
+int convert(const char * const inpath, const char * const outbase)
+{
+    unsigned int length;
+    int16_t *pcm = file_load(inpath, &length);
+    if (!pcm)
+    {
+        fprintf(stderr, "Could not load %s!\n", inpath);
+        return 1;
+    }
+
+    // The extension tells the game which format it's getting.
+    char *outpath = malloc(strlen(outbase) + 8);
+    unsigned int num_samples = length / 2;
+    int failed;
+    if (round_trip_snr(pcm, num_samples) >= MIN_SNR_DB)
+    {
+        sprintf(outpath, "%s.adpcm", outbase);
+        failed = encode(inpath, outpath);
+    }
+    else
+    {
+        sprintf(outpath, "%s.pcm", outbase);
+        failed = write_file(outpath, pcm, num_samples * 2);
+    }
+
+    free(outpath);
+    free(pcm);
+    return failed;
+}
+
+int decode(const char * const inpath, const char * const outpath)
+{
+    unsigned int length;
+    uint8_t *adpcm = file_load(inpath, &length);
+    if (!adpcm)
+    {
+        fprintf(stderr, "Could not load %s!\n", inpath);
+        return 1;
+    }
+
+    unsigned int num_samples = length * 2;
+    int16_t *pcm = malloc(sizeof(int16_t) * (num_samples ? num_samples : 1));
+    adpcm_decode(adpcm, num_samples, pcm);
+
+    FILE *fp = fopen(outpath, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Could not open %s for writing!\n", outpath);
+        free(pcm);
+        free(adpcm);
+        return 1;
+    }
+
+    fwrite(pcm, sizeof(int16_t), num_samples, fp);
+    fclose(fp);
+
+    free(pcm);
+    free(adpcm);
+    return 0;
+}
+
+int stats(int count, char **paths)
+{
+    unsigned int total_pcm = 0;
+    unsigned int total_adpcm = 0;
+    int failed = 0;
+
+    unsigned int total_stored = 0;
+
+    printf("%-32s %10s %10s %8s %8s\n", "sound", "pcm bytes", "adpcm", "snr db", "stored");
+    for (int i = 0; i < count; i++)
+    {
+        unsigned int length;
+        int16_t *pcm = file_load(paths[i], &length);
+        if (!pcm)
+        {
+            fprintf(stderr, "Could not load %s!\n", paths[i]);
+            failed = 1;
+            continue;
+        }
+
+        unsigned int num_samples = length / 2;
+        unsigned int encoded_length = adpcm_encoded_length(num_samples);
+        double snr = round_trip_snr(pcm, num_samples);
+        int keep_adpcm = snr >= MIN_SNR_DB;
+
+        printf(
+            "%-32s %10u %10u %8.2f %8s\n",
+            paths[i], num_samples * 2, encoded_length, snr, keep_adpcm ? "adpcm" : "pcm"
+        );
+
+        total_pcm += num_samples * 2;
+        total_adpcm += encoded_length;
+        total_stored += keep_adpcm ? encoded_length : num_samples * 2;
+
+        free(pcm);
+    }
+
+    if (total_pcm > 0)
+    {
+        printf(
+            "%-32s %10u %10u\nAll ADPCM would save %u bytes of sound RAM (%.1f%%), as stored saves %u bytes (%.1f%%).\n",
+            "total", total_pcm, total_adpcm,
+            total_pcm - total_adpcm,
+            100.0 * (double)(total_pcm - total_adpcm) / (double)total_pcm,
+            total_pcm - total_stored,
+            100.0 * (double)(total_pcm - total_stored) / (double)total_pcm
+        );
+    }
+
+    return failed;
+}
+
+void usage(const char * const name)
+{
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "    %s encode <in.raw> <out.adpcm>\n", name);
+    fprintf(stderr, "    %s convert <in.raw> <out>\n", name);
+    fprintf(stderr, "    %s decode <in.adpcm> <out.raw>\n", name);
+    fprintf(stderr, "    %s stats <in.raw> [<in.raw> ...]\n", name);
+    fprintf(stderr, "\nRaw files are signed 16-bit little-endian mono. convert writes <out>.adpcm,\n");
+    fprintf(stderr, "or <out>.pcm if ADPCM would be noisier than %.0f dB SNR.\n", MIN_SNR_DB);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 4 && strcmp(argv[1], "encode") == 0)
+    {
+        return encode(argv[2], argv[3]);
+    }
+    if (argc == 4 && strcmp(argv[1], "convert") == 0)
+    {
+        return convert(argv[2], argv[3]);
+    }
+    if (argc == 4 && strcmp(argv[1], "decode") == 0)
+    {
+        return decode(argv[2], argv[3]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "stats") == 0)
+    {
+        return stats(argc - 2, argv + 2);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
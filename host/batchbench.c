@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "rng.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "control.h"
+#include "batch.h"
+
+// Steps a batch of boards against the same number of plain playfields fed
+// the same drops, and reports board-steps per second for both. With --check,
+// every board is compared against its playfield after every step instead,
+// which is slow enough that it defaults to fewer boards. Boards that finish a
+// game start another one right away, so every step steps every board. A game
+// lasts around 9000 steps, so the default run is long enough for most boards
+// to finish one and start the next, which is where the batch engine spends
+// most of its time solving.
+
+#define DEFAULT_BOARDS 256
+#define DEFAULT_CHECK_BOARDS 32
+#define DEFAULT_STEPS 20000
+#define DEFAULT_SEED 1
+
+static void choose_drops(rng_t *rng, int16_t *drops, unsigned int boards)
+{
+    // Drop somewhere random every so often, and otherwise let the place
+    // timer do it.
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        drops[board] = rng_range(rng, 8) == 0 ? (int16_t)rng_range(rng, BATCH_CELLS) : BATCH_NO_DROP;
+    }
+}
+
+static void scalar_step(control_t *control, int16_t drop)
+{
+    // A drop jumps the cursor there and presses the button, and the rest is
+    // the same tick the game runs.
+    sim_tick_t tick;
+    memset(&tick, 0, sizeof(tick));
+    if (drop != BATCH_NO_DROP)
+    {
+        control->playfield->curx = drop % PLAYFIELD_WIDTH;
+        control->playfield->cury = drop / PLAYFIELD_WIDTH;
+        tick.pressed = INPUT_BUTTON1;
+    }
+    control_tick(control, &tick);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int boards = 0;
+    unsigned int steps = DEFAULT_STEPS;
+    uint32_t seed = DEFAULT_SEED;
+    int check = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--boards") == 0 && i + 1 < argc)
+        {
+            boards = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+        {
+            steps = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else if (strcmp(argv[i], "--check") == 0)
+        {
+            check = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--boards N] [--steps N] [--seed S] [--check]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!boards)
+    {
+        boards = check ? DEFAULT_CHECK_BOARDS : DEFAULT_BOARDS;
+    }
+
+    host_platform_t *hosts = calloc(boards, sizeof(host_platform_t));
+    playfield_t **playfields = calloc(boards, sizeof(playfield_t *));
+    control_t *controls = calloc(boards, sizeof(control_t));
+    host_platform_t quiet;
+    host_platform_init(&quiet, 0);
+    playfield_t *exported = host_playfield_new(&quiet);
+    int16_t *drops = calloc(boards, sizeof(int16_t));
+    uint32_t *next_seed = calloc(boards, sizeof(uint32_t));
+    batch_t *batch = batch_new(boards);
+    unsigned int games = 0;
+    unsigned int mismatches = 0;
+
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        host_platform_init(&hosts[board], 0);
+        playfields[board] = host_playfield_new(&hosts[board]);
+        control_init(&controls[board], playfields[board], 0, 0);
+
+        next_seed[board] = (seed + board) * 2654435761u;
+        playfield_run(playfields[board], next_seed[board]);
+        batch_run(batch, board, next_seed[board]);
+    }
+
+    rng_t rng;
+    rng_seed(&rng, seed);
+    uint64_t scalar_us = 0;
+    uint64_t batch_us = 0;
+
+    for (unsigned int step = 0; step < steps; step++)
+    {
+        choose_drops(&rng, drops, boards);
+
+        uint64_t start = host_wall_us();
+        for (unsigned int board = 0; board < boards; board++)
+        {
+            scalar_step(&controls[board], drops[board]);
+        }
+        scalar_us += host_wall_us() - start;
+
+        start = host_wall_us();
+        batch_step(batch, drops);
+        batch_us += host_wall_us() - start;
+
+        for (unsigned int board = 0; board < boards; board++)
+        {
+            if (check)
+            {
+                batch_export(batch, board, exported);
+                uint32_t expected = playfield_state_hash(playfields[board]);
+                uint32_t actual = playfield_state_hash(exported);
+
+                int sounds_match = 1;
+                for (int sound = 0; sound < PLAYFIELD_SOUND_COUNT; sound++)
+                {
+                    sounds_match &= hosts[board].sounds[sound] == batch->sounds[(sound * boards) + board];
+                }
+
+                if (expected != actual || !sounds_match || playfields[board]->timeleft != exported->timeleft)
+                {
+                    if (mismatches < 10)
+                    {
+                        printf("step %u board %u seed %08x: hash %08x, batch %08x%s\n",
+                            step, board, playfields[board]->seed, expected, actual, sounds_match ? "" : ", sounds differ");
+                    }
+                    mismatches++;
+
+                    // Get back in sync so one mismatch doesn't report forever.
+                    batch_run(batch, board, playfields[board]->seed);
+                    playfield_run(playfields[board], playfields[board]->seed);
+                    memset(hosts[board].sounds, 0, sizeof(hosts[board].sounds));
+                    for (int sound = 0; sound < PLAYFIELD_SOUND_COUNT; sound++)
+                    {
+                        batch->sounds[(sound * boards) + board] = 0;
+                    }
+                    continue;
+                }
+            }
+
+            if (!playfield_running(playfields[board]))
+            {
+                games++;
+                next_seed[board] = next_seed[board] * 1664525u + 1013904223u;
+                playfield_run(playfields[board], next_seed[board]);
+                batch_run(batch, board, next_seed[board]);
+            }
+        }
+    }
+
+    double board_steps = (double)boards * steps;
+    printf("%u boards, %u steps, %u games finished\n", boards, steps, games);
+    printf("scalar: %.3f s, %.0f board-steps/sec\n", scalar_us / 1000000.0, board_steps / (scalar_us / 1000000.0));
+    printf("batch:  %.3f s, %.0f board-steps/sec, %.2fx\n", batch_us / 1000000.0, board_steps / (batch_us / 1000000.0), (double)scalar_us / batch_us);
+    if (check)
+    {
+        printf("%s\n", mismatches ? "Batch boards don't match playfields!" : "Every batch board matched its playfield.");
+    }
+
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        playfield_free(playfields[board]);
+    }
+    playfield_free(exported);
+    batch_free(batch);
+    free(hosts);
+    free(playfields);
+    free(controls);
+    free(drops);
+    free(next_seed);
+    return mismatches ? 1 : 0;
+}
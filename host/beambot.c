@@ -0,0 +1,772 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rng.h"
+#include "sim.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "control.h"
+#include "hint.h"
+
+// A bot that plays as well as it can, for finding out how good a board can
+// get and how much better than everyone else a strong player would do. It
+// drops a block every BOT_DROP_TICKS ticks, and picks where by beam search
+// over the block in hand and the rest of the up next queue. Every level of
+// the search takes the best few cells for each board in the beam (by the
+// placement hint score), plays each of them out on a copy of that board
+// through the same control_tick() the game runs every tick up until the next
+// drop, and keeps the best width of the results for the next level. Nothing past the up next queue is looked at, even though the
+// engine's generator would happily tell us.
+//
+// Playing out the children of a level is split across threads. Every child
+// has its own slot and ties are broken by slot, so the games played are
+// exactly the same no matter how many threads play them. With --scaling the
+// same games are played with 1 thread, then 2, 4 and so on up to the thread
+// count. With --sweep they're played at a range of beam widths instead.
+//
+// Games are played until the board fills up, unless --drops says to stop
+// sooner. Almost every game ends up giving back its score to impossible
+// chains before then, so how long the bot survives and the best score it
+// got to say more about how well it played than the score it ended on.
+
+#define DEFAULT_GAMES 4
+#define DEFAULT_WIDTH 4
+#define DEFAULT_CANDIDATES 12
+#define DEFAULT_SEED 1
+
+// How often the bot drops, about three times a second.
+#define BOT_DROP_TICKS 20
+
+// Give up on a game if the bot somehow keeps it going this long.
+#define MAX_GAME_TICKS (SIM_TICK_RATE * 60 * 30)
+#define MAX_GAME_DROPS (MAX_GAME_TICKS / BOT_DROP_TICKS)
+
+// Widths tried by --sweep, and how many games each one plays unless told
+// otherwise. A handful of games is all noise, one lucky game moves the
+// average more than doubling the width does.
+#define SWEEP_WIDTHS 5
+#define SWEEP_GAMES 32
+static const unsigned int sweep_widths[SWEEP_WIDTHS] = { 1, 2, 4, 8, 16 };
+
+// How a board at the bottom of the search is judged. Lit and impossible
+// blocks are counted for what they'll be worth when they clear, and the rest
+// cost more and more as the board fills up, since a full board ends the
+// game. Lighting anything takes a chain longer than the up next queue, so
+// chains heading in from a source are worth something for every block in
+// them and for every cell closer they are to a source they could light up
+// with.
+#define EVAL_CROWDING 8
+#define EVAL_PROGRESS 3
+#define EVAL_CLOSER 2
+#define EVAL_GAME_OVER -1000000
+
+typedef struct
+{
+    playfield_t *playfield;
+    // The cell dropped on at the top of the search to end up here.
+    int first;
+    int eval;
+    // Which child slot this came from, for breaking ties.
+    unsigned int slot;
+} node_t;
+
+typedef struct
+{
+    // Which beam node a child starts from and where it drops.
+    int parent;
+    int cell;
+} move_t;
+
+typedef struct
+{
+    unsigned int width;
+    unsigned int candidates;
+    unsigned int threads;
+
+    // The boards being searched from, and the ones being searched to, with
+    // room for every candidate of every beam node.
+    node_t *beam;
+    unsigned int beam_count;
+    node_t *children;
+    node_t *sorted;
+    move_t *moves;
+    // Every board gets its own platform, so threads never count sounds in
+    // the same place.
+    host_platform_t *hosts;
+    unsigned int move_count;
+
+    // Scratch space for picking candidates.
+    uint8_t *visited;
+    int *best;
+    int *scores;
+
+    // Handed out to threads a child at a time.
+    unsigned int next_move;
+    uint64_t nodes;
+
+    pthread_t *handles;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    int quit;
+} search_t;
+
+typedef struct
+{
+    int score;
+    int best;
+    unsigned int drops;
+    uint32_t hash;
+} result_t;
+
+// Drops on cell, and then plays out the ticks until the next bot drop, all
+// through the same tick handling the real game runs. The cursor jumps there
+// rather than walking, since getting there isn't what's being searched.
+static void play_drop(playfield_t *playfield, int cell)
+{
+    control_t control;
+    sim_tick_t tick;
+
+    control_init(&control, playfield, 0, 0);
+    memset(&tick, 0, sizeof(tick));
+    playfield->curx = cell % playfield->width;
+    playfield->cury = cell / playfield->width;
+    tick.pressed = INPUT_BUTTON1;
+
+    for (int i = 0; i < BOT_DROP_TICKS; i++)
+    {
+        tick.index = i;
+        if (!(control_tick(&control, &tick) & CONTROL_RUNNING))
+        {
+            break;
+        }
+        tick.pressed = 0;
+    }
+}
+
+typedef struct
+{
+    // The cell just inside a live source, and which side the source is on.
+    int x;
+    int y;
+    unsigned int in;
+    unsigned int color;
+} edge_t;
+
+static int live_sources(playfield_t *playfield, edge_t *edges)
+{
+    int width = playfield->width;
+    int height = playfield->height;
+    int count = 0;
+
+    // Same layout as playfield_set_source().
+    for (int i = 0; i < (width * 2) + (height * 2); i++)
+    {
+        edge_t *edge = &edges[count];
+        edge->color = playfield->sources[i].color;
+        if (edge->color == SOURCE_COLOR_NONE)
+        {
+            continue;
+        }
+
+        if (i < height)
+        {
+            edge->x = 0;
+            edge->y = i;
+            edge->in = PIPE_CONN_W;
+        }
+        else if (i < height * 2)
+        {
+            edge->x = width - 1;
+            edge->y = i - height;
+            edge->in = PIPE_CONN_E;
+        }
+        else if (i < (height * 2) + width)
+        {
+            edge->x = i - (height * 2);
+            edge->y = height - 1;
+            edge->in = PIPE_CONN_S;
+        }
+        else
+        {
+            edge->x = i - ((height * 2) + width);
+            edge->y = 0;
+            edge->in = PIPE_CONN_N;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+// Follow the unlit chain leading in from a source, and return how many
+// blocks are in it. Leaves x, y on the cell the chain would carry on into,
+// and returns -1 if the chain can't carry on at all.
+static int chain_length(playfield_t *playfield, int *x, int *y, unsigned int in)
+{
+    int length = 0;
+    while (*x >= 0 && *y >= 0 && *x < playfield->width && *y < playfield->height)
+    {
+        playfield_entry_t *cur = playfield_entry(playfield, *x, *y);
+        if (cur->block == BLOCK_TYPE_NONE)
+        {
+            return length;
+        }
+        if (cur->color != SOURCE_COLOR_NONE || (cur->pipe & in) == 0 || length >= playfield->width * playfield->height)
+        {
+            return -1;
+        }
+        length++;
+
+        switch(cur->pipe & (~in))
+        {
+            case PIPE_CONN_N:
+                (*y)--;
+                in = PIPE_CONN_S;
+                break;
+            case PIPE_CONN_S:
+                (*y)++;
+                in = PIPE_CONN_N;
+                break;
+            case PIPE_CONN_E:
+                (*x)++;
+                in = PIPE_CONN_W;
+                break;
+            case PIPE_CONN_W:
+                (*x)--;
+                in = PIPE_CONN_E;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    return -1;
+}
+
+// Chains heading in from a source are worth more the longer they are and
+// the closer they've gotten to some other source they could light up with.
+static int progress(playfield_t *playfield)
+{
+    edge_t edges[(PLAYFIELD_WIDTH * 2) + (PLAYFIELD_HEIGHT * 2)];
+    int count = live_sources(playfield, edges);
+    int value = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int x = edges[i].x;
+        int y = edges[i].y;
+        int length = chain_length(playfield, &x, &y, edges[i].in);
+        if (length <= 0)
+        {
+            continue;
+        }
+
+        int closest = playfield->width + playfield->height;
+        for (int j = 0; j < count; j++)
+        {
+            unsigned int both = edges[i].color & edges[j].color;
+            if (j == i || (both != edges[i].color && both != edges[j].color))
+            {
+                continue;
+            }
+
+            int distance = abs(x - edges[j].x) + abs(y - edges[j].y);
+            if (distance < closest)
+            {
+                closest = distance;
+            }
+        }
+
+        value += (length * EVAL_PROGRESS) + ((playfield->width + playfield->height - closest) * EVAL_CLOSER);
+    }
+
+    return value;
+}
+
+static int evaluate(playfield_t *playfield)
+{
+    static const int mult[8] = {0, 1, 1, 2, 1, 2, 2, 4};
+
+    if (!playfield_running(playfield))
+    {
+        return EVAL_GAME_OVER + playfield->score;
+    }
+
+    int eval = playfield->score + progress(playfield);
+    int occupied = 0;
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        playfield_entry_t *cur = playfield->entries + i;
+        if (cur->block == BLOCK_TYPE_NONE)
+        {
+            continue;
+        }
+
+        if (cur->color == SOURCE_COLOR_IMPOSSIBLE)
+        {
+            eval -= 5;
+        }
+        else if (cur->color != SOURCE_COLOR_NONE)
+        {
+            eval += mult[cur->color & 7] * 5;
+        }
+        else
+        {
+            occupied++;
+        }
+    }
+
+    return eval - ((occupied * occupied) / EVAL_CROWDING);
+}
+
+static void search_work(search_t *search)
+{
+    unsigned int played = 0;
+    while (1)
+    {
+        unsigned int which = __atomic_fetch_add(&search->next_move, 1, __ATOMIC_RELAXED);
+        if (which >= search->move_count)
+        {
+            break;
+        }
+
+        move_t *move = &search->moves[which];
+        node_t *parent = &search->beam[move->parent];
+        node_t *child = &search->children[which];
+
+        playfield_copy(child->playfield, parent->playfield);
+        play_drop(child->playfield, move->cell);
+
+        child->first = parent->first < 0 ? move->cell : parent->first;
+        child->slot = which;
+        child->eval = evaluate(child->playfield);
+        played++;
+    }
+
+    __atomic_fetch_add(&search->nodes, played, __ATOMIC_RELAXED);
+}
+
+static void *search_thread(void *param)
+{
+    search_t *search = (search_t *)param;
+
+    while (1)
+    {
+        pthread_barrier_wait(&search->start);
+        if (search->quit)
+        {
+            break;
+        }
+        search_work(search);
+        pthread_barrier_wait(&search->done);
+    }
+
+    return 0;
+}
+
+static search_t *search_new(unsigned int width, unsigned int candidates, unsigned int threads)
+{
+    search_t *search = malloc(sizeof(search_t));
+    memset(search, 0, sizeof(search_t));
+    search->width = width;
+    search->candidates = candidates;
+    search->threads = threads;
+
+    unsigned int slots = width * candidates;
+    search->beam = malloc(sizeof(node_t) * width);
+    search->children = malloc(sizeof(node_t) * slots);
+    search->sorted = malloc(sizeof(node_t) * slots);
+    search->moves = malloc(sizeof(move_t) * slots);
+    search->hosts = malloc(sizeof(host_platform_t) * (width + slots));
+    search->visited = calloc(PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT, 1);
+    search->best = malloc(sizeof(int) * candidates);
+    search->scores = malloc(sizeof(int) * candidates);
+
+    for (unsigned int i = 0; i < width + slots; i++)
+    {
+        host_platform_init(&search->hosts[i], 0);
+    }
+    for (unsigned int i = 0; i < width; i++)
+    {
+        search->beam[i].playfield = host_playfield_new(&search->hosts[i]);
+    }
+    for (unsigned int i = 0; i < slots; i++)
+    {
+        search->children[i].playfield = host_playfield_new(&search->hosts[width + i]);
+    }
+
+    // The calling thread plays its share too, so start one less.
+    pthread_barrier_init(&search->start, 0, threads);
+    pthread_barrier_init(&search->done, 0, threads);
+    search->handles = malloc(sizeof(pthread_t) * threads);
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        pthread_create(&search->handles[i], 0, &search_thread, search);
+    }
+
+    return search;
+}
+
+static void search_free(search_t *search)
+{
+    search->quit = 1;
+    pthread_barrier_wait(&search->start);
+    for (unsigned int i = 1; i < search->threads; i++)
+    {
+        pthread_join(search->handles[i], 0);
+    }
+    pthread_barrier_destroy(&search->start);
+    pthread_barrier_destroy(&search->done);
+
+    for (unsigned int i = 0; i < search->width; i++)
+    {
+        playfield_free(search->beam[i].playfield);
+    }
+    for (unsigned int i = 0; i < search->width * search->candidates; i++)
+    {
+        playfield_free(search->children[i].playfield);
+    }
+    free(search->beam);
+    free(search->children);
+    free(search->sorted);
+    free(search->moves);
+    free(search->hosts);
+    free(search->visited);
+    free(search->best);
+    free(search->scores);
+    free(search->handles);
+    free(search);
+}
+
+static void add_candidates(search_t *search, int parent)
+{
+    playfield_t *playfield = search->beam[parent].playfield;
+    int *best = search->best;
+    int *scores = search->scores;
+    unsigned int count = 0;
+
+    // Keep the top few cells by placement hint score, in cell order when
+    // they tie so the search doesn't depend on anything but the board.
+    for (int cell = 0; cell < playfield->width * playfield->height; cell++)
+    {
+        if (playfield->entries[cell].block != BLOCK_TYPE_NONE)
+        {
+            continue;
+        }
+
+        int score = hint_evaluate(playfield, search->visited, cell % playfield->width, cell / playfield->width, playfield->upnext[0].pipe);
+        unsigned int at = count;
+        while (at > 0 && scores[at - 1] < score)
+        {
+            at--;
+        }
+        if (at >= search->candidates)
+        {
+            continue;
+        }
+
+        unsigned int last = count < search->candidates ? count : search->candidates - 1;
+        memmove(&best[at + 1], &best[at], sizeof(int) * (last - at));
+        memmove(&scores[at + 1], &scores[at], sizeof(int) * (last - at));
+        best[at] = cell;
+        scores[at] = score;
+        if (count < search->candidates)
+        {
+            count++;
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        search->moves[search->move_count].parent = parent;
+        search->moves[search->move_count].cell = best[i];
+        search->move_count++;
+    }
+}
+
+static int compare_children(const void *a, const void *b)
+{
+    const node_t *first = (const node_t *)a;
+    const node_t *second = (const node_t *)b;
+    if (first->eval != second->eval)
+    {
+        return first->eval > second->eval ? -1 : 1;
+    }
+    return first->slot < second->slot ? -1 : 1;
+}
+
+// Where to drop the block in hand, or -1 if there's nowhere.
+static int search_move(search_t *search, playfield_t *playfield)
+{
+    playfield_copy(search->beam[0].playfield, playfield);
+    search->beam[0].first = -1;
+    search->beam_count = 1;
+
+    int move = -1;
+    for (int depth = 0; depth < UPNEXT_AMOUNT; depth++)
+    {
+        search->move_count = 0;
+        for (unsigned int i = 0; i < search->beam_count; i++)
+        {
+            if (playfield_running(search->beam[i].playfield))
+            {
+                add_candidates(search, i);
+            }
+        }
+        if (search->move_count == 0)
+        {
+            break;
+        }
+
+        // Play every child out, on every thread.
+        search->next_move = 0;
+        if (search->threads > 1)
+        {
+            pthread_barrier_wait(&search->start);
+            search_work(search);
+            pthread_barrier_wait(&search->done);
+        }
+        else
+        {
+            search_work(search);
+        }
+
+        node_t *sorted = search->sorted;
+        memcpy(sorted, search->children, sizeof(node_t) * search->move_count);
+        qsort(sorted, search->move_count, sizeof(node_t), &compare_children);
+        move = sorted[0].first;
+
+        search->beam_count = search->move_count < search->width ? search->move_count : search->width;
+        for (unsigned int i = 0; i < search->beam_count; i++)
+        {
+            playfield_copy(search->beam[i].playfield, sorted[i].playfield);
+            search->beam[i].first = sorted[i].first;
+            search->beam[i].eval = sorted[i].eval;
+        }
+    }
+
+    return move;
+}
+
+static void play_game(search_t *search, playfield_t *playfield, uint32_t seed, unsigned int max_drops, result_t *result)
+{
+    playfield_run(playfield, seed);
+    result->best = 0;
+    for (result->drops = 0; result->drops < max_drops && playfield_running(playfield); result->drops++)
+    {
+        int move = search_move(search, playfield);
+        if (move < 0)
+        {
+            break;
+        }
+
+        play_drop(playfield, move);
+        result->best = playfield->score > result->best ? playfield->score : result->best;
+    }
+
+    playfield_stop(playfield);
+    result->score = playfield->score;
+    result->hash = playfield_state_hash(playfield);
+}
+
+typedef struct
+{
+    double sum;
+    double squares;
+} tally_t;
+
+static void tally_add(tally_t *tally, double value)
+{
+    tally->sum += value;
+    tally->squares += value * value;
+}
+
+static double tally_mean(tally_t *tally, unsigned int count)
+{
+    return tally->sum / count;
+}
+
+static double tally_error(tally_t *tally, unsigned int count)
+{
+    // Standard error of the mean, so a sweep shows whether a difference
+    // between widths is bigger than the difference between seeds.
+    if (count < 2)
+    {
+        return 0.0;
+    }
+
+    double mean = tally->sum / count;
+    double variance = (tally->squares - (count * mean * mean)) / (count - 1);
+    return variance > 0.0 ? sqrt(variance / count) : 0.0;
+}
+
+typedef struct
+{
+    tally_t score;
+    tally_t best;
+    tally_t drops;
+    uint64_t nodes;
+    uint64_t elapsed;
+    uint32_t hash;
+} run_t;
+
+static void play_games(unsigned int games, uint32_t seed, unsigned int max_drops, unsigned int width, unsigned int candidates, unsigned int threads, int verbose, run_t *run)
+{
+    search_t *search = search_new(width, candidates, threads);
+    host_platform_t host;
+    host_platform_init(&host, 0);
+    playfield_t *playfield = host_playfield_new(&host);
+
+    uint32_t hash = 2166136261u;
+    memset(run, 0, sizeof(run_t));
+    uint64_t start = host_wall_us();
+    for (unsigned int game = 0; game < games; game++)
+    {
+        result_t result;
+        play_game(search, playfield, (seed + game) * 2654435761u, max_drops, &result);
+        tally_add(&run->score, result.score);
+        tally_add(&run->best, result.best);
+        tally_add(&run->drops, result.drops);
+        hash = (hash ^ (uint32_t)result.score) * 16777619u;
+        hash = (hash ^ result.hash) * 16777619u;
+
+        if (verbose)
+        {
+            printf("game %3u: score %5d (best %5d) after %4u drops, board %08x\n", game, result.score, result.best, result.drops, result.hash);
+        }
+    }
+
+    run->elapsed = host_wall_us() - start;
+    run->nodes = search->nodes;
+    run->hash = hash;
+
+    playfield_free(playfield);
+    search_free(search);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int games = 0;
+    unsigned int width = DEFAULT_WIDTH;
+    unsigned int candidates = DEFAULT_CANDIDATES;
+    unsigned int drops = MAX_GAME_DROPS;
+    uint32_t seed = DEFAULT_SEED;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = cores > 0 ? cores : 1;
+    int scaling = 0;
+    int sweep = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            games = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+        {
+            width = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--candidates") == 0 && i + 1 < argc)
+        {
+            candidates = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--drops") == 0 && i + 1 < argc)
+        {
+            drops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--scaling") == 0)
+        {
+            scaling = 1;
+        }
+        else if (strcmp(argv[i], "--sweep") == 0)
+        {
+            sweep = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--games N] [--width N] [--candidates N] [--drops N] [--seed S] [--threads N] [--scaling] [--sweep]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (width == 0 || candidates == 0 || drops == 0 || threads == 0)
+    {
+        fprintf(stderr, "Need at least one width, candidate, drop and thread!\n");
+        return 1;
+    }
+    if (games == 0)
+    {
+        games = sweep ? SWEEP_GAMES : DEFAULT_GAMES;
+    }
+
+    run_t run;
+    int failed = 0;
+
+    if (scaling)
+    {
+        uint64_t single = 0;
+        uint32_t expected = 0;
+
+        printf("threads  seconds   nodes/sec  speedup  efficiency  results\n");
+        for (unsigned int count = 1; ; count = (count * 2 > threads && count < threads) ? threads : count * 2)
+        {
+            play_games(games, seed, drops, width, candidates, count, 0, &run);
+            if (count == 1)
+            {
+                single = run.elapsed;
+                expected = run.hash;
+            }
+            failed |= run.hash != expected;
+
+            double speedup = (double)single / (double)run.elapsed;
+            printf("%7u %8.3f %11.0f %7.2fx %10.1f%%  %08x %s\n",
+                count, run.elapsed / 1000000.0, run.nodes / (run.elapsed / 1000000.0), speedup, (100.0 * speedup) / count,
+                run.hash, run.hash == expected ? "ok" : "MISMATCH");
+
+            if (count >= threads)
+            {
+                break;
+            }
+        }
+    }
+    else if (sweep)
+    {
+        printf("%u games at every width, averages give or take one standard error\n", games);
+        printf("width           score            best           drops   nodes/sec  seconds\n");
+        for (int i = 0; i < SWEEP_WIDTHS; i++)
+        {
+            play_games(games, seed, drops, sweep_widths[i], candidates, threads, 0, &run);
+            printf("%5u %7.1f +/- %5.1f %7.1f +/- %5.1f %7.1f +/- %5.1f %11.0f %8.3f\n", sweep_widths[i],
+                tally_mean(&run.score, games), tally_error(&run.score, games),
+                tally_mean(&run.best, games), tally_error(&run.best, games),
+                tally_mean(&run.drops, games), tally_error(&run.drops, games),
+                run.nodes / (run.elapsed / 1000000.0), run.elapsed / 1000000.0);
+        }
+    }
+    else
+    {
+        play_games(games, seed, drops, width, candidates, threads, 1, &run);
+        printf("%u games at width %u on %u threads in %.3f s, avg score %.1f, avg best %.1f, avg drops %.1f, %llu nodes, %.0f nodes/sec, results %08x\n",
+            games, width, threads, run.elapsed / 1000000.0, tally_mean(&run.score, games), tally_mean(&run.best, games),
+            tally_mean(&run.drops, games), (unsigned long long)run.nodes,
+            run.nodes / (run.elapsed / 1000000.0), run.hash);
+    }
+
+    if (failed)
+    {
+        printf("Results changed with the number of threads!\n");
+    }
+    return failed ? 1 : 0;
+}
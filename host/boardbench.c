@@ -0,0 +1,640 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "naomi/video.h"
+#include "rng.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "hint.h"
+#include "draw.h"
+
+// Times the engine's per-tick work one call at a time on every board in a
+// checked in corpus, from empty and full boards through to the longest and
+// nastiest beams the solver can be handed, and reports ns per call with how
+// much that wandered between samples. Every call starts from the same board,
+// so putting it back is timed on its own and taken off. --csv writes the
+// numbers out and --baseline reads a file written that way by an earlier
+// build and shows how much every number moved. --generate prints the corpus
+// the checked in one was made from. Placement hints are timed as a full
+// pass over every cell, and how many cells that scores a millisecond is
+// summed up at the end.
+
+#define DEFAULT_CORPUS "host/corpus/boards.txt"
+#define DEFAULT_SAMPLES 25
+#define MAX_BOARDS 64
+#define MAX_NAME 32
+
+// Roughly how long every sample should take, so fast calls get repeated
+// enough to drown out the clock.
+#define SAMPLE_NS 200000
+
+// The seed every corpus board's game is started with, so the up next
+// blocks and drops are the same every run.
+#define BOARD_SEED 1
+
+typedef struct
+{
+    char name[MAX_NAME];
+    unsigned int pipes[PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT];
+} board_t;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(playfield_t *playfield);
+} op_t;
+
+typedef struct
+{
+    double mean;
+    double stddev;
+    double min;
+} timing_t;
+
+typedef struct
+{
+    char board[MAX_NAME];
+    char op[MAX_NAME];
+    double mean;
+} previous_t;
+
+static sprites_t sprites;
+static hint_t hint;
+static int hint_scored;
+
+static char pipe_char(unsigned int pipe)
+{
+    switch (pipe)
+    {
+        case PIPE_CONN_N | PIPE_CONN_S:
+            return '|';
+        case PIPE_CONN_E | PIPE_CONN_W:
+            return '-';
+        case PIPE_CONN_N | PIPE_CONN_E:
+            return 'L';
+        case PIPE_CONN_N | PIPE_CONN_W:
+            return 'J';
+        case PIPE_CONN_S | PIPE_CONN_E:
+            return 'r';
+        case PIPE_CONN_S | PIPE_CONN_W:
+            return '7';
+        default:
+            return '.';
+    }
+}
+
+static int char_pipe(char c)
+{
+    switch (c)
+    {
+        case '|':
+            return PIPE_CONN_N | PIPE_CONN_S;
+        case '-':
+            return PIPE_CONN_E | PIPE_CONN_W;
+        case 'L':
+            return PIPE_CONN_N | PIPE_CONN_E;
+        case 'J':
+            return PIPE_CONN_N | PIPE_CONN_W;
+        case 'r':
+            return PIPE_CONN_S | PIPE_CONN_E;
+        case '7':
+            return PIPE_CONN_S | PIPE_CONN_W;
+        case '.':
+            return PIPE_CONN_NONE;
+        default:
+            return -1;
+    }
+}
+
+static void print_board(board_t *board)
+{
+    printf("board %s\n", board->name);
+    for (int y = 0; y < PLAYFIELD_HEIGHT; y++)
+    {
+        for (int x = 0; x < PLAYFIELD_WIDTH; x++)
+        {
+            putchar(pipe_char(board->pipes[(y * PLAYFIELD_WIDTH) + x]));
+        }
+        putchar('\n');
+    }
+    putchar('\n');
+}
+
+static void generate_random(board_t *board, const char *name, rng_t *rng, unsigned int percent)
+{
+    static const unsigned int shapes[6] = {
+        PIPE_CONN_N | PIPE_CONN_S, PIPE_CONN_E | PIPE_CONN_W,
+        PIPE_CONN_N | PIPE_CONN_E, PIPE_CONN_N | PIPE_CONN_W,
+        PIPE_CONN_S | PIPE_CONN_E, PIPE_CONN_S | PIPE_CONN_W,
+    };
+
+    memset(board, 0, sizeof(board_t));
+    strcpy(board->name, name);
+    for (int cell = 0; cell < PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT; cell++)
+    {
+        if (rng_range(rng, 100) < percent)
+        {
+            board->pipes[cell] = shapes[rng_range(rng, 6)];
+        }
+    }
+}
+
+static void generate_serpentine(board_t *board, const char *name, int top, int bottom)
+{
+    // One beam that comes in from the west on the top row and zigzags down
+    // every row to leave on the bottom one.
+    memset(board, 0, sizeof(board_t));
+    strcpy(board->name, name);
+    for (int y = top; y <= bottom; y++)
+    {
+        int east = ((y - top) % 2) == 0;
+        for (int x = 0; x < PLAYFIELD_WIDTH; x++)
+        {
+            int first = east ? x == 0 : x == PLAYFIELD_WIDTH - 1;
+            int last = east ? x == PLAYFIELD_WIDTH - 1 : x == 0;
+            unsigned int in = first ? (y == top ? PIPE_CONN_W : PIPE_CONN_N) : (east ? PIPE_CONN_W : PIPE_CONN_E);
+            unsigned int out = last ? (y == bottom ? PIPE_CONN_E : PIPE_CONN_S) : (east ? PIPE_CONN_E : PIPE_CONN_W);
+            board->pipes[(y * PLAYFIELD_WIDTH) + x] = in | out;
+        }
+    }
+}
+
+static void generate_lines(board_t *board, const char *name, unsigned int pipe)
+{
+    memset(board, 0, sizeof(board_t));
+    strcpy(board->name, name);
+    for (int cell = 0; cell < PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT; cell++)
+    {
+        board->pipes[cell] = pipe;
+    }
+}
+
+static void generate_small_loops(board_t *board, const char *name)
+{
+    // As many two by two loops as fit.
+    static const unsigned int corners[2][2] = {
+        { PIPE_CONN_S | PIPE_CONN_E, PIPE_CONN_S | PIPE_CONN_W },
+        { PIPE_CONN_N | PIPE_CONN_E, PIPE_CONN_N | PIPE_CONN_W },
+    };
+
+    memset(board, 0, sizeof(board_t));
+    strcpy(board->name, name);
+    for (int y = 0; y < (PLAYFIELD_HEIGHT & ~1); y++)
+    {
+        for (int x = 0; x < (PLAYFIELD_WIDTH & ~1); x++)
+        {
+            board->pipes[(y * PLAYFIELD_WIDTH) + x] = corners[y & 1][x & 1];
+        }
+    }
+}
+
+static void generate_rings(board_t *board, const char *name)
+{
+    // Loops inside loops, as big as the board allows.
+    memset(board, 0, sizeof(board_t));
+    strcpy(board->name, name);
+    for (int depth = 0; (PLAYFIELD_WIDTH - (2 * depth)) >= 2 && (PLAYFIELD_HEIGHT - (2 * depth)) >= 2; depth++)
+    {
+        int left = depth;
+        int right = PLAYFIELD_WIDTH - 1 - depth;
+        int top = depth;
+        int bottom = PLAYFIELD_HEIGHT - 1 - depth;
+
+        for (int x = left + 1; x < right; x++)
+        {
+            board->pipes[(top * PLAYFIELD_WIDTH) + x] = PIPE_CONN_E | PIPE_CONN_W;
+            board->pipes[(bottom * PLAYFIELD_WIDTH) + x] = PIPE_CONN_E | PIPE_CONN_W;
+        }
+        for (int y = top + 1; y < bottom; y++)
+        {
+            board->pipes[(y * PLAYFIELD_WIDTH) + left] = PIPE_CONN_N | PIPE_CONN_S;
+            board->pipes[(y * PLAYFIELD_WIDTH) + right] = PIPE_CONN_N | PIPE_CONN_S;
+        }
+        board->pipes[(top * PLAYFIELD_WIDTH) + left] = PIPE_CONN_S | PIPE_CONN_E;
+        board->pipes[(top * PLAYFIELD_WIDTH) + right] = PIPE_CONN_S | PIPE_CONN_W;
+        board->pipes[(bottom * PLAYFIELD_WIDTH) + left] = PIPE_CONN_N | PIPE_CONN_E;
+        board->pipes[(bottom * PLAYFIELD_WIDTH) + right] = PIPE_CONN_N | PIPE_CONN_W;
+    }
+}
+
+static int generate_corpus()
+{
+    board_t board;
+    rng_t rng;
+    rng_seed(&rng, BOARD_SEED);
+
+    printf("# Boards for boardbench, one pipe per character: | - L J r 7 and . for\n");
+    printf("# nothing. Made with boardbench --generate, and the sources around the\n");
+    printf("# edge are always the ones a real game starts with.\n\n");
+
+    generate_lines(&board, "empty", PIPE_CONN_NONE);
+    print_board(&board);
+    generate_random(&board, "random_25", &rng, 25);
+    print_board(&board);
+    generate_random(&board, "random_50", &rng, 50);
+    print_board(&board);
+    generate_random(&board, "random_75", &rng, 75);
+    print_board(&board);
+    generate_random(&board, "full", &rng, 100);
+    print_board(&board);
+
+    // The longest lit beam the sources allow, and one that fills the board
+    // and runs off into the dark at both ends.
+    generate_serpentine(&board, "serpentine_lit", 1, PLAYFIELD_HEIGHT - 2);
+    print_board(&board);
+    generate_serpentine(&board, "serpentine_dark", 0, PLAYFIELD_HEIGHT - 1);
+    print_board(&board);
+
+    // Every row or column one straight beam, most of which join sources that
+    // don't agree or have no source at all.
+    generate_lines(&board, "rows", PIPE_CONN_E | PIPE_CONN_W);
+    print_board(&board);
+    generate_lines(&board, "columns", PIPE_CONN_N | PIPE_CONN_S);
+    print_board(&board);
+
+    generate_small_loops(&board, "small_loops");
+    print_board(&board);
+    generate_rings(&board, "rings");
+    print_board(&board);
+
+    return 0;
+}
+
+static int load_corpus(const char *path, board_t *boards)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Can't open %s!\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+    int row = -1;
+    int lineno = 0;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineno++;
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '#' || (line[0] == 0 && row < 0))
+        {
+            continue;
+        }
+
+        if (row < 0)
+        {
+            if (strncmp(line, "board ", 6) != 0 || strlen(line + 6) >= MAX_NAME || count == MAX_BOARDS)
+            {
+                fprintf(stderr, "%s:%d: expected a board!\n", path, lineno);
+                fclose(fp);
+                return -1;
+            }
+            memset(&boards[count], 0, sizeof(board_t));
+            strcpy(boards[count].name, line + 6);
+            row = 0;
+            continue;
+        }
+
+        if (strlen(line) != PLAYFIELD_WIDTH)
+        {
+            fprintf(stderr, "%s:%d: rows have to be %d wide!\n", path, lineno, PLAYFIELD_WIDTH);
+            fclose(fp);
+            return -1;
+        }
+        for (int x = 0; x < PLAYFIELD_WIDTH; x++)
+        {
+            int pipe = char_pipe(line[x]);
+            if (pipe < 0)
+            {
+                fprintf(stderr, "%s:%d: unknown pipe '%c'!\n", path, lineno, line[x]);
+                fclose(fp);
+                return -1;
+            }
+            boards[count].pipes[(row * PLAYFIELD_WIDTH) + x] = pipe;
+        }
+
+        if (++row == PLAYFIELD_HEIGHT)
+        {
+            count++;
+            row = -1;
+        }
+    }
+    fclose(fp);
+
+    if (row >= 0)
+    {
+        fprintf(stderr, "%s: board %s is missing rows!\n", path, boards[count].name);
+        return -1;
+    }
+    return count;
+}
+
+static void setup_board(playfield_t *playfield, board_t *board)
+{
+    // A real game for the sources and up next blocks, with the corpus board
+    // in place of whatever it started with and solved once so the colors
+    // are what they'd be in the middle of a game.
+    playfield_run(playfield, BOARD_SEED);
+    for (int cell = 0; cell < PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT; cell++)
+    {
+        playfield_entry_t *entry = playfield->entries + cell;
+        memset(entry, 0, sizeof(playfield_entry_t));
+        if (board->pipes[cell] != PIPE_CONN_NONE)
+        {
+            entry->block = BLOCK_TYPE_PURPLE + (cell % 4);
+            entry->pipe = board->pipes[cell];
+        }
+    }
+    playfield_rehash(playfield);
+    playfield_check_connections(playfield);
+    playfield->timeleft = 0.0;
+}
+
+static void restore_board(playfield_t *playfield, playfield_t *original)
+{
+    // A whole copy, since the colors and active cells have to stay in step
+    // with the entries for the next solve to only look at what changed.
+    playfield_copy(playfield, original);
+}
+
+static void run_nothing(playfield_t *playfield)
+{
+    // Only putting the board back, which is taken off everything else.
+}
+
+static void run_check_connections(playfield_t *playfield)
+{
+    playfield_check_connections(playfield);
+}
+
+static void run_age(playfield_t *playfield)
+{
+    playfield_age(playfield);
+}
+
+static void run_gravity(playfield_t *playfield)
+{
+    playfield_apply_gravity(playfield);
+}
+
+static void run_drop_anywhere(playfield_t *playfield)
+{
+    playfield_drop_anywhere(playfield);
+}
+
+static void run_hint(playfield_t *playfield)
+{
+    // Start over every time, with no budget to speak of.
+    hint.next = 0;
+    hint_scored = hint_update(&hint, UINT32_MAX);
+}
+
+static void run_draw(playfield_t *playfield)
+{
+    playfield_draw(0, 0, playfield, 0, &sprites, &hint, 0.5);
+}
+
+static const op_t ops[] = {
+    { "check_connections", &run_check_connections },
+    { "age", &run_age },
+    { "apply_gravity", &run_gravity },
+    { "drop_anywhere", &run_drop_anywhere },
+    { "hint", &run_hint },
+    { "draw", &run_draw },
+};
+
+#define OP_COUNT (sizeof(ops) / sizeof(ops[0]))
+
+static uint64_t time_reps(playfield_t *playfield, playfield_t *original, void (*run)(playfield_t *), unsigned int reps)
+{
+    uint64_t start = host_wall_ns();
+    for (unsigned int rep = 0; rep < reps; rep++)
+    {
+        restore_board(playfield, original);
+        run(playfield);
+    }
+    return host_wall_ns() - start;
+}
+
+static timing_t time_op(playfield_t *playfield, playfield_t *original, void (*run)(playfield_t *), unsigned int samples, double overhead)
+{
+    // Work out how many calls fill up a sample, then take that many samples.
+    unsigned int reps = 1;
+    while (reps < (1 << 24) && time_reps(playfield, original, run, reps) < SAMPLE_NS)
+    {
+        reps *= 2;
+    }
+
+    double sum = 0.0;
+    double squares = 0.0;
+    timing_t timing;
+    timing.min = 0.0;
+
+    for (unsigned int sample = 0; sample < samples; sample++)
+    {
+        double ns = ((double)time_reps(playfield, original, run, reps) / reps) - overhead;
+        sum += ns;
+        squares += ns * ns;
+        if (sample == 0 || ns < timing.min)
+        {
+            timing.min = ns;
+        }
+    }
+
+    timing.mean = sum / samples;
+    double variance = (squares / samples) - (timing.mean * timing.mean);
+    timing.stddev = variance > 0.0 ? sqrt(variance) : 0.0;
+    return timing;
+}
+
+static int load_baseline(const char *path, previous_t *previous, int max)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Can't open %s!\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+    while (count < max && fgets(line, sizeof(line), fp))
+    {
+        // Skips the header, and anything else that doesn't look like a row.
+        if (sscanf(line, "%31[^,],%31[^,],%lf", previous[count].board, previous[count].op, &previous[count].mean) == 3)
+        {
+            count++;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+static previous_t *find_baseline(previous_t *previous, int count, const char *board, const char *op)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(previous[i].board, board) == 0 && strcmp(previous[i].op, op) == 0)
+        {
+            return &previous[i];
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *corpus = DEFAULT_CORPUS;
+    const char *csv = 0;
+    const char *baseline = 0;
+    const char *only = 0;
+    unsigned int samples = DEFAULT_SAMPLES;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+        {
+            corpus = argv[++i];
+        }
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+        {
+            samples = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc)
+        {
+            only = argv[++i];
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csv = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline = argv[++i];
+        }
+        else if (strcmp(argv[i], "--generate") == 0)
+        {
+            return generate_corpus();
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--corpus FILE] [--samples N] [--board NAME] [--csv FILE] [--baseline FILE] [--generate]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (samples < 2)
+    {
+        samples = 2;
+    }
+
+    static board_t boards[MAX_BOARDS];
+    int count = load_corpus(corpus, boards);
+    if (count < 0)
+    {
+        return 1;
+    }
+
+    static previous_t previous[MAX_BOARDS * OP_COUNT];
+    int previous_count = 0;
+    if (baseline)
+    {
+        previous_count = load_baseline(baseline, previous, MAX_BOARDS * OP_COUNT);
+        if (previous_count < 0)
+        {
+            return 1;
+        }
+    }
+
+    FILE *out = 0;
+    if (csv)
+    {
+        out = fopen(csv, "w");
+        if (!out)
+        {
+            fprintf(stderr, "Can't write %s!\n", csv);
+            return 1;
+        }
+        fprintf(out, "board,op,mean_ns,stddev_ns,min_ns,samples\n");
+    }
+
+    // Nothing actually gets drawn, but the sprites still have to be there
+    // for the draw code to pick between them.
+    static uint16_t pixels[BLOCK_WIDTH * BLOCK_HEIGHT];
+    void **sprite = (void **)&sprites;
+    for (unsigned int i = 0; i < sizeof(sprites_t) / sizeof(void *); i++)
+    {
+        sprite[i] = pixels;
+    }
+
+    host_platform_t host;
+    host_platform_init(&host, 0);
+    playfield_t *original = host_playfield_new(&host);
+    playfield_t *playfield = host_playfield_new(&host);
+    hint_init(&hint, playfield);
+    double hint_evaluations = 0.0;
+    double hint_ns = 0.0;
+
+    printf("%-18s %-18s %10s %10s %6s %10s", "board", "op", "ns/op", "stddev", "cv", "min");
+    printf(baseline ? " %10s\n" : "\n", "change");
+
+    for (int b = 0; b < count; b++)
+    {
+        if (only && strcmp(only, boards[b].name) != 0)
+        {
+            continue;
+        }
+
+        setup_board(original, &boards[b]);
+        setup_board(playfield, &boards[b]);
+        timing_t overhead = time_op(playfield, original, &run_nothing, samples, 0.0);
+
+        for (unsigned int o = 0; o < OP_COUNT; o++)
+        {
+            timing_t timing = time_op(playfield, original, ops[o].run, samples, overhead.mean);
+            if (ops[o].run == &run_hint)
+            {
+                hint_evaluations += hint_scored;
+                hint_ns += timing.mean;
+            }
+
+            printf("%-18s %-18s %10.1f %10.1f %5.1f%% %10.1f", boards[b].name, ops[o].name,
+                timing.mean, timing.stddev, timing.mean > 0.0 ? (timing.stddev * 100.0) / timing.mean : 0.0, timing.min);
+            if (baseline)
+            {
+                previous_t *before = find_baseline(previous, previous_count, boards[b].name, ops[o].name);
+                if (before && before->mean > 0.0)
+                {
+                    printf(" %+9.1f%%", ((timing.mean - before->mean) * 100.0) / before->mean);
+                }
+                else
+                {
+                    printf(" %10s", "new");
+                }
+            }
+            printf("\n");
+
+            if (out)
+            {
+                fprintf(out, "%s,%s,%.1f,%.1f,%.1f,%u\n", boards[b].name, ops[o].name, timing.mean, timing.stddev, timing.min, samples);
+            }
+        }
+    }
+
+    if (hint_ns > 0.0)
+    {
+        printf("hint: %.0f evaluations/ms\n", (hint_evaluations * 1000000.0) / hint_ns);
+    }
+
+    if (out)
+    {
+        fclose(out);
+    }
+    hint_free(&hint);
+    playfield_free(original);
+    playfield_free(playfield);
+    return 0;
+}
@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rng.h"
+#include "sim.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "control.h"
+
+// Plays lots of independent games spread out over every core, and reports
+// how scores and game lengths are distributed. Every game gets its own
+// playfield and its own seed based on which game it is, so the results are
+// exactly the same no matter how many threads play them. With --scaling,
+// the same games are played with 1 thread, then 2, 4 and so on up to the
+// thread count, to see how well it scales.
+//
+// Games are handed out with work stealing. Every worker starts with an even
+// share of the games and plays them front to back, and a worker that runs out
+// steals the back half of whatever some other worker has left. A worker's
+// share is a single 64 bit word holding the next game and the end, so both
+// taking a game and stealing half are one compare and swap.
+
+#define DEFAULT_GAMES 1000
+#define DEFAULT_SEED 1
+
+// Give up on a game if the bot somehow keeps it going this long.
+#define MAX_GAME_TICKS (SIM_TICK_RATE * 60 * 30)
+
+#define SCORE_BUCKETS 8
+#define LENGTH_BUCKETS 8
+#define LENGTH_BUCKET_SECONDS 30
+
+typedef struct
+{
+    int score;
+    uint32_t ticks;
+    uint32_t hash;
+} result_t;
+
+typedef struct
+{
+    // Low half is the next game to play, high half is one past the last.
+    uint64_t range;
+    unsigned int played;
+    unsigned int stolen;
+    // Keep every worker's range on its own cache line.
+    uint8_t pad[48];
+} worker_t;
+
+typedef struct
+{
+    worker_t *workers;
+    unsigned int threads;
+    uint32_t seed;
+    result_t *results;
+} farm_t;
+
+typedef struct
+{
+    farm_t *farm;
+    unsigned int which;
+} worker_param_t;
+
+static uint64_t make_range(uint32_t next, uint32_t end)
+{
+    return ((uint64_t)end << 32) | next;
+}
+
+static int take_game(worker_t *worker, uint32_t *game)
+{
+    uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+    while (1)
+    {
+        uint32_t next = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (next >= end)
+        {
+            return 0;
+        }
+
+        if (__atomic_compare_exchange_n(&worker->range, &range, make_range(next + 1, end), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            *game = next;
+            return 1;
+        }
+    }
+}
+
+static int steal_games(farm_t *farm, unsigned int thief)
+{
+    for (unsigned int i = 1; i < farm->threads; i++)
+    {
+        worker_t *victim = &farm->workers[(thief + i) % farm->threads];
+        uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+
+        while (1)
+        {
+            uint32_t next = (uint32_t)range;
+            uint32_t end = (uint32_t)(range >> 32);
+            if (next >= end)
+            {
+                break;
+            }
+
+            // Take the back half, rounded up so a single game can be stolen.
+            uint32_t steal = (end - next + 1) / 2;
+            if (__atomic_compare_exchange_n(&victim->range, &range, make_range(next, end - steal), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                // Our own range is empty, so nobody will try to steal from it
+                // until this lands.
+                __atomic_store_n(&farm->workers[thief].range, make_range(end - steal, end), __ATOMIC_RELEASE);
+                farm->workers[thief].stolen += steal;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void play_game(playfield_t *playfield, uint32_t seed, result_t *result)
+{
+    rng_t rng;
+    rng_seed(&rng, seed);
+    int targetx = rng_range(&rng, playfield->width);
+    int targety = rng_range(&rng, playfield->height);
+    control_t control;
+    sim_tick_t tick;
+
+    control_init(&control, playfield, 0, 0);
+    memset(&tick, 0, sizeof(tick));
+    playfield_run(playfield, seed);
+
+    int running = playfield_running(playfield);
+    for (result->ticks = 0; result->ticks < MAX_GAME_TICKS && running; result->ticks++)
+    {
+        // Walk the cursor one cell a tick towards some random spot, and drop
+        // once we get there.
+        if (playfield->curx < targetx)
+        {
+            tick.pressed = INPUT_RIGHT;
+        }
+        else if (playfield->curx > targetx)
+        {
+            tick.pressed = INPUT_LEFT;
+        }
+        else if (playfield->cury < targety)
+        {
+            tick.pressed = INPUT_DOWN;
+        }
+        else if (playfield->cury > targety)
+        {
+            tick.pressed = INPUT_UP;
+        }
+        else
+        {
+            tick.pressed = INPUT_BUTTON1;
+            targetx = rng_range(&rng, playfield->width);
+            targety = rng_range(&rng, playfield->height);
+        }
+
+        tick.index = result->ticks;
+        running = control_tick(&control, &tick) & CONTROL_RUNNING;
+    }
+
+    playfield_stop(playfield);
+    result->score = playfield->score;
+    result->hash = playfield_state_hash(playfield);
+}
+
+static void *worker_main(void *param)
+{
+    worker_param_t *worker_param = (worker_param_t *)param;
+    farm_t *farm = worker_param->farm;
+    worker_t *worker = &farm->workers[worker_param->which];
+
+    host_platform_t host;
+    host_platform_init(&host, 0);
+    playfield_t *playfield = host_playfield_new(&host);
+
+    while (1)
+    {
+        uint32_t game;
+        if (take_game(worker, &game))
+        {
+            // Spread the seeds out so neighboring games aren't related.
+            play_game(playfield, (farm->seed + game) * 2654435761u, &farm->results[game]);
+            worker->played++;
+        }
+        else if (!steal_games(farm, worker_param->which))
+        {
+            break;
+        }
+    }
+
+    playfield_free(playfield);
+    return 0;
+}
+
+static uint64_t run_farm(unsigned int threads, unsigned int games, uint32_t seed, result_t *results, int verbose)
+{
+    farm_t farm;
+    worker_t *workers = aligned_alloc(64, sizeof(worker_t) * threads);
+    worker_param_t *params = malloc(sizeof(worker_param_t) * threads);
+    pthread_t *handles = malloc(sizeof(pthread_t) * threads);
+
+    memset(workers, 0, sizeof(worker_t) * threads);
+    farm.workers = workers;
+    farm.threads = threads;
+    farm.seed = seed;
+    farm.results = results;
+
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        workers[i].range = make_range(((uint64_t)games * i) / threads, ((uint64_t)games * (i + 1)) / threads);
+        params[i].farm = &farm;
+        params[i].which = i;
+    }
+
+    uint64_t start = host_wall_us();
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        pthread_create(&handles[i], 0, &worker_main, &params[i]);
+    }
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        pthread_join(handles[i], 0);
+    }
+    uint64_t elapsed = host_wall_us() - start;
+
+    if (verbose)
+    {
+        for (unsigned int i = 0; i < threads; i++)
+        {
+            printf("thread %3u played %6u games, stole %6u\n", i, workers[i].played, workers[i].stolen);
+        }
+    }
+
+    free(workers);
+    free(params);
+    free(handles);
+    return elapsed;
+}
+
+static uint32_t results_hash(result_t *results, unsigned int games)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < games; i++)
+    {
+        hash = (hash ^ (uint32_t)results[i].score) * 16777619u;
+        hash = (hash ^ results[i].ticks) * 16777619u;
+        hash = (hash ^ results[i].hash) * 16777619u;
+    }
+
+    return hash;
+}
+
+static int compare_ints(const void *a, const void *b)
+{
+    int first = *(const int *)a;
+    int second = *(const int *)b;
+    return (first > second) - (first < second);
+}
+
+static void report(result_t *results, unsigned int games)
+{
+    int *scores = malloc(sizeof(int) * games);
+    int *lengths = malloc(sizeof(int) * games);
+    uint64_t score_buckets[SCORE_BUCKETS];
+    uint64_t length_buckets[LENGTH_BUCKETS];
+    uint64_t total_score = 0;
+    uint64_t total_ticks = 0;
+
+    memset(score_buckets, 0, sizeof(score_buckets));
+    memset(length_buckets, 0, sizeof(length_buckets));
+    for (unsigned int i = 0; i < games; i++)
+    {
+        scores[i] = results[i].score;
+        lengths[i] = results[i].ticks;
+        total_score += results[i].score;
+        total_ticks += results[i].ticks;
+
+        // Scores go in doubling buckets with zero on its own, lengths in
+        // even steps.
+        int bucket = 0;
+        while (bucket < (SCORE_BUCKETS - 1) && results[i].score >= (1 << bucket))
+        {
+            bucket++;
+        }
+        score_buckets[bucket]++;
+
+        bucket = results[i].ticks / (LENGTH_BUCKET_SECONDS * SIM_TICK_RATE);
+        length_buckets[bucket < LENGTH_BUCKETS ? bucket : LENGTH_BUCKETS - 1]++;
+    }
+    qsort(scores, games, sizeof(int), &compare_ints);
+    qsort(lengths, games, sizeof(int), &compare_ints);
+
+    printf("score:  avg %.2f, min %d, median %d, p99 %d, max %d\n",
+        (double)total_score / games, scores[0], scores[games / 2], scores[(games * 99) / 100], scores[games - 1]);
+    for (int bucket = 0; bucket < SCORE_BUCKETS; bucket++)
+    {
+        if (bucket == 0)
+        {
+            printf("  %9s %10llu %6.2f%%\n", "0", (unsigned long long)score_buckets[bucket], (100.0 * score_buckets[bucket]) / games);
+        }
+        else if (bucket < SCORE_BUCKETS - 1)
+        {
+            char label[32];
+            sprintf(label, "%d-%d", 1 << (bucket - 1), (1 << bucket) - 1);
+            printf("  %9s %10llu %6.2f%%\n", label, (unsigned long long)score_buckets[bucket], (100.0 * score_buckets[bucket]) / games);
+        }
+        else
+        {
+            char label[32];
+            sprintf(label, "%d+", 1 << (bucket - 1));
+            printf("  %9s %10llu %6.2f%%\n", label, (unsigned long long)score_buckets[bucket], (100.0 * score_buckets[bucket]) / games);
+        }
+    }
+
+    printf("length: avg %.1f s, min %.1f s, median %.1f s, p99 %.1f s, max %.1f s\n",
+        ((double)total_ticks / games) / SIM_TICK_RATE, (double)lengths[0] / SIM_TICK_RATE, (double)lengths[games / 2] / SIM_TICK_RATE,
+        (double)lengths[(games * 99) / 100] / SIM_TICK_RATE, (double)lengths[games - 1] / SIM_TICK_RATE);
+    for (int bucket = 0; bucket < LENGTH_BUCKETS; bucket++)
+    {
+        char label[32];
+        if (bucket < LENGTH_BUCKETS - 1)
+        {
+            sprintf(label, "%d-%ds", bucket * LENGTH_BUCKET_SECONDS, (bucket + 1) * LENGTH_BUCKET_SECONDS);
+        }
+        else
+        {
+            sprintf(label, "%ds+", bucket * LENGTH_BUCKET_SECONDS);
+        }
+        printf("  %9s %10llu %6.2f%%\n", label, (unsigned long long)length_buckets[bucket], (100.0 * length_buckets[bucket]) / games);
+    }
+
+    free(scores);
+    free(lengths);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int games = DEFAULT_GAMES;
+    uint32_t seed = DEFAULT_SEED;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = cores > 0 ? cores : 1;
+    int scaling = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            games = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--scaling") == 0)
+        {
+            scaling = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--games N] [--seed S] [--threads N] [--scaling]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (games == 0 || threads == 0)
+    {
+        fprintf(stderr, "Need at least one game and one thread!\n");
+        return 1;
+    }
+
+    result_t *results = malloc(sizeof(result_t) * games);
+    int failed = 0;
+
+    if (scaling)
+    {
+        uint64_t single = 0;
+        uint32_t expected = 0;
+
+        printf("threads  seconds  games/sec  speedup  efficiency  results\n");
+        for (unsigned int count = 1; ; count = (count * 2 > threads && count < threads) ? threads : count * 2)
+        {
+            memset(results, 0, sizeof(result_t) * games);
+            uint64_t elapsed = run_farm(count, games, seed, results, 0);
+            uint32_t hash = results_hash(results, games);
+            if (count == 1)
+            {
+                single = elapsed;
+                expected = hash;
+            }
+            failed |= hash != expected;
+
+            double speedup = (double)single / (double)elapsed;
+            printf("%7u %8.3f %10.1f %7.2fx %10.1f%%  %08x %s\n",
+                count, elapsed / 1000000.0, games / (elapsed / 1000000.0), speedup, (100.0 * speedup) / count, hash, hash == expected ? "ok" : "MISMATCH");
+
+            if (count >= threads)
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        uint64_t elapsed = run_farm(threads, games, seed, results, 1);
+        printf("%u games on %u threads in %.3f s, %.1f games/sec, results %08x\n",
+            games, threads, elapsed / 1000000.0, games / (elapsed / 1000000.0), results_hash(results, games));
+    }
+
+    report(results, games);
+    if (failed)
+    {
+        printf("Results changed with the number of threads!\n");
+    }
+
+    free(results);
+    return failed ? 1 : 0;
+}
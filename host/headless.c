@@ -0,0 +1,1045 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "input.h"
+#include "sim.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "control.h"
+#include "hint.h"
+#include "replay.h"
+#include "clock.h"
+#include "profiler.h"
+#include "trace.h"
+#include "watchdog.h"
+
+// Runs the game engine with no video, audio or controls. By default a dumb
+// bot plays a bunch of games as fast as possible and we report throughput.
+// With --check, a scripted player plays for a while, once with the shipping
+// rules and once with gravity, aiming for the cells the placement hints like
+// so its games score, and its input log is then fed through the fixed
+// timestep driver at several display rates to make sure every game ends up
+// in exactly the same state no matter how fast frames are drawn. --record
+// writes every game played with the shipping rules out as replays.
+// With --threads N, N boards are played on N threads at once and each one
+// has to come out exactly like it does when played on its own. With --soak,
+// games are played back to back through the same input handling the game
+// uses, either mashing random buttons or looping over recorded replays, and
+// we report how long every tick of logic took. Add --profile to also get the
+// profiler's per-phase report, the same one the debug overlay draws, over
+// the last ticks that were played, or --trace FILE to write out the trace
+// ring as Chrome trace JSON, which holds the tick phases and the solver's
+// steps for the last couple thousand ticks. Both need headless-instrumented,
+// which is this built with the profiler markers and trace events in. The
+// profiler keeps one set of totals for the whole process, so the
+// instrumented build refuses --threads above one. With
+// --watchdog FILE, every tick slower than --budget US gets a snapshot in the
+// same watchdog ring the game keeps for slow frames, which is written out to
+// FILE as CSV at the end. Host ticks are a lot quicker than a frame, so the
+// budget usually wants to be a lot lower than the game's.
+
+#define DEFAULT_GAMES 100
+#define DEFAULT_SEED 1
+#define DEFAULT_STRESS_GAMES 4
+#define DEFAULT_SOAK_GAMES 1000
+
+// Per-tick cost histogram buckets, each twice as wide as the last starting
+// at SOAK_BUCKET_BASE ns, with the last one catching everything slower.
+#define SOAK_BUCKETS 10
+#define SOAK_BUCKET_BASE 1000
+
+// Give up on a game if the bot somehow keeps it going this long.
+#define MAX_GAME_TICKS (SIM_TICK_RATE * 60 * 30)
+
+#define TICK_US (1000000 / SIM_TICK_RATE)
+
+#define EPOCH 1000000
+#define DEFAULT_CHECK_SECONDS 300
+#define CHECK_EVENTS 65536
+
+typedef struct
+{
+    uint32_t rand_state;
+    host_platform_t host;
+} headless_t;
+
+static uint32_t headless_next(headless_t *headless)
+{
+    headless->rand_state = (headless->rand_state * 1103515245) + 12345;
+    return headless->rand_state >> 8;
+}
+
+static int bot_play(playfield_t *playfield, headless_t *headless, unsigned int *ticks)
+{
+    int targetx = playfield->curx;
+    int targety = playfield->cury;
+    control_t control;
+    sim_tick_t tick;
+
+    control_init(&control, playfield, 0, 0);
+    memset(&tick, 0, sizeof(tick));
+    playfield_run(playfield, headless_next(headless));
+
+    int running = playfield_running(playfield);
+    for (*ticks = 0; *ticks < MAX_GAME_TICKS && running; (*ticks)++)
+    {
+        // Walk the cursor one cell a tick towards some random empty-ish
+        // spot, and drop once we get there.
+        if (playfield->curx < targetx)
+        {
+            tick.pressed = INPUT_RIGHT;
+        }
+        else if (playfield->curx > targetx)
+        {
+            tick.pressed = INPUT_LEFT;
+        }
+        else if (playfield->cury < targety)
+        {
+            tick.pressed = INPUT_DOWN;
+        }
+        else if (playfield->cury > targety)
+        {
+            tick.pressed = INPUT_UP;
+        }
+        else
+        {
+            tick.pressed = INPUT_BUTTON1;
+            targetx = headless_next(headless) % playfield->width;
+            targety = headless_next(headless) % playfield->height;
+        }
+
+        headless->host.now += TICK_US;
+        tick.index = *ticks;
+        tick.time = headless->host.now;
+        running = control_tick(&control, &tick) & CONTROL_RUNNING;
+    }
+
+    playfield_stop(playfield);
+    return playfield->score;
+}
+
+static int run_throughput(unsigned int games, uint32_t seed)
+{
+    headless_t headless;
+    memset(&headless, 0, sizeof(headless));
+    headless.rand_state = seed;
+
+    host_platform_init(&headless.host, 0);
+    playfield_t *playfield = host_playfield_new(&headless.host);
+
+    uint64_t total_ticks = 0;
+    uint64_t total_score = 0;
+    uint64_t start = host_wall_us();
+
+    for (unsigned int game = 0; game < games; game++)
+    {
+        unsigned int ticks;
+        total_score += bot_play(playfield, &headless, &ticks);
+        total_ticks += ticks;
+    }
+
+    double seconds = (double)(host_wall_us() - start) / 1000000.0;
+    printf("%u games in %.3f s, %.1f games/sec, %.0f ticks/sec\n", games, seconds, games / seconds, total_ticks / seconds);
+    printf("avg %.1f ticks (%.1f s game time), avg score %.1f, %u solves\n",
+        (double)total_ticks / games, ((double)total_ticks / games) / SIM_TICK_RATE, (double)total_score / games, playfield->solves);
+    printf("sounds: %u activate, %u bad, %u clear, %u drop, %u scroll\n",
+        headless.host.sounds[PLAYFIELD_SOUND_ACTIVATE], headless.host.sounds[PLAYFIELD_SOUND_BAD],
+        headless.host.sounds[PLAYFIELD_SOUND_CLEAR], headless.host.sounds[PLAYFIELD_SOUND_DROP],
+        headless.host.sounds[PLAYFIELD_SOUND_SCROLL]);
+
+    playfield_free(playfield);
+    return 0;
+}
+
+typedef struct
+{
+    uint32_t seed;
+    unsigned int games;
+    uint32_t hash;
+} board_t;
+
+static void *board_main(void *param)
+{
+    board_t *board = (board_t *)param;
+    headless_t headless;
+    memset(&headless, 0, sizeof(headless));
+    headless.rand_state = board->seed;
+
+    host_platform_init(&headless.host, 0);
+    playfield_t *playfield = host_playfield_new(&headless.host);
+
+    // Fold everything about every game into one hash.
+    uint32_t hash = 2166136261u;
+    for (unsigned int game = 0; game < board->games; game++)
+    {
+        unsigned int ticks;
+        uint32_t values[4];
+        values[0] = bot_play(playfield, &headless, &ticks);
+        values[1] = ticks;
+        values[2] = playfield->solves;
+        values[3] = playfield_state_hash(playfield);
+
+        for (int i = 0; i < 4; i++)
+        {
+            hash = (hash ^ values[i]) * 16777619u;
+        }
+    }
+    for (int i = 0; i < PLAYFIELD_SOUND_COUNT; i++)
+    {
+        hash = (hash ^ headless.host.sounds[i]) * 16777619u;
+    }
+
+    playfield_free(playfield);
+    board->hash = hash;
+    return 0;
+}
+
+static int run_stress(unsigned int threads, unsigned int games, uint32_t seed)
+{
+    board_t *single = malloc(sizeof(board_t) * threads);
+    board_t *threaded = malloc(sizeof(board_t) * threads);
+    pthread_t *handles = malloc(sizeof(pthread_t) * threads);
+    int failed = 0;
+
+    // Every board on its own first, to know what to expect.
+    uint64_t start = host_wall_us();
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        single[i].seed = seed + i;
+        single[i].games = games;
+        board_main(&single[i]);
+    }
+    uint64_t single_us = host_wall_us() - start;
+
+    // Now all of them at once.
+    start = host_wall_us();
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        threaded[i].seed = seed + i;
+        threaded[i].games = games;
+        pthread_create(&handles[i], 0, &board_main, &threaded[i]);
+    }
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        pthread_join(handles[i], 0);
+    }
+    uint64_t threaded_us = host_wall_us() - start;
+
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        int match = single[i].hash == threaded[i].hash;
+        failed |= !match;
+        printf("board %3u seed %u: %08x %08x %s\n", i, single[i].seed, single[i].hash, threaded[i].hash, match ? "ok" : "MISMATCH");
+    }
+
+    printf("%u boards of %u games, %.3f s one at a time, %.3f s on %u threads\n",
+        threads, games, single_us / 1000000.0, threaded_us / 1000000.0, threads);
+    printf("%s\n", failed ? "Threaded boards don't match!" : "All threaded boards match.");
+
+    free(single);
+    free(threaded);
+    free(handles);
+    return failed ? 1 : 0;
+}
+
+// How the scripted player plays. It waits up to SCRIPT_REACTION_US before
+// pressing anything, holds a direction down once it has SCRIPT_HOLD_CELLS or
+// more to go, and every SCRIPT_CARELESS drops or so puts the block anywhere
+// at all instead of where the hints say, the way people misjudge things.
+#define SCRIPT_REACTION_US 150000
+#define SCRIPT_RESTART_US 1000000
+#define SCRIPT_HOLD_CELLS 3
+#define SCRIPT_CARELESS 8
+
+typedef struct
+{
+    headless_t choices;
+    uint8_t *visited;
+
+    // The cell it's heading for, or -1 to pick one.
+    int target;
+    // A direction it's holding down until the cursor gets where it's going.
+    uint32_t holding;
+    // Nothing else gets pressed until its last event has happened.
+    uint64_t busy;
+} script_t;
+
+typedef struct
+{
+    playfield_t *playfield;
+    headless_t *headless;
+    control_t control;
+    uint64_t limit;
+
+    // Set while writing the input log rather than playing it back.
+    script_t *script;
+
+    // Every game that ended folded together, and the best score any game
+    // got to. Most games give their score back before the board fills up.
+    int running;
+    unsigned int games;
+    int best;
+    uint32_t ended;
+
+    // Where to write every finished game, if anywhere.
+    replay_t *replay;
+    FILE *record;
+    unsigned int recorded;
+} check_t;
+
+static input_event_t events[CHECK_EVENTS];
+static unsigned int num_events;
+static uint64_t check_length;
+
+static void add_event(uint64_t timestamp, uint32_t button, uint32_t type)
+{
+    if (num_events < CHECK_EVENTS)
+    {
+        events[num_events].timestamp = timestamp;
+        events[num_events].button = button;
+        events[num_events].type = type;
+        num_events++;
+    }
+}
+
+static void script_press(script_t *script, uint64_t when, uint32_t button, uint64_t hold)
+{
+    add_event(when, button, INPUT_EVENT_PRESS);
+    if (hold)
+    {
+        add_event(when + hold, button, INPUT_EVENT_RELEASE);
+        script->busy = when + hold;
+    }
+    else
+    {
+        script->holding = button;
+        script->busy = when;
+    }
+}
+
+static int script_placeable(playfield_t *playfield, int cell)
+{
+    int x = cell % playfield->width;
+    int y = cell / playfield->width;
+
+    if (playfield->entries[cell].block != BLOCK_TYPE_NONE)
+    {
+        return 0;
+    }
+
+    // With gravity, only go for cells a block would actually land on.
+    if (playfield->rules.gravity && y < playfield->height - 1)
+    {
+        return playfield_entry(playfield, x, y + 1)->block != BLOCK_TYPE_NONE;
+    }
+
+    return 1;
+}
+
+static int script_pick(script_t *script, playfield_t *playfield)
+{
+    int cells = playfield->width * playfield->height;
+    int careless = (headless_next(&script->choices) % SCRIPT_CARELESS) == 0;
+    int first = headless_next(&script->choices) % cells;
+    int best = -1;
+    int best_score = HINT_UNAVAILABLE;
+
+    // Starting somewhere random breaks ties between equally good cells.
+    for (int i = 0; i < cells; i++)
+    {
+        int cell = (first + i) % cells;
+        if (!script_placeable(playfield, cell))
+        {
+            continue;
+        }
+        if (careless)
+        {
+            return cell;
+        }
+
+        int score = hint_evaluate(playfield, script->visited, cell % playfield->width, cell / playfield->width, playfield->upnext[0].pipe);
+        if (best < 0 || score > best_score)
+        {
+            best = cell;
+            best_score = score;
+        }
+    }
+
+    return best;
+}
+
+static void script_play(check_t *check, sim_tick_t *tick, int running)
+{
+    script_t *script = check->script;
+    playfield_t *playfield = check->playfield;
+
+    // Anything pressed now lands in a later tick, so the game always gets to
+    // see the last thing that was pressed before the script looks again.
+    if (tick->time < script->busy)
+    {
+        return;
+    }
+    uint64_t when = tick->time + 1 + (headless_next(&script->choices) % SCRIPT_REACTION_US);
+    uint64_t tap = 20000 + (headless_next(&script->choices) % 80000);
+
+    if (!running)
+    {
+        if (script->holding)
+        {
+            add_event(tick->time + 1, script->holding, INPUT_EVENT_RELEASE);
+            script->holding = 0;
+        }
+
+        // Take a breather, then go again.
+        script->target = -1;
+        script_press(script, when + SCRIPT_RESTART_US, INPUT_START, tap);
+        return;
+    }
+
+    if (script->target < 0 || !script_placeable(playfield, script->target))
+    {
+        script->target = script_pick(script, playfield);
+        if (script->target < 0)
+        {
+            return;
+        }
+    }
+
+    int dx = (script->target % playfield->width) - playfield->curx;
+    int dy = (script->target / playfield->width) - playfield->cury;
+
+    if (script->holding)
+    {
+        // Let go once the cursor has got as far as it's going that way, or
+        // gone past because the target moved.
+        int there = (script->holding == INPUT_LEFT && dx >= 0) || (script->holding == INPUT_RIGHT && dx <= 0) ||
+            (script->holding == INPUT_UP && dy >= 0) || (script->holding == INPUT_DOWN && dy <= 0);
+        if (there)
+        {
+            add_event(tick->time + 1, script->holding, INPUT_EVENT_RELEASE);
+            script->busy = tick->time + 1;
+            script->holding = 0;
+        }
+        return;
+    }
+
+    if (dx == 0 && dy == 0)
+    {
+        script_press(script, when, INPUT_BUTTON1, tap);
+        script->target = -1;
+        return;
+    }
+
+    uint32_t button;
+    int distance;
+    if (dx != 0)
+    {
+        button = dx < 0 ? INPUT_LEFT : INPUT_RIGHT;
+        distance = abs(dx);
+    }
+    else
+    {
+        button = dy < 0 ? INPUT_UP : INPUT_DOWN;
+        distance = abs(dy);
+    }
+    script_press(script, when, button, distance >= SCRIPT_HOLD_CELLS ? 0 : tap);
+}
+
+static void check_start(void *user)
+{
+    check_t *check = (check_t *)user;
+    playfield_run(check->playfield, headless_next(check->headless));
+    if (check->record)
+    {
+        replay_begin(check->replay, check->playfield->seed, TICK_US);
+    }
+}
+
+static void check_tick(sim_tick_t *tick, void *user)
+{
+    check_t *check = (check_t *)user;
+    playfield_t *playfield = check->playfield;
+
+    if (tick->index >= check->limit)
+    {
+        return;
+    }
+    check->headless->host.now = tick->time;
+
+    // Same handling the game does.
+    int running = control_tick(&check->control, tick) & CONTROL_RUNNING;
+
+    if (playfield->score > check->best)
+    {
+        check->best = playfield->score;
+    }
+    if (check->running && !running)
+    {
+        check->games++;
+        check->ended = (check->ended ^ playfield_state_hash(playfield)) * 16777619u;
+    }
+    check->running = running;
+
+    if (check->record)
+    {
+        replay_record(check->replay, tick);
+        if (!running && check->replay->recording)
+        {
+            replay_finish(check->replay, playfield_state_hash(playfield), playfield->score);
+            if (replay_valid(check->replay))
+            {
+                replay_write(check->replay, check->record);
+                check->recorded++;
+            }
+        }
+    }
+
+    if (check->script)
+    {
+        script_play(check, tick, running);
+    }
+}
+
+typedef struct
+{
+    int frames;
+    unsigned int games;
+    unsigned int clears;
+    int best;
+    unsigned int recorded;
+} check_result_t;
+
+// Plays the input log at one display rate, or with frame_us of zero at a
+// jittery one, and returns a hash of how every game ended up. With a script,
+// the log is written as it goes instead, one tick a frame.
+static uint32_t check_rate(uint32_t frame_us, uint32_t seed, playfield_rules_t *rules, script_t *script, FILE *record, check_result_t *result)
+{
+    static replay_t replay;
+    static sim_t sim;
+    headless_t headless;
+    check_t check;
+    headless_t jitter;
+
+    memset(&headless, 0, sizeof(headless));
+    headless.rand_state = seed;
+    jitter.rand_state = seed;
+
+    host_platform_init(&headless.host, 0);
+    memset(&check, 0, sizeof(check));
+    check.playfield = playfield_new(&headless.host.platform, rules, 0, PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT);
+    check.headless = &headless;
+    check.limit = check_length / TICK_US;
+    check.script = script;
+    check.replay = &replay;
+    check.record = record;
+    control_init(&check.control, check.playfield, &check_start, &check);
+
+    if (script)
+    {
+        memset(script, 0, sizeof(script_t));
+        script->choices.rand_state = ~seed;
+        script->visited = calloc(PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT, sizeof(uint8_t));
+        script->target = -1;
+        num_events = 0;
+        frame_us = TICK_US;
+
+        // Start the first game straight away.
+        script_press(script, EPOCH + 1, INPUT_START, 50000);
+    }
+
+    sim_init(&sim, SIM_TICK_RATE, EPOCH);
+    uint64_t now = EPOCH;
+    unsigned int delivered = 0;
+    result->frames = 0;
+
+    while (sim.ticks < check.limit)
+    {
+        now += frame_us ? frame_us : 4000 + (headless_next(&jitter) % 36000);
+
+        unsigned int count = 0;
+        while (delivered + count < num_events && events[delivered + count].timestamp <= now)
+        {
+            count++;
+        }
+        sim_queue_events(&sim, &events[delivered], count);
+        delivered += count;
+
+        sim_advance(&sim, now, &check_tick, &check);
+        result->frames++;
+    }
+
+    result->recorded = check.recorded;
+    result->games = check.games;
+    result->clears = headless.host.sounds[PLAYFIELD_SOUND_CLEAR];
+    result->best = check.best;
+    uint32_t hash = (check.ended ^ playfield_state_hash(check.playfield)) * 16777619u;
+    for (int i = 0; i < PLAYFIELD_SOUND_COUNT; i++)
+    {
+        hash = (hash ^ headless.host.sounds[i]) * 16777619u;
+    }
+
+    if (script)
+    {
+        free(script->visited);
+    }
+    playfield_free(check.playfield);
+    return hash;
+}
+
+static int run_check(uint32_t seed, unsigned int seconds, const char *record)
+{
+    struct
+    {
+        const char *name;
+        uint32_t frame_us;
+    } rates[] = {
+        { "30hz", 33333 },
+        { "60hz", 16667 },
+        { "75hz", 13333 },
+        { "144hz", 6944 },
+        { "jittery", 0 },
+    };
+    int num_rates = sizeof(rates) / sizeof(rates[0]);
+    int failed = 0;
+
+    check_length = (uint64_t)seconds * 1000000;
+
+    // Once with the shipping rules, which is what gets recorded since that's
+    // what replays are played back with, and once more with gravity on.
+    for (int gravity = 0; gravity < 2; gravity++)
+    {
+        playfield_rules_t rules;
+        playfield_default_rules(&rules);
+        rules.gravity = gravity;
+
+        script_t script;
+        check_result_t result;
+        FILE *fp = 0;
+
+        if (record && !gravity)
+        {
+            fp = fopen(record, "wb");
+            if (!fp)
+            {
+                fprintf(stderr, "Can't open %s for writing!\n", record);
+                return 1;
+            }
+        }
+
+        uint32_t expected = check_rate(0, seed, &rules, &script, fp, &result);
+
+        printf("%s: %u events over %d seconds\n", gravity ? "gravity" : "shipping rules", num_events, (int)(check_length / 1000000));
+        printf("%-8s %6d frames, %3u games, %4u clears, best score %4d, hash %08x\n",
+            "script", result.frames, result.games, result.clears, result.best, expected);
+        if (fp)
+        {
+            printf("recorded %u games\n", result.recorded);
+            fclose(fp);
+        }
+
+        // A log that never clears anything or never finishes a game doesn't
+        // say much about the parts of the engine that matter.
+        if (result.games == 0 || result.clears == 0)
+        {
+            printf("The script didn't finish a game and clear beams, make --seconds longer.\n");
+            failed = 1;
+        }
+
+        for (int i = 0; i < num_rates; i++)
+        {
+            uint32_t hash = check_rate(rates[i].frame_us, seed, &rules, 0, 0, &result);
+            failed |= hash != expected;
+            printf("%-8s %6d frames, %3u games, %4u clears, best score %4d, hash %08x %s\n",
+                rates[i].name, result.frames, result.games, result.clears, result.best, hash, hash == expected ? "ok" : "MISMATCH");
+        }
+    }
+
+    printf("%s\n", failed ? "Display rate changes the game!" : "All display rates agree.");
+    return failed ? 1 : 0;
+}
+
+typedef struct
+{
+    playfield_t *playfield;
+    headless_t *headless;
+    control_t control;
+    uint32_t seed;
+
+    // Random button mashing.
+    uint32_t held;
+    uint64_t release;
+
+    // Whether slow ticks go to the watchdog.
+    int watching;
+
+    // Whether a game was going after the last tick.
+    int running;
+    unsigned int games;
+    unsigned int broken;
+    uint64_t ticks;
+    uint64_t game_ticks;
+    uint64_t tick_ns;
+    uint64_t slowest;
+    uint64_t buckets[SOAK_BUCKETS];
+} soak_t;
+
+static int soak_sane(playfield_t *playfield)
+{
+    // Things that should never happen no matter what was pressed.
+    if (playfield->curx < 0 || playfield->curx >= playfield->width || playfield->cury < 0 || playfield->cury >= playfield->height)
+    {
+        return 0;
+    }
+    if (playfield->score < 0)
+    {
+        return 0;
+    }
+    for (int y = 0; y < playfield->height; y++)
+    {
+        for (int x = 0; x < playfield->width; x++)
+        {
+            if (playfield_entry(playfield, x, y)->block > BLOCK_TYPE_GRAY)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static void soak_start(void *user)
+{
+    soak_t *soak = (soak_t *)user;
+    playfield_run(soak->playfield, soak->seed);
+}
+
+static void soak_tick(sim_tick_t *tick, void *user)
+{
+    soak_t *soak = (soak_t *)user;
+    playfield_t *playfield = soak->playfield;
+    unsigned int solves = playfield->solves;
+    uint64_t start = host_wall_ns();
+
+    // The same thing the game does every tick, minus audio. With no display
+    // every tick is a frame as far as the profiler is concerned.
+    TRACE_BEGIN("tick");
+    int was_running = soak->running;
+    int running = control_tick(&soak->control, tick) & CONTROL_RUNNING;
+    uint64_t elapsed = host_wall_ns() - start;
+
+    // Remember what was going on in slow ticks, same as the game does for
+    // slow frames.
+    if (soak->watching && watchdog_over_budget(elapsed / 1000))
+    {
+        watchdog_snapshot_t snapshot;
+        snapshot.frame = soak->ticks;
+        snapshot.uspf = elapsed / 1000;
+        snapshot.budget = watchdog_budget();
+        profiler_current(snapshot.phases);
+        snapshot.occupied = playfield_occupied(playfield);
+        snapshot.cells = playfield->width * playfield->height;
+        snapshot.solves = playfield->solves - solves;
+        snapshot.ticks = 1;
+        watchdog_record(&snapshot);
+    }
+    PROFILER_FRAME();
+    TRACE_END("tick");
+
+    int bucket = 0;
+    while (bucket < (SOAK_BUCKETS - 1) && elapsed >= ((uint64_t)SOAK_BUCKET_BASE << bucket))
+    {
+        bucket++;
+    }
+    soak->buckets[bucket]++;
+    soak->tick_ns += elapsed;
+    if (elapsed > soak->slowest)
+    {
+        soak->slowest = elapsed;
+    }
+    soak->ticks++;
+    soak->game_ticks++;
+
+    if (running && soak->game_ticks >= MAX_GAME_TICKS)
+    {
+        playfield_stop(playfield);
+        running = 0;
+    }
+    if (was_running && !running)
+    {
+        soak->games++;
+        soak->broken += !soak_sane(playfield);
+    }
+    soak->running = running;
+}
+
+static void soak_random_tick(soak_t *soak, uint64_t index)
+{
+    static const uint32_t buttons[] = { INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT, INPUT_BUTTON1, INPUT_BUTTON2, INPUT_BUTTON3 };
+    headless_t *headless = soak->headless;
+    sim_tick_t tick;
+
+    memset(&tick, 0, sizeof(tick));
+    tick.index = index;
+    tick.time = (index + 1) * TICK_US;
+    headless->host.now = tick.time;
+
+    if (soak->held && tick.time >= soak->release)
+    {
+        tick.released = soak->held;
+        soak->held = 0;
+    }
+    else if (!soak->held)
+    {
+        if (!playfield_running(soak->playfield))
+        {
+            // Start the next game right away.
+            soak->seed = headless_next(headless);
+            soak->game_ticks = 0;
+            soak->held = INPUT_START;
+        }
+        else if ((headless_next(headless) % 4) == 0)
+        {
+            soak->held = buttons[headless_next(headless) % (sizeof(buttons) / sizeof(buttons[0]))];
+        }
+
+        if (soak->held)
+        {
+            // Mostly taps, with the odd long hold to get repeats going.
+            uint64_t hold = (headless_next(headless) % 8) == 0 ? 400000 + (headless_next(headless) % 600000) : TICK_US * (1 + (headless_next(headless) % 6));
+            soak->release = tick.time + hold;
+            tick.pressed = soak->held;
+        }
+    }
+    tick.held = soak->held;
+
+    soak_tick(&tick, soak);
+}
+
+static int run_soak(unsigned int games, uint32_t seed, const char *script, int profile, const char *trace, const char *watchdog, uint32_t budget)
+{
+    headless_t headless;
+    soak_t soak;
+    static replay_t replay;
+
+    memset(&headless, 0, sizeof(headless));
+    headless.rand_state = seed;
+
+    host_platform_init(&headless.host, 0);
+    memset(&soak, 0, sizeof(soak));
+    soak.playfield = host_playfield_new(&headless.host);
+    soak.headless = &headless;
+    control_init(&soak.control, soak.playfield, &soak_start, &soak);
+
+    if (watchdog)
+    {
+        watchdog_init();
+        watchdog_clear();
+        watchdog_set_budget(budget);
+        soak.watching = 1;
+    }
+
+    uint64_t start = host_wall_us();
+    if (script)
+    {
+        FILE *fp = fopen(script, "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "Can't open %s!\n", script);
+            return 1;
+        }
+
+        // Loop over every game in the script until we've played enough.
+        while (soak.games < games)
+        {
+            if (!replay_read(&replay, fp))
+            {
+                if (ftell(fp) == 0)
+                {
+                    fprintf(stderr, "No replays in %s!\n", script);
+                    fclose(fp);
+                    return 1;
+                }
+                rewind(fp);
+                continue;
+            }
+
+            soak.seed = replay.seed;
+            soak.game_ticks = 0;
+            unsigned int before = soak.games;
+            if (replay_play(&replay, &soak_tick, &soak) < 0 || soak.games == before)
+            {
+                // Corrupt, or it never reached the end of a game.
+                soak.games++;
+                soak.broken++;
+            }
+            else if (playfield_state_hash(soak.playfield) != replay.final_hash)
+            {
+                soak.broken++;
+            }
+        }
+        fclose(fp);
+    }
+    else
+    {
+        for (uint64_t index = 0; soak.games < games; index++)
+        {
+            soak_random_tick(&soak, index);
+        }
+    }
+    double seconds = (double)(host_wall_us() - start) / 1000000.0;
+
+    printf("%u games in %.3f s, %.1f games/sec\n", soak.games, seconds, soak.games / seconds);
+    printf("%llu ticks, %.0f ticks/sec (%.0fx a %dhz display)\n",
+        (unsigned long long)soak.ticks, soak.ticks / seconds, (soak.ticks / seconds) / SIM_TICK_RATE, SIM_TICK_RATE);
+    printf("tick logic: avg %.0f ns, slowest %llu ns\n", (double)soak.tick_ns / soak.ticks, (unsigned long long)soak.slowest);
+    for (int bucket = 0; bucket < SOAK_BUCKETS; bucket++)
+    {
+        uint64_t high = (uint64_t)SOAK_BUCKET_BASE << bucket;
+        if (bucket < SOAK_BUCKETS - 1)
+        {
+            printf("  < %8llu ns %10llu %6.2f%%\n", (unsigned long long)high, (unsigned long long)soak.buckets[bucket], (100.0 * soak.buckets[bucket]) / soak.ticks);
+        }
+        else
+        {
+            printf(" >= %8llu ns %10llu %6.2f%%\n", (unsigned long long)(high >> 1), (unsigned long long)soak.buckets[bucket], (100.0 * soak.buckets[bucket]) / soak.ticks);
+        }
+    }
+    if (profile)
+    {
+        printf("last %u ticks by phase, in us:\n", profiler_frames());
+        profiler_write_report(stdout);
+    }
+    if (trace)
+    {
+        FILE *fp = fopen(trace, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Can't open %s for writing!\n", trace);
+            return 1;
+        }
+        trace_write_json(fp);
+        fclose(fp);
+        printf("wrote trace to %s\n", trace);
+    }
+    if (watchdog)
+    {
+        FILE *fp = fopen(watchdog, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Can't open %s for writing!\n", watchdog);
+            return 1;
+        }
+        watchdog_write_log(fp);
+        fclose(fp);
+        printf("wrote %u of the ticks over %u us to %s\n", watchdog_count(), watchdog_budget(), watchdog);
+    }
+    printf("%s\n", soak.broken ? "Some games ended up broken!" : "Every game ended up sane.");
+
+    playfield_free(soak.playfield);
+    return soak.broken ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int games = 0;
+    uint32_t seed = DEFAULT_SEED;
+    unsigned int threads = 0;
+    int check = 0;
+    const char *record = 0;
+    unsigned int seconds = DEFAULT_CHECK_SECONDS;
+    int soak = 0;
+    const char *script = 0;
+    int profile = 0;
+    const char *trace = 0;
+    const char *watchdog = 0;
+    uint32_t budget = WATCHDOG_DEFAULT_BUDGET;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            games = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--check") == 0)
+        {
+            check = 1;
+        }
+        else if (strcmp(argv[i], "--soak") == 0)
+        {
+            soak = 1;
+        }
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc)
+        {
+            script = argv[++i];
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            profile = 1;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace = argv[++i];
+        }
+        else if (strcmp(argv[i], "--watchdog") == 0 && i + 1 < argc)
+        {
+            watchdog = argv[++i];
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            budget = strtoul(argv[++i], 0, 0);
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            record = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--games N] [--seed S] [--check [--seconds N] [--record FILE]] [--threads N] [--soak [--script FILE] [--profile] [--trace FILE] [--watchdog FILE [--budget US]]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if ((profile && !PROFILER_ENABLED) || (trace && !TRACE_ENABLED))
+    {
+        fprintf(stderr, "Profiling and tracing need the instrumented build, try headless-instrumented!\n");
+        return 1;
+    }
+    if (threads > 1 && (PROFILER_ENABLED || TRACE_ENABLED))
+    {
+        fprintf(stderr, "The instrumented build can only play one board at a time, use headless for --threads!\n");
+        return 1;
+    }
+
+    // The profiler times phases off the same clock the game does.
+    clock_init();
+
+    if (check)
+    {
+        return run_check(seed, seconds, record);
+    }
+    if (soak)
+    {
+        return run_soak(games ? games : DEFAULT_SOAK_GAMES, seed, script, profile, trace, watchdog, budget);
+    }
+    if (threads)
+    {
+        return run_stress(threads, games ? games : DEFAULT_STRESS_GAMES, seed);
+    }
+    return run_throughput(games ? games : DEFAULT_GAMES, seed);
+}
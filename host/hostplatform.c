@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "playfield.h"
+#include "hostplatform.h"
+
+static void host_sound(int sound, void *user)
+{
+    host_platform_t *host = (host_platform_t *)user;
+    host->sounds[sound]++;
+}
+
+static uint64_t host_time(void *user)
+{
+    host_platform_t *host = (host_platform_t *)user;
+    return host->wall ? host_wall_us() : host->now;
+}
+
+void host_platform_init(host_platform_t *host, int wall)
+{
+    memset(host, 0, sizeof(host_platform_t));
+    host->platform.sound = &host_sound;
+    host->platform.time = &host_time;
+    host->platform.user = host;
+    host->wall = wall;
+}
+
+playfield_t *host_playfield_new(host_platform_t *host)
+{
+    playfield_rules_t rules;
+    playfield_default_rules(&rules);
+    return playfield_new(&host->platform, &rules, 0, PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT);
+}
+
+uint64_t host_wall_us()
+{
+    return host_wall_ns() / 1000;
+}
+
+uint64_t host_wall_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
@@ -0,0 +1,29 @@
+#ifndef __HOSTPLATFORM_H
+#define __HOSTPLATFORM_H
+
+#include <stdint.h>
+#include "playfield.h"
+
+// The platform host tools run the engine on. There's nothing to play sounds
+// on, so they get counted instead, and the engine's clock reads whatever now
+// is set to, or the wall clock for tools where real time has to pass, like
+// anything that gives hints a time budget.
+typedef struct
+{
+    playfield_platform_t platform;
+    unsigned int sounds[PLAYFIELD_SOUND_COUNT];
+    uint64_t now;
+    int wall;
+} host_platform_t;
+
+void host_platform_init(host_platform_t *host, int wall);
+
+// A playfield with the shipping size and rules on a host platform, which has
+// to stay around for as long as the playfield does.
+playfield_t *host_playfield_new(host_platform_t *host);
+
+// Monotonic wall clock, for timing things.
+uint64_t host_wall_us();
+uint64_t host_wall_ns();
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <naomi/thread.h>
+#include "clock.h"
+#include "input.h"
+#include "latency.h"
+
+// Feeds a scripted set of taps through a stub input source and measures how
+// long it takes for each tap to change game state, both with the old "poll
+// once at the top of the frame" approach and with input threads polling at
+// a few different rates side by side, INPUT_POLL_RATE among them. Presses
+// from the one at INPUT_POLL_RATE are also run through the same
+// press-to-display tracking the game uses, which can be exported with --log.
+// The per-frame poll's average only covers the taps it saw at all, and it
+// always samples right at the top of the frame, so a thread can't beat it on
+// average latency. What a thread gets is every tap, with a timestamp close
+// to when it really happened, for a bit of latency that shrinks as the poll
+// rate goes up.
+
+#define FRAME_TIME 16667
+#define TAP_COUNT 100
+
+// Input thread poll rates to compare, INPUT_POLL_RATE has to be one of them.
+static const uint32_t rates[] = { 60, 120, 240, 1000 };
+#define RATE_COUNT (sizeof(rates) / sizeof(rates[0]))
+
+typedef struct
+{
+    uint64_t start;
+    uint64_t end;
+} tap_t;
+
+typedef struct
+{
+    char name[32];
+    int next;
+    int seen;
+    uint64_t total;
+    uint64_t max;
+} method_t;
+
+static tap_t taps[TAP_COUNT];
+static uint64_t epoch;
+
+uint32_t stub_sample(void *user)
+{
+    uint64_t now = clock_us() - epoch;
+
+    for (int i = 0; i < TAP_COUNT; i++)
+    {
+        if (now >= taps[i].start && now < taps[i].end)
+        {
+            return INPUT_BUTTON1;
+        }
+    }
+
+    return 0;
+}
+
+void method_saw_press(method_t *method, uint64_t now)
+{
+    // Attribute the press to the earliest tap that had started by now.
+    while (method->next < TAP_COUNT && taps[method->next].start <= now)
+    {
+        if (method->next + 1 < TAP_COUNT && taps[method->next + 1].start <= now)
+        {
+            // We never saw this tap at all.
+            method->next++;
+            continue;
+        }
+
+        uint64_t latency = now - taps[method->next].start;
+        method->total += latency;
+        method->max = latency > method->max ? latency : method->max;
+        method->seen++;
+        method->next++;
+        break;
+    }
+}
+
+void method_report(method_t *method)
+{
+    printf(
+        "%-16s %3d/%d taps seen, avg %6u us, max %6u us\n",
+        method->name, method->seen, TAP_COUNT,
+        method->seen ? (uint32_t)(method->total / method->seen) : 0,
+        (uint32_t)method->max
+    );
+}
+
+int main(int argc, char *argv[])
+{
+    const char *logfile = 0;
+    if (argc == 3 && strcmp(argv[1], "--log") == 0)
+    {
+        logfile = argv[2];
+    }
+
+    // Taps of varying length, some shorter than a frame, with room between them.
+    uint32_t seed = 12345;
+    uint64_t when = 100000;
+    for (int i = 0; i < TAP_COUNT; i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        taps[i].start = when + ((seed >> 8) % 50000);
+        taps[i].end = taps[i].start + 5000 + ((seed >> 16) % 60000);
+        when = taps[i].end + 80000;
+    }
+
+    clock_init();
+    epoch = clock_us();
+
+    static input_t inputs[RATE_COUNT];
+    static method_t threaded[RATE_COUNT];
+    uint64_t event_error[RATE_COUNT] = { 0 };
+    unsigned int event_count[RATE_COUNT] = { 0 };
+    for (unsigned int r = 0; r < RATE_COUNT; r++)
+    {
+        input_init(&inputs[r], &stub_sample, 0, 1000000 / rates[r]);
+        snprintf(threaded[r].name, sizeof(threaded[r].name), "thread at %u Hz", rates[r]);
+    }
+
+    method_t polled = { "per-frame poll", 0, 0, 0, 0 };
+    input_frame_t *frame = malloc(sizeof(input_frame_t));
+    uint32_t last_polled = 0;
+
+    static latency_t latency;
+    latency_init(&latency);
+
+    uint64_t frame_start = clock_us() - epoch;
+    while (frame_start < when + 100000)
+    {
+        // The old way, sample exactly once right now.
+        uint32_t current = stub_sample(0);
+        if (current & ~last_polled)
+        {
+            method_saw_press(&polled, frame_start);
+        }
+        last_polled = current;
+
+        // The new way, everything since the last frame in order.
+        for (unsigned int r = 0; r < RATE_COUNT; r++)
+        {
+            input_frame(&inputs[r], frame);
+            for (unsigned int i = 0; i < frame->num_events; i++)
+            {
+                if (frame->events[i].type == INPUT_EVENT_PRESS)
+                {
+                    method_saw_press(&threaded[r], frame_start);
+                    if (rates[r] == INPUT_POLL_RATE)
+                    {
+                        latency_tag(&latency, frame->events[i].timestamp);
+                    }
+
+                    uint64_t stamp = frame->events[i].timestamp - epoch;
+                    uint64_t actual = taps[threaded[r].next - 1].start;
+                    event_error[r] += stamp > actual ? stamp - actual : actual - stamp;
+                    event_count[r]++;
+                }
+            }
+        }
+
+        // Pretend to draw and wait for vblank.
+        uint64_t next = frame_start + FRAME_TIME;
+        uint64_t now = clock_us() - epoch;
+        if (next > now)
+        {
+            thread_sleep(next - now);
+        }
+        latency_present(&latency, clock_us());
+        frame_start = clock_us() - epoch;
+    }
+
+    method_report(&polled);
+    for (unsigned int r = 0; r < RATE_COUNT; r++)
+    {
+        input_free(&inputs[r]);
+        method_report(&threaded[r]);
+        printf(
+            "%-16s %u polls, %u overflows, event timestamps within %u us of the real press on average\n",
+            "", inputs[r].polls, inputs[r].overflows, event_count[r] ? (uint32_t)(event_error[r] / event_count[r]) : 0
+        );
+    }
+
+
+    latency_stats_t stats;
+    latency_stats(&latency, &stats);
+    printf(
+        "press to display: %u samples, min %u us, median %u us, p99 %u us, max %u us\n",
+        stats.count, stats.min, stats.median, stats.p99, stats.max
+    );
+
+    if (logfile)
+    {
+        FILE *fp = fopen(logfile, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Could not open %s for writing!\n", logfile);
+            free(frame);
+            return 1;
+        }
+        latency_write_log(&latency, fp);
+        fclose(fp);
+    }
+
+    free(frame);
+    return 0;
+}
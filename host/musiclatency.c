@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <naomi/thread.h>
+#include "clock.h"
+#include "music.h"
+#include "trace.h"
+
+// Measures how long it takes from pressing start to the first samples of the
+// game's music being queued, both the way the game used to do it (load the
+// module once start is pressed) and with the track preloaded in the background.
+// Pass --trace file.json to also write a Chrome trace of the mixer thread.
+
+#define TRACK_COUNT 5
+#define CROSSFADE_TIME 500000
+#define RUNS 3
+
+uint32_t wait_for_start()
+{
+    uint32_t latency;
+    while ((latency = music_start_latency()) == 0)
+    {
+        thread_sleep(100);
+    }
+    return latency;
+}
+
+void report(const char * const name, uint32_t *latencies, int count)
+{
+    uint32_t min = latencies[0];
+    uint32_t max = latencies[0];
+    uint64_t total = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        min = latencies[i] < min ? latencies[i] : min;
+        max = latencies[i] > max ? latencies[i] : max;
+        total += latencies[i];
+    }
+
+    printf("%-24s min %8u us, avg %8u us, max %8u us\n", name, min, (uint32_t)(total / count), max);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = "../assets/music";
+    const char *tracefile = 0;
+    uint32_t cold[TRACK_COUNT * RUNS];
+    uint32_t warm[TRACK_COUNT * RUNS];
+    int count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracefile = argv[++i];
+        }
+        else
+        {
+            dir = argv[i];
+        }
+    }
+
+    clock_init();
+    music_init();
+
+    for (int run = 0; run < RUNS; run++)
+    {
+        for (int i = 0; i < TRACK_COUNT; i++)
+        {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/ts%d.xm", dir, i + 1);
+
+            // Start pressed with nothing loaded yet.
+            music_track_t *track = music_preload(path);
+            music_play(track, 0);
+            cold[count] = wait_for_start();
+            music_stop(0);
+            music_free(track);
+
+            // Start pressed after the track was loaded during the title screen.
+            track = music_preload(path);
+            while (track->state == MUSIC_STATE_LOADING)
+            {
+                thread_sleep(1000);
+            }
+            if (track->state == MUSIC_STATE_ERROR)
+            {
+                fprintf(stderr, "Could not load %s!\n", path);
+                return 1;
+            }
+            music_play(track, CROSSFADE_TIME);
+            warm[count] = wait_for_start();
+            music_stop(0);
+            music_free(track);
+
+            count++;
+        }
+    }
+
+    report("load on start", cold, count);
+    report("preloaded", warm, count);
+
+    if (tracefile)
+    {
+        FILE *fp = fopen(tracefile, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Could not open %s!\n", tracefile);
+            return 1;
+        }
+        trace_write_json(fp);
+        fclose(fp);
+    }
+    return 0;
+}
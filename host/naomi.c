@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include "naomi/thread.h"
+#include "naomi/timer.h"
+#include "naomi/audio.h"
+#include "naomi/video.h"
+
+// Host implementations of the libnaomi calls declared in host/naomi/.
+
+#define MAX_THREADS 64
+#define MAX_TIMERS 64
+
+typedef struct
+{
+    int used;
+    int started;
+    pthread_t thread;
+    thread_func_t function;
+    void *param;
+} host_thread_t;
+
+static host_thread_t threads[MAX_THREADS];
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t host_clock_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+uint32_t thread_create(const char * const name, thread_func_t function, void *param)
+{
+    pthread_mutex_lock(&threads_lock);
+    for (uint32_t i = 1; i < MAX_THREADS; i++)
+    {
+        if (!threads[i].used)
+        {
+            memset(&threads[i], 0, sizeof(host_thread_t));
+            threads[i].used = 1;
+            threads[i].function = function;
+            threads[i].param = param;
+            pthread_mutex_unlock(&threads_lock);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&threads_lock);
+
+    fprintf(stderr, "Out of threads creating %s!\n", name);
+    abort();
+}
+
+void thread_start(uint32_t tid)
+{
+    if (tid < MAX_THREADS && threads[tid].used && !threads[tid].started)
+    {
+        threads[tid].started = 1;
+        pthread_create(&threads[tid].thread, 0, threads[tid].function, threads[tid].param);
+    }
+}
+
+void thread_priority(uint32_t tid, int priority)
+{
+    // The host scheduler is good enough, nothing to do here.
+}
+
+void *thread_join(uint32_t tid)
+{
+    void *retval = 0;
+
+    if (tid < MAX_THREADS && threads[tid].used)
+    {
+        if (threads[tid].started)
+        {
+            pthread_join(threads[tid].thread, &retval);
+        }
+
+        pthread_mutex_lock(&threads_lock);
+        threads[tid].used = 0;
+        pthread_mutex_unlock(&threads_lock);
+    }
+
+    return retval;
+}
+
+void thread_sleep(uint32_t microseconds)
+{
+    usleep(microseconds);
+}
+
+void thread_yield()
+{
+    sched_yield();
+}
+
+uint32_t thread_id()
+{
+    pthread_t self = pthread_self();
+    for (uint32_t i = 1; i < MAX_THREADS; i++)
+    {
+        if (threads[i].used && threads[i].started && pthread_equal(threads[i].thread, self))
+        {
+            return i;
+        }
+    }
+
+    // Main thread.
+    return 0;
+}
+
+void mutex_init(mutex_t *mutex)
+{
+    pthread_mutex_init(&mutex->mutex, 0);
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+int mutex_try_lock(mutex_t *mutex)
+{
+    return pthread_mutex_trylock(&mutex->mutex) == 0;
+}
+
+void mutex_unlock(mutex_t *mutex)
+{
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+void mutex_free(mutex_t *mutex)
+{
+    pthread_mutex_destroy(&mutex->mutex);
+}
+
+typedef struct
+{
+    int used;
+    uint64_t start;
+    uint64_t end;
+} host_timer_t;
+
+static host_timer_t timers[MAX_TIMERS];
+static pthread_mutex_t timers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int host_timer_alloc(uint64_t length)
+{
+    pthread_mutex_lock(&timers_lock);
+    for (int i = 0; i < MAX_TIMERS; i++)
+    {
+        if (!timers[i].used)
+        {
+            timers[i].used = 1;
+            timers[i].start = host_clock_us();
+            timers[i].end = timers[i].start + length;
+            pthread_mutex_unlock(&timers_lock);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&timers_lock);
+    return -1;
+}
+
+static void host_timer_free(int timer)
+{
+    pthread_mutex_lock(&timers_lock);
+    timers[timer].used = 0;
+    pthread_mutex_unlock(&timers_lock);
+}
+
+int timer_start(uint32_t microseconds)
+{
+    return host_timer_alloc(microseconds);
+}
+
+uint32_t timer_left(int timer)
+{
+    if (timer < 0 || timer >= MAX_TIMERS || !timers[timer].used)
+    {
+        return 0;
+    }
+
+    uint64_t now = host_clock_us();
+    return now >= timers[timer].end ? 0 : (uint32_t)(timers[timer].end - now);
+}
+
+void timer_stop(int timer)
+{
+    if (timer >= 0 && timer < MAX_TIMERS)
+    {
+        host_timer_free(timer);
+    }
+}
+
+int profile_start()
+{
+    return host_timer_alloc(0);
+}
+
+uint32_t profile_end(int profile)
+{
+    if (profile < 0 || profile >= MAX_TIMERS || !timers[profile].used)
+    {
+        return 0;
+    }
+
+    uint32_t elapsed = (uint32_t)(host_clock_us() - timers[profile].start);
+    host_timer_free(profile);
+    return elapsed;
+}
+
+static struct
+{
+    int registered;
+    unsigned int samplerate;
+    unsigned int size;
+    uint64_t written;
+    uint64_t epoch;
+} ringbuffer;
+
+int audio_register_ringbuffer(int format, unsigned int samplerate, unsigned int num_samples)
+{
+    ringbuffer.registered = 1;
+    ringbuffer.samplerate = samplerate;
+    ringbuffer.size = num_samples;
+    ringbuffer.written = 0;
+    ringbuffer.epoch = host_clock_us();
+    return 0;
+}
+
+void audio_unregister_ringbuffer()
+{
+    ringbuffer.registered = 0;
+}
+
+int audio_write_stereo_data(void *data, unsigned int num_samples)
+{
+    if (!ringbuffer.registered)
+    {
+        return 0;
+    }
+
+    // Work out how much has "played" since we started, and only accept as
+    // much as would fit in the real ringbuffer.
+    uint64_t played = ((host_clock_us() - ringbuffer.epoch) * ringbuffer.samplerate) / 1000000;
+    if (played > ringbuffer.written)
+    {
+        // Underran, the hardware would have played silence.
+        ringbuffer.written = played;
+    }
+
+    uint64_t queued = ringbuffer.written - played;
+    unsigned int room = queued >= ringbuffer.size ? 0 : ringbuffer.size - (unsigned int)queued;
+    unsigned int accepted = num_samples < room ? num_samples : room;
+    ringbuffer.written += accepted;
+    return accepted;
+}
+
+int audio_register_sound(int format, unsigned int samplerate, void *data, unsigned int num_samples)
+{
+    static int next_sound = 0;
+    return next_sound++;
+}
+
+int audio_play_registered_sound(int sound, uint32_t speakers, float volume)
+{
+    return 0;
+}
+
+color_t rgb(unsigned int r, unsigned int g, unsigned int b)
+{
+    color_t color = { r, g, b, 255 };
+    return color;
+}
+
+void video_draw_box(int x0, int y0, int x1, int y1, color_t color)
+{
+}
+
+void video_draw_sprite(int x, int y, int width, int height, void *data)
+{
+}
+
+void video_draw_debug_text(int x, int y, color_t color, const char * const msg, ...)
+{
+    // The real thing has to format the text before it can draw it.
+    char buffer[2048];
+    va_list args;
+    va_start(args, msg);
+    vsnprintf(buffer, sizeof(buffer), msg, args);
+    va_end(args);
+}
@@ -0,0 +1,22 @@
+#ifndef __HOST_NAOMI_AUDIO_H
+#define __HOST_NAOMI_AUDIO_H
+
+#include <stdint.h>
+
+#define AUDIO_FORMAT_16BIT 0
+#define AUDIO_FORMAT_8BIT 1
+#define AUDIO_FORMAT_4BIT 2
+
+#define SPEAKER_LEFT 1
+#define SPEAKER_RIGHT 2
+
+// The ringbuffer drains at the registered sample rate against the host clock
+// and discards what it plays, so streaming code paces exactly like on target.
+int audio_register_ringbuffer(int format, unsigned int samplerate, unsigned int num_samples);
+void audio_unregister_ringbuffer();
+int audio_write_stereo_data(void *data, unsigned int num_samples);
+
+int audio_register_sound(int format, unsigned int samplerate, void *data, unsigned int num_samples);
+int audio_play_registered_sound(int sound, uint32_t speakers, float volume);
+
+#endif
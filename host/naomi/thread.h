@@ -0,0 +1,30 @@
+#ifndef __HOST_NAOMI_THREAD_H
+#define __HOST_NAOMI_THREAD_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// Just enough of libnaomi's threading API, backed by pthreads, to run the
+// game's threaded modules on the host.
+typedef void *(*thread_func_t)(void *param);
+
+uint32_t thread_create(const char * const name, thread_func_t function, void *param);
+void thread_start(uint32_t tid);
+void thread_priority(uint32_t tid, int priority);
+void *thread_join(uint32_t tid);
+void thread_sleep(uint32_t microseconds);
+void thread_yield();
+uint32_t thread_id();
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+} mutex_t;
+
+void mutex_init(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+int mutex_try_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+void mutex_free(mutex_t *mutex);
+
+#endif
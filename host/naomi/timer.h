@@ -0,0 +1,14 @@
+#ifndef __HOST_NAOMI_TIMER_H
+#define __HOST_NAOMI_TIMER_H
+
+#include <stdint.h>
+
+// libnaomi's timers and profiling counters on top of the host's monotonic clock.
+int timer_start(uint32_t microseconds);
+uint32_t timer_left(int timer);
+void timer_stop(int timer);
+
+int profile_start();
+uint32_t profile_end(int profile);
+
+#endif
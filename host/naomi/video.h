@@ -0,0 +1,22 @@
+#ifndef __HOST_NAOMI_VIDEO_H
+#define __HOST_NAOMI_VIDEO_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} color_t;
+
+color_t rgb(unsigned int r, unsigned int g, unsigned int b);
+
+// Nothing is ever shown, the drawing calls only format what they're given
+// so drawing code can be timed on its own.
+void video_draw_box(int x0, int y0, int x1, int y1, color_t color);
+void video_draw_sprite(int x, int y, int width, int height, void *data);
+void video_draw_debug_text(int x, int y, color_t color, const char * const msg, ...);
+
+#endif
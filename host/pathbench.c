@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "rng.h"
+#include "playfield.h"
+#include "hostplatform.h"
+
+// Times getting every lit beam's cells in order after a solve, the way the
+// renderer and scoring want them, two ways:
+//
+//  extract: reading the beams the solve wrote down
+//  rewalk:  walking the pipes from every lit source again into a list,
+//           which is what anything wanting beams had to do before
+//
+// Both get timed together with the solve before them, since that's when
+// anything would ask, for a solve from scratch and for a drop that only
+// solves the chains around it. Boards are partly filled with random pipes
+// with a straight pipe across every other row so there's plenty lit. Every
+// rewalk gets checked against what was extracted, and it exits nonzero if
+// they ever find different beams.
+//
+// Times are in microseconds.
+
+#define BOARD_SEED 1
+#define FILL_PERCENT 60
+#define DEFAULT_DROPS 200
+
+typedef struct
+{
+    int width;
+    int height;
+} board_size_t;
+
+static const board_size_t sizes[] = {
+    { PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT },
+    { 64, 64 },
+    { 256, 256 },
+};
+
+// What came out of finding every beam, to make sure both ways found the
+// same ones and to keep the compiler from throwing the work away.
+typedef struct
+{
+    int beams;
+    int cells;
+    uint64_t sum;
+} found_t;
+
+// Scratch space for rewalking, the same size as a board.
+typedef struct
+{
+    int *cells;
+    uint32_t *seen;
+    uint32_t pass;
+} walk_t;
+
+// Runs on the wall clock, same as the game would.
+static host_platform_t host;
+
+static const unsigned int shapes[6] = {
+    PIPE_CONN_N | PIPE_CONN_S, PIPE_CONN_E | PIPE_CONN_W,
+    PIPE_CONN_N | PIPE_CONN_E, PIPE_CONN_N | PIPE_CONN_W,
+    PIPE_CONN_S | PIPE_CONN_E, PIPE_CONN_S | PIPE_CONN_W,
+};
+
+static playfield_t *new_board(int width, int height)
+{
+    playfield_rules_t rules;
+    playfield_default_rules(&rules);
+
+    playfield_t *playfield = playfield_new(&host.platform, &rules, 0, width, height);
+    playfield_run(playfield, BOARD_SEED);
+
+    rng_t rng;
+    rng_seed(&rng, BOARD_SEED);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            playfield_entry_t *entry = playfield_entry(playfield, x, y);
+            if ((y % 2) == 1)
+            {
+                entry->block = BLOCK_TYPE_PURPLE;
+                entry->pipe = PIPE_CONN_E | PIPE_CONN_W;
+            }
+            else if (rng_range(&rng, 100) < FILL_PERCENT)
+            {
+                entry->block = rng_range(&rng, 4) + BLOCK_TYPE_PURPLE;
+                entry->pipe = shapes[rng_range(&rng, 6)];
+            }
+        }
+    }
+    playfield_rehash(playfield);
+    playfield_check_connections(playfield);
+    return playfield;
+}
+
+static void add_beam(found_t *found, int length, int from, int to)
+{
+    found->beams++;
+    found->cells += length;
+    found->sum += ((uint64_t)(from + 1) * (to + 2)) ^ length;
+}
+
+static void extract(playfield_t *playfield, found_t *found)
+{
+    memset(found, 0, sizeof(found_t));
+    for (int i = 0; i < playfield->beam_count; i++)
+    {
+        playfield_beam_t *beam = &playfield->beams[i];
+        if (beam->length == 0)
+        {
+            continue;
+        }
+
+        // Beams could be written down from either end, so count them from
+        // the same one rewalking does.
+        int from = beam->from < beam->to ? beam->from : beam->to;
+        int to = beam->from < beam->to ? beam->to : beam->from;
+        int *cells = playfield->beam_cells + beam->first;
+        for (int j = 0; j < beam->length; j++)
+        {
+            found->sum += cells[j] * (beam->from == from ? j + 1 : beam->length - j);
+        }
+        add_beam(found, beam->length, from, to);
+    }
+}
+
+static int source_at(playfield_t *playfield, int x, int y, int direction)
+{
+    switch(direction)
+    {
+        case PIPE_CONN_W:
+            return y;
+        case PIPE_CONN_E:
+            return playfield->height + y;
+        case PIPE_CONN_S:
+            return (2 * playfield->height) + x;
+        default:
+            return (2 * playfield->height) + playfield->width + x;
+    }
+}
+
+static void rewalk(playfield_t *playfield, walk_t *walk, found_t *found)
+{
+    memset(found, 0, sizeof(found_t));
+    walk->pass++;
+
+    int width = playfield->width;
+    int height = playfield->height;
+    for (int i = 0; i < (width * 2) + (height * 2); i++)
+    {
+        if (playfield->sources[i].color == SOURCE_COLOR_NONE)
+        {
+            continue;
+        }
+
+        int x;
+        int y;
+        unsigned int in_direction;
+        if (i < height)
+        {
+            x = 0;
+            y = i;
+            in_direction = PIPE_CONN_W;
+        }
+        else if (i < 2 * height)
+        {
+            x = width - 1;
+            y = i - height;
+            in_direction = PIPE_CONN_E;
+        }
+        else if (i < (2 * height) + width)
+        {
+            x = i - (2 * height);
+            y = height - 1;
+            in_direction = PIPE_CONN_S;
+        }
+        else
+        {
+            x = i - (2 * height) - width;
+            y = 0;
+            in_direction = PIPE_CONN_N;
+        }
+
+        // Lit beams get found from both ends, so only take them once.
+        playfield_entry_t *cur = playfield_entry(playfield, x, y);
+        if (cur->color == SOURCE_COLOR_NONE || cur->color == SOURCE_COLOR_IMPOSSIBLE ||
+            (cur->pipe & in_direction) == 0 || walk->seen[x + (y * width)] == walk->pass)
+        {
+            continue;
+        }
+
+        int length = 0;
+        int to = -1;
+        while (1)
+        {
+            cur = playfield_entry(playfield, x, y);
+            if ((cur->pipe & in_direction) == 0)
+            {
+                break;
+            }
+
+            int cell = x + (y * width);
+            walk->seen[cell] = walk->pass;
+            walk->cells[length++] = cell;
+
+            unsigned int out_direction = cur->pipe & (~in_direction);
+            if ((out_direction == PIPE_CONN_N && y == 0) || (out_direction == PIPE_CONN_S && y == height - 1) ||
+                (out_direction == PIPE_CONN_W && x == 0) || (out_direction == PIPE_CONN_E && x == width - 1))
+            {
+                to = source_at(playfield, x, y, out_direction);
+                break;
+            }
+
+            x += out_direction == PIPE_CONN_E ? 1 : (out_direction == PIPE_CONN_W ? -1 : 0);
+            y += out_direction == PIPE_CONN_S ? 1 : (out_direction == PIPE_CONN_N ? -1 : 0);
+            // Comes into the next cell from the opposite side.
+            in_direction = ((out_direction << 2) | (out_direction >> 2)) & 0xF;
+        }
+
+        int from = i < to ? i : to;
+        for (int j = 0; j < length; j++)
+        {
+            found->sum += walk->cells[j] * (i == from ? j + 1 : length - j);
+        }
+        add_beam(found, length, from, i < to ? to : i);
+    }
+}
+
+static int find_empty(playfield_t *playfield, rng_t *rng, int *x, int *y)
+{
+    // Start somewhere random and take the first spot we can drop into.
+    int cells = playfield->width * playfield->height;
+    int start = rng_range(rng, cells);
+    for (int i = 0; i < cells; i++)
+    {
+        int cell = (start + i) % cells;
+        *x = cell % playfield->width;
+        *y = cell / playfield->width;
+        if (playfield_entry(playfield, *x, *y)->block == BLOCK_TYPE_NONE)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Solve from scratch and find the beams, repeats times, one way or the other.
+static double time_solve(playfield_t *playfield, walk_t *walk, int repeats, found_t *found)
+{
+    playfield->uncached = 1;
+    uint64_t start = host_wall_ns();
+    for (int i = 0; i < repeats; i++)
+    {
+        playfield_check_connections(playfield);
+        if (walk)
+        {
+            rewalk(playfield, walk, found);
+        }
+        else
+        {
+            extract(playfield, found);
+        }
+    }
+    uint64_t elapsed = host_wall_ns() - start;
+    playfield->uncached = 0;
+
+    return (double)elapsed / (repeats * 1000.0);
+}
+
+// Drop on a copy of the board and find the beams after every drop, with
+// every drop rewalked afterwards to check what got extracted.
+static double time_drops(playfield_t *original, walk_t *walk, int drops, int rewalking, int *wrong)
+{
+    playfield_t *playfield = playfield_new(&host.platform, &original->rules, 0, original->width, original->height);
+    playfield_copy(playfield, original);
+
+    rng_t rng;
+    rng_seed(&rng, BOARD_SEED);
+
+    uint64_t elapsed = 0;
+    int dropped = 0;
+    for (int i = 0; i < drops; i++)
+    {
+        int x;
+        int y;
+        if (!find_empty(playfield, &rng, &x, &y))
+        {
+            break;
+        }
+        playfield->curx = x;
+        playfield->cury = y;
+
+        found_t found;
+        uint64_t start = host_wall_ns();
+        playfield_cursor_drop(playfield);
+        if (rewalking)
+        {
+            rewalk(playfield, walk, &found);
+        }
+        else
+        {
+            extract(playfield, &found);
+        }
+        elapsed += host_wall_ns() - start;
+        dropped++;
+
+        found_t check;
+        rewalk(playfield, walk, &check);
+        *wrong |= memcmp(&found, &check, sizeof(found_t)) != 0;
+    }
+
+    playfield_free(playfield);
+    return dropped ? (double)elapsed / (dropped * 1000.0) : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+    host_platform_init(&host, 1);
+
+    int drops = DEFAULT_DROPS;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--drops") == 0 && i + 1 < argc)
+        {
+            drops = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--drops N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (drops < 1)
+    {
+        fprintf(stderr, "need at least one drop\n");
+        return 1;
+    }
+
+    printf("%-9s %7s %7s %9s %9s %9s %9s %9s\n",
+        "size", "beams", "cells", "solve", "+extract", "+rewalk", "drop+ext", "drop+walk");
+
+    int wrong = 0;
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int width = sizes[s].width;
+        int height = sizes[s].height;
+        int cells = width * height;
+        char name[16];
+        snprintf(name, sizeof(name), "%dx%d", width, height);
+
+        // Enough repeats that small boards don't just measure the clock.
+        int repeats = 1 + (200000 / cells);
+
+        playfield_t *playfield = new_board(width, height);
+        walk_t walk;
+        walk.cells = malloc(sizeof(int) * cells);
+        walk.seen = malloc(sizeof(uint32_t) * cells);
+        memset(walk.seen, 0, sizeof(uint32_t) * cells);
+        walk.pass = 0;
+
+        // The solve on its own, so what finding beams adds is easy to see.
+        playfield->uncached = 1;
+        uint64_t start = host_wall_ns();
+        for (int i = 0; i < repeats; i++)
+        {
+            playfield_check_connections(playfield);
+        }
+        double solve = (double)(host_wall_ns() - start) / (repeats * 1000.0);
+        playfield->uncached = 0;
+
+        found_t extracted;
+        found_t rewalked;
+        double solve_extract = time_solve(playfield, 0, repeats, &extracted);
+        double solve_rewalk = time_solve(playfield, &walk, repeats, &rewalked);
+        wrong |= memcmp(&extracted, &rewalked, sizeof(found_t)) != 0;
+
+        double drop_extract = time_drops(playfield, &walk, drops, 0, &wrong);
+        double drop_rewalk = time_drops(playfield, &walk, drops, 1, &wrong);
+
+        printf("%-9s %7d %7d %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+            name, extracted.beams, extracted.cells, solve, solve_extract, solve_rewalk, drop_extract, drop_rewalk);
+
+        free(walk.cells);
+        free(walk.seen);
+        playfield_free(playfield);
+    }
+
+    printf("%s\n", wrong ? "Extracted beams disagree with walking the pipes!" : "Extracted beams matched walking the pipes.");
+    return wrong ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "repeat.h"
+#include "sim.h"
+
+// Drives the autorepeat in repeat.h off a made up clock and checks that held
+// buttons repeat exactly when they're meant to:
+//
+//  delay:   nothing before the initial delay, then the first repeat right on it
+//  rate:    every repeat after that one exactly the subsequent delay apart
+//  ticks:   at the game's tick rate, repeats land on the first tick they're
+//           due and average out to the right rate instead of rounding down to
+//           every other tick
+//  hitch:   after a long stall, one repeat and then a fresh schedule instead
+//           of a burst of catch-up repeats
+//  release: letting go stops repeats until the next press, and so does a
+//           reset, and buttons that were never pressed don't repeat at all
+//
+// Exits nonzero if anything fires at the wrong time.
+
+#define EPOCH 1000000
+#define STEP_US 1
+
+static int failures = 0;
+
+static void expect(const char *name, int ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("%-8s FAIL: %s\n", name, what);
+        failures++;
+    }
+}
+
+// Holds a button pressed at EPOCH and steps the clock by step microseconds
+// until end, writing down when repeats fired. Returns how many did.
+static int hold(repeat_t *repeat, uint64_t step, uint64_t end, uint64_t *fired, int most)
+{
+    int count = 0;
+    repeat_press(repeat, EPOCH);
+    for (uint64_t now = EPOCH + step; now <= end; now += step)
+    {
+        if (repeat_update(repeat, 1, now))
+        {
+            if (count < most)
+            {
+                fired[count] = now;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+static void check_delay()
+{
+    repeat_t repeat;
+    uint64_t fired[64];
+    repeat_reset(&repeat);
+
+    int count = hold(&repeat, STEP_US, EPOCH + REPEAT_INITIAL_DELAY - STEP_US, fired, 64);
+    expect("delay", count == 0, "repeated before the initial delay was up");
+
+    count = hold(&repeat, STEP_US, EPOCH + REPEAT_INITIAL_DELAY, fired, 64);
+    expect("delay", count == 1 && fired[0] == EPOCH + REPEAT_INITIAL_DELAY, "first repeat wasn't right on the initial delay");
+    printf("delay    first repeat %d us after the press\n", count ? (int)(fired[0] - EPOCH) : -1);
+}
+
+static void check_rate()
+{
+    repeat_t repeat;
+    uint64_t fired[64];
+    repeat_reset(&repeat);
+
+    // Long enough for the first repeat and then 40 more.
+    uint64_t end = EPOCH + REPEAT_INITIAL_DELAY + (40 * REPEAT_SUBSEQUENT_DELAY);
+    int count = hold(&repeat, STEP_US, end, fired, 64);
+    expect("rate", count == 41, "wrong number of repeats");
+
+    int wrong = 0;
+    for (int i = 1; i < count && i < 64; i++)
+    {
+        wrong |= fired[i] - fired[i - 1] != REPEAT_SUBSEQUENT_DELAY;
+    }
+    expect("rate", !wrong, "repeats weren't evenly spaced");
+    printf("rate     %d repeats %d us apart after the first\n", count - 1, REPEAT_SUBSEQUENT_DELAY);
+}
+
+static void check_ticks()
+{
+    repeat_t repeat;
+    uint64_t fired[128];
+    repeat_reset(&repeat);
+
+    // Ticks don't land on the repeat times, so every repeat should come on
+    // the first tick at or after when it was due.
+    uint64_t tick = 1000000 / SIM_TICK_RATE;
+    uint64_t end = EPOCH + REPEAT_INITIAL_DELAY + 2000000;
+    int count = hold(&repeat, tick, end, fired, 128);
+
+    int late = 0;
+    uint64_t due = EPOCH + REPEAT_INITIAL_DELAY;
+    for (int i = 0; i < count && i < 128; i++)
+    {
+        late |= fired[i] < due || fired[i] >= due + tick;
+        due += REPEAT_SUBSEQUENT_DELAY;
+    }
+    expect("ticks", !late, "a repeat didn't land on the first tick it was due");
+
+    // A repeat at the very start of the window plus one every subsequent
+    // delay over the two seconds after it, give or take the last tick.
+    int expected = 1 + (2000000 / REPEAT_SUBSEQUENT_DELAY);
+    expect("ticks", count >= expected - 1 && count <= expected, "repeat rate drifted with the tick rate");
+    printf("ticks    %d repeats in 2 s at %d ticks a second\n", count - 1, SIM_TICK_RATE);
+}
+
+static void check_hitch()
+{
+    repeat_t repeat;
+    repeat_reset(&repeat);
+    repeat_press(&repeat, EPOCH);
+
+    uint64_t now = EPOCH + REPEAT_INITIAL_DELAY;
+    expect("hitch", repeat_update(&repeat, 1, now), "didn't repeat on the initial delay");
+
+    // Stall for four repeats' worth, then keep checking every microsecond.
+    now += 4 * REPEAT_SUBSEQUENT_DELAY;
+    expect("hitch", repeat_update(&repeat, 1, now), "didn't repeat after the stall");
+    uint64_t stalled = now;
+
+    int burst = 0;
+    uint64_t next = 0;
+    for (now = stalled + STEP_US; now <= stalled + REPEAT_SUBSEQUENT_DELAY; now += STEP_US)
+    {
+        if (repeat_update(&repeat, 1, now))
+        {
+            if (next == 0)
+            {
+                next = now;
+            }
+            else
+            {
+                burst++;
+            }
+        }
+    }
+    expect("hitch", next == stalled + REPEAT_SUBSEQUENT_DELAY && burst == 0, "didn't start over from the stall");
+    printf("hitch    next repeat %d us after the stall\n", next ? (int)(next - stalled) : -1);
+}
+
+static void check_release()
+{
+    repeat_t repeat;
+    repeat_reset(&repeat);
+
+    uint64_t late = EPOCH + (10 * REPEAT_INITIAL_DELAY);
+    expect("release", !repeat_update(&repeat, 1, late), "repeated without ever being pressed");
+
+    repeat_press(&repeat, EPOCH);
+    expect("release", !repeat_update(&repeat, 0, EPOCH + STEP_US), "repeated while let go");
+    expect("release", !repeat_update(&repeat, 1, late), "repeated after letting go without a new press");
+
+    repeat_press(&repeat, EPOCH);
+    repeat_reset(&repeat);
+    expect("release", !repeat_update(&repeat, 1, late), "repeated after a reset");
+
+    repeat_press(&repeat, late);
+    expect("release", repeat_update(&repeat, 1, late + REPEAT_INITIAL_DELAY), "didn't repeat after pressing again");
+    printf("release  checked\n");
+}
+
+int main(int argc, char *argv[])
+{
+    check_delay();
+    check_rate();
+    check_ticks();
+    check_hitch();
+    check_release();
+
+    printf("%s\n", failures ? "Autorepeat fired at the wrong time!" : "Autorepeat fired on time.");
+    return failures ? 1 : 0;
+}
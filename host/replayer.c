@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "control.h"
+#include "replay.h"
+
+// Plays back recorded games as fast as possible through the same input
+// handling the game uses, and checks that every one of them ends up exactly
+// how it did when it was recorded. With --repeat, every replay is played
+// that many times over to get a steadier ticks/sec figure.
+
+typedef struct
+{
+    playfield_t *playfield;
+    control_t control;
+    uint32_t seed;
+    host_platform_t host;
+} player_t;
+
+static void player_start(void *user)
+{
+    player_t *player = (player_t *)user;
+    playfield_run(player->playfield, player->seed);
+}
+
+static void player_tick(sim_tick_t *tick, void *user)
+{
+    player_t *player = (player_t *)user;
+    player->host.now = tick->time;
+    control_tick(&player->control, tick);
+}
+
+int main(int argc, char *argv[])
+{
+    static replay_t replay;
+    unsigned int repeat = 1;
+    unsigned int games = 0;
+    unsigned int failed = 0;
+    uint64_t total_ticks = 0;
+    uint64_t total_us = 0;
+    int files = 0;
+
+    player_t player;
+    memset(&player, 0, sizeof(player));
+    host_platform_init(&player.host, 0);
+    player.playfield = host_playfield_new(&player.host);
+    control_init(&player.control, player.playfield, &player_start, &player);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = atoi(argv[++i]);
+            continue;
+        }
+
+        FILE *fp = fopen(argv[i], "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "Can't open %s!\n", argv[i]);
+            return 1;
+        }
+        files++;
+
+        while (replay_read(&replay, fp))
+        {
+            for (unsigned int pass = 0; pass < repeat; pass++)
+            {
+                player.seed = replay.seed;
+                player.host.now = 0;
+
+                uint64_t start = host_wall_us();
+                int ticks = replay_play(&replay, &player_tick, &player);
+                total_us += host_wall_us() - start;
+
+                uint32_t hash = playfield_state_hash(player.playfield);
+                int score = player.playfield->score;
+                if (ticks < 0 || hash != replay.final_hash || score != replay.final_score)
+                {
+                    printf("%s game %u seed %08x: hash %08x score %d, recorded %08x score %d MISMATCH\n",
+                        argv[i], games, replay.seed, hash, score, replay.final_hash, replay.final_score);
+                    failed++;
+                    break;
+                }
+                total_ticks += ticks;
+            }
+            games++;
+        }
+        fclose(fp);
+    }
+
+    if (!files)
+    {
+        fprintf(stderr, "usage: %s [--repeat N] replay...\n", argv[0]);
+        return 1;
+    }
+
+    double seconds = total_us / 1000000.0;
+    printf("%u games, %llu ticks (%.1f s game time) in %.3f s, %.0f ticks/sec\n",
+        games, (unsigned long long)total_ticks, (double)total_ticks / SIM_TICK_RATE, seconds, seconds > 0 ? total_ticks / seconds : 0.0);
+    printf("%s\n", failed ? "Some replays didn't play back the same!" : "All replays played back the same.");
+
+    playfield_free(player.playfield);
+    return failed ? 1 : 0;
+}
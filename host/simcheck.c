@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "input.h"
+#include "repeat.h"
+#include "sim.h"
+
+// Runs the same input log through the fixed timestep driver at a bunch of
+// different display rates and makes sure every one of them produces the
+// exact same sequence of ticks. A cursor driven by the same repeat logic the
+// game uses rides along so that held-button repeats get checked too.
+
+#define EPOCH 1000000
+#define LOG_LENGTH 60000000
+#define EVENT_COUNT 1200
+
+typedef struct
+{
+    const char *name;
+    // Microseconds per displayed frame, or zero for a jittery display.
+    uint32_t frame_us;
+} rate_t;
+
+typedef struct
+{
+    uint64_t limit;
+    uint32_t hash;
+    int x;
+    int y;
+    repeat_t repeats[4];
+} check_t;
+
+static input_event_t events[EVENT_COUNT];
+static unsigned int num_events;
+
+static uint32_t rand_state;
+
+static uint32_t next_rand()
+{
+    rand_state = (rand_state * 1103515245) + 12345;
+    return (rand_state >> 16) & 0x7FFF;
+}
+
+static int event_compare(const void *a, const void *b)
+{
+    const input_event_t *first = (const input_event_t *)a;
+    const input_event_t *second = (const input_event_t *)b;
+
+    if (first->timestamp < second->timestamp)
+    {
+        return -1;
+    }
+    if (first->timestamp > second->timestamp)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+static void generate_events()
+{
+    static const uint32_t buttons[] = { INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT, INPUT_BUTTON1, INPUT_START };
+    int num_buttons = sizeof(buttons) / sizeof(buttons[0]);
+
+    rand_state = 1;
+    num_events = 0;
+    for (int which = 0; which < num_buttons; which++)
+    {
+        // Each button gets its own stream of presses, and the streams overlap
+        // with each other. A mix of quick taps and long holds that kick in
+        // the repeat.
+        uint64_t now = EPOCH;
+        while (num_events + 2 <= EVENT_COUNT)
+        {
+            uint64_t press = now + 1 + (next_rand() * 20);
+            uint64_t hold = (next_rand() % 4) == 0 ? 400000 + (next_rand() * 40) : 20000 + (next_rand() * 4);
+            if (press + hold >= EPOCH + LOG_LENGTH)
+            {
+                break;
+            }
+
+            events[num_events].timestamp = press;
+            events[num_events].button = buttons[which];
+            events[num_events].type = INPUT_EVENT_PRESS;
+            events[num_events + 1].timestamp = press + hold;
+            events[num_events + 1].button = buttons[which];
+            events[num_events + 1].type = INPUT_EVENT_RELEASE;
+            num_events += 2;
+            now = press + hold;
+        }
+    }
+
+    qsort(events, num_events, sizeof(input_event_t), &event_compare);
+}
+
+static void hash_value(check_t *check, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        check->hash ^= (value >> (i * 8)) & 0xFF;
+        check->hash *= 16777619;
+    }
+}
+
+static void check_tick(sim_tick_t *tick, void *user)
+{
+    check_t *check = (check_t *)user;
+    static const uint32_t directions[4] = { INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT };
+
+    if (tick->index >= check->limit)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        int moved = 0;
+        if (tick->pressed & directions[i])
+        {
+            repeat_press(&check->repeats[i], tick->time);
+            moved = 1;
+        }
+        else if (repeat_update(&check->repeats[i], tick->held & directions[i], tick->time))
+        {
+            moved = 1;
+        }
+
+        if (moved)
+        {
+            check->y += i == 0 ? -1 : (i == 1 ? 1 : 0);
+            check->x += i == 2 ? -1 : (i == 3 ? 1 : 0);
+        }
+    }
+
+    hash_value(check, tick->index);
+    hash_value(check, tick->time);
+    hash_value(check, tick->pressed);
+    hash_value(check, tick->held);
+    hash_value(check, tick->released);
+    hash_value(check, tick->first_press);
+    hash_value(check, (uint32_t)check->x);
+    hash_value(check, (uint32_t)check->y);
+}
+
+static void run_rate(rate_t *rate, check_t *check, int *frames, int *most_ticks)
+{
+    static sim_t sim;
+    unsigned int delivered = 0;
+    uint64_t now = EPOCH;
+
+    memset(check, 0, sizeof(check_t));
+    check->hash = 2166136261U;
+    check->limit = LOG_LENGTH / (1000000 / SIM_TICK_RATE);
+    for (int i = 0; i < 4; i++)
+    {
+        repeat_reset(&check->repeats[i]);
+    }
+
+    sim_init(&sim, SIM_TICK_RATE, EPOCH);
+    rand_state = 12345;
+    *frames = 0;
+    *most_ticks = 0;
+
+    while (sim.ticks < check->limit)
+    {
+        now += rate->frame_us ? rate->frame_us : 4000 + ((next_rand() * 36000) / 0x8000);
+
+        // Hand over everything the input thread would have seen by now.
+        unsigned int count = 0;
+        while (delivered + count < num_events && events[delivered + count].timestamp <= now)
+        {
+            count++;
+        }
+        sim_queue_events(&sim, &events[delivered], count);
+        delivered += count;
+
+        int ran = sim_advance(&sim, now, &check_tick, check);
+        if (ran > *most_ticks)
+        {
+            *most_ticks = ran;
+        }
+        (*frames)++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    rate_t rates[] = {
+        { "30hz", 33333 },
+        { "50hz", 20000 },
+        { "60hz", 16667 },
+        { "75hz", 13333 },
+        { "144hz", 6944 },
+        { "240hz", 4167 },
+        { "jittery", 0 },
+    };
+    int num_rates = sizeof(rates) / sizeof(rates[0]);
+    int failed = 0;
+    uint32_t expected = 0;
+
+    generate_events();
+    printf("%u events over %d seconds, %d ticks per second\n", num_events, LOG_LENGTH / 1000000, SIM_TICK_RATE);
+
+    for (int i = 0; i < num_rates; i++)
+    {
+        check_t check;
+        int frames;
+        int most_ticks;
+
+        run_rate(&rates[i], &check, &frames, &most_ticks);
+        if (i == 0)
+        {
+            expected = check.hash;
+        }
+
+        int match = check.hash == expected;
+        failed |= !match;
+        printf(
+            "%-8s %6d frames, max %d ticks/frame, cursor %4d,%4d, hash %08x %s\n",
+            rates[i].name,
+            frames,
+            most_ticks,
+            check.x,
+            check.y,
+            check.hash,
+            match ? "ok" : "MISMATCH"
+        );
+    }
+
+    printf("%s\n", failed ? "Display rate changes the simulation!" : "All display rates agree.");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "naomi/video.h"
+#include "rng.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "hint.h"
+#include "draw.h"
+
+// Times the engine's per-frame work on boards from the shipping 9x11 up to
+// 256x256, to show what stays flat as boards grow and what doesn't. Every
+// board starts partly filled with random pipes, and then gets:
+//
+//  solve:   a full solve from scratch, which is what a drop or a clear costs
+//  snake:   the same, on a board that's one pipe winding through every row
+//  tick:    a normal tick of aging, mostly nothing changing
+//  drop:    placing a block somewhere empty, including the solve after it
+//  gravity: the same with gravity on, dropping into the top of a column
+//  draw:    drawing the part of the board that fits on screen
+//  hint:    how many cells the hints score in their share of a frame,
+//           which is every empty one on small boards
+//
+// Times are in microseconds, with the worst single call next to the ticks
+// and drops since those are what has to fit in a frame.
+
+#define BOARD_SEED 1
+#define FILL_PERCENT 60
+#define DEFAULT_TICKS 600
+#define DEFAULT_DROPS 200
+#define DEFAULT_MAX 256
+#define HINT_BUDGET_US 500
+#define FRAME_US 16667
+
+// The screen a view gets fit to, same as the Naomi's below the debug line.
+#define SCREEN_WIDTH 640
+#define SCREEN_HEIGHT 456
+
+typedef struct
+{
+    int width;
+    int height;
+} board_size_t;
+
+static const board_size_t sizes[] = {
+    { PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT },
+    { 16, 16 },
+    { 32, 32 },
+    { 64, 64 },
+    { 128, 128 },
+    { 256, 256 },
+};
+
+typedef struct
+{
+    double mean;
+    double worst;
+} timing_t;
+
+static sprites_t sprites;
+
+// Hints get a time budget, so the engine has to see real time pass.
+static host_platform_t host;
+
+static const unsigned int shapes[6] = {
+    PIPE_CONN_N | PIPE_CONN_S, PIPE_CONN_E | PIPE_CONN_W,
+    PIPE_CONN_N | PIPE_CONN_E, PIPE_CONN_N | PIPE_CONN_W,
+    PIPE_CONN_S | PIPE_CONN_E, PIPE_CONN_S | PIPE_CONN_W,
+};
+
+static playfield_t *new_board(int width, int height, int gravity)
+{
+    playfield_rules_t rules;
+    playfield_default_rules(&rules);
+    rules.gravity = gravity;
+
+    playfield_t *playfield = playfield_new(&host.platform, &rules, 0, width, height);
+    playfield_run(playfield, BOARD_SEED);
+
+    rng_t rng;
+    rng_seed(&rng, BOARD_SEED);
+    for (int cell = 0; cell < width * height; cell++)
+    {
+        if (rng_range(&rng, 100) < FILL_PERCENT)
+        {
+            playfield->entries[cell].block = rng_range(&rng, 4) + BLOCK_TYPE_PURPLE;
+            playfield->entries[cell].pipe = shapes[rng_range(&rng, 6)];
+        }
+    }
+    playfield_rehash(playfield);
+
+    if (gravity)
+    {
+        playfield_apply_gravity(playfield);
+    }
+    else
+    {
+        playfield_check_connections(playfield);
+    }
+    return playfield;
+}
+
+static void make_snake(playfield_t *playfield)
+{
+    // One pipe coming in from the west on the first row with a source and
+    // zigzagging down every row after it to leave on the east side.
+    int top = 1;
+    int bottom = top;
+    while (bottom + 2 < playfield->height - 1)
+    {
+        bottom += 2;
+    }
+
+    memset(playfield->entries, 0, sizeof(playfield_entry_t) * playfield->width * playfield->height);
+    for (int y = top; y <= bottom; y++)
+    {
+        int east = ((y - top) % 2) == 0;
+        for (int x = 0; x < playfield->width; x++)
+        {
+            int first = east ? x == 0 : x == playfield->width - 1;
+            int last = east ? x == playfield->width - 1 : x == 0;
+            unsigned int in = first ? (y == top ? PIPE_CONN_W : PIPE_CONN_N) : (east ? PIPE_CONN_W : PIPE_CONN_E);
+            unsigned int out = last ? (y == bottom ? PIPE_CONN_E : PIPE_CONN_S) : (east ? PIPE_CONN_E : PIPE_CONN_W);
+            playfield_entry(playfield, x, y)->block = BLOCK_TYPE_PURPLE;
+            playfield_entry(playfield, x, y)->pipe = in | out;
+        }
+    }
+    playfield_rehash(playfield);
+}
+
+static double time_solve(playfield_t *playfield, int repeats)
+{
+    playfield->uncached = 1;
+    uint64_t start = host_wall_ns();
+    for (int i = 0; i < repeats; i++)
+    {
+        playfield_check_connections(playfield);
+    }
+    uint64_t elapsed = host_wall_ns() - start;
+    playfield->uncached = 0;
+
+    return (double)elapsed / (repeats * 1000.0);
+}
+
+static timing_t time_ticks(playfield_t *playfield, int ticks)
+{
+    timing_t timing = { 0.0, 0.0 };
+    for (int i = 0; i < ticks; i++)
+    {
+        uint64_t start = host_wall_ns();
+        playfield_age(playfield);
+        double us = (host_wall_ns() - start) / 1000.0;
+
+        timing.mean += us;
+        if (us > timing.worst)
+        {
+            timing.worst = us;
+        }
+    }
+
+    timing.mean /= ticks;
+    return timing;
+}
+
+static int find_empty(playfield_t *playfield, rng_t *rng, int gravity, int *x, int *y)
+{
+    // Start somewhere random and take the first spot we can drop into.
+    int cells = playfield->width * playfield->height;
+    int start = rng_range(rng, cells);
+    for (int i = 0; i < cells; i++)
+    {
+        int cell = (start + i) % cells;
+        *x = cell % playfield->width;
+        *y = cell / playfield->width;
+        if (gravity)
+        {
+            *y = 0;
+        }
+        if (playfield_entry(playfield, *x, *y)->block == BLOCK_TYPE_NONE)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static timing_t time_drops(playfield_t *playfield, int drops, int gravity)
+{
+    timing_t timing = { 0.0, 0.0 };
+    rng_t rng;
+    rng_seed(&rng, BOARD_SEED);
+
+    int dropped = 0;
+    for (int i = 0; i < drops; i++)
+    {
+        int x;
+        int y;
+        if (!find_empty(playfield, &rng, gravity, &x, &y))
+        {
+            break;
+        }
+        playfield->curx = x;
+        playfield->cury = y;
+
+        uint64_t start = host_wall_ns();
+        playfield_cursor_drop(playfield);
+        double us = (host_wall_ns() - start) / 1000.0;
+
+        timing.mean += us;
+        if (us > timing.worst)
+        {
+            timing.worst = us;
+        }
+        dropped++;
+    }
+
+    if (dropped)
+    {
+        timing.mean /= dropped;
+    }
+    return timing;
+}
+
+static double time_draw(playfield_t *playfield, hint_t *hint, int repeats)
+{
+    view_t view;
+    view_init(&view, playfield, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    uint64_t start = host_wall_ns();
+    for (int i = 0; i < repeats; i++)
+    {
+        view_follow(&view, playfield);
+        playfield_draw(0, 0, playfield, &view, &sprites, hint, 0.5);
+    }
+    return (double)(host_wall_ns() - start) / (repeats * 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    host_platform_init(&host, 1);
+
+    int ticks = DEFAULT_TICKS;
+    int drops = DEFAULT_DROPS;
+    int max = DEFAULT_MAX;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            ticks = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--drops") == 0 && i + 1 < argc)
+        {
+            drops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+        {
+            max = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--ticks N] [--drops N] [--max SIDE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (ticks < 1 || drops < 1)
+    {
+        fprintf(stderr, "need at least one tick and one drop\n");
+        return 1;
+    }
+
+    printf("%-9s %7s %9s %9s %9s %9s %9s %9s %9s %9s %7s\n",
+        "size", "cells", "solve", "snake", "tick", "worst", "drop", "worst", "gravity", "worst", "draw");
+
+    double worst_frame = 0.0;
+    const char *worst_size = "";
+    char names[sizeof(sizes) / sizeof(sizes[0])][16];
+    int hinted[sizeof(sizes) / sizeof(sizes[0])];
+
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int width = sizes[s].width;
+        int height = sizes[s].height;
+        if (width > max || height > max)
+        {
+            hinted[s] = -1;
+            continue;
+        }
+
+        int cells = width * height;
+        snprintf(names[s], sizeof(names[s]), "%dx%d", width, height);
+
+        // Enough repeats that small boards don't just measure the clock.
+        int repeats = 1 + (200000 / cells);
+
+        playfield_t *playfield = new_board(width, height, 0);
+        hint_t hint;
+        hint_init(&hint, playfield);
+        hinted[s] = hint_update(&hint, HINT_BUDGET_US);
+        double draw = time_draw(playfield, &hint, repeats);
+        hint_free(&hint);
+
+        double solve = time_solve(playfield, repeats);
+        timing_t tick = time_ticks(playfield, ticks);
+        timing_t drop = time_drops(playfield, drops, 0);
+
+        make_snake(playfield);
+        double snake = time_solve(playfield, repeats);
+        playfield_free(playfield);
+
+        playfield = new_board(width, height, 1);
+        timing_t gravity = time_drops(playfield, drops, 1);
+        playfield_free(playfield);
+
+        printf("%-9s %7d %9.1f %9.1f %9.2f %9.1f %9.1f %9.1f %9.1f %9.1f %7.1f\n",
+            names[s], cells, solve, snake, tick.mean, tick.worst, drop.mean, drop.worst, gravity.mean, gravity.worst, draw);
+
+        // A frame can have a tick and a drop in it, and the drop's solve is
+        // the bigger of the two.
+        double frame = tick.worst + (drop.worst > gravity.worst ? drop.worst : gravity.worst);
+        if (frame > worst_frame)
+        {
+            worst_frame = frame;
+            worst_size = names[s];
+        }
+    }
+
+    printf("\nhint cells scored in %d us:", HINT_BUDGET_US);
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        if (hinted[s] >= 0)
+        {
+            printf(" %s %d", names[s], hinted[s]);
+        }
+    }
+    printf("\nworst tick plus drop: %.1f us at %s, %.1f%% of a %d us frame\n",
+        worst_frame, worst_size, (worst_frame * 100.0) / FRAME_US, FRAME_US);
+
+    return 0;
+}
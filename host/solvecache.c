@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "rng.h"
+#include "sim.h"
+#include "input.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "control.h"
+#include "replay.h"
+
+// Shows what the solve cache saves. Records a set of games in rotation mode
+// where the controls spend most of their time turning blocks one way and
+// then back again, plays every one of them back with the cache and then
+// without it, checks both end up where the recording did, and reports the
+// cache's hit rate and how much solving time it took off. Replay files
+// given on the command line are played back the same way, with the rules
+// the game ships with.
+
+#define DEFAULT_GAMES 20
+#define DEFAULT_SECONDS 60
+#define DEFAULT_SEED 1
+
+#define TICK_US (1000000 / SIM_TICK_RATE)
+
+typedef struct
+{
+    playfield_t *playfield;
+    control_t control;
+    uint32_t seed;
+    host_platform_t host;
+} player_t;
+
+typedef struct
+{
+    unsigned int games;
+    uint64_t ticks;
+    uint64_t solves;
+    uint64_t hits;
+    uint64_t us;
+    unsigned int failed;
+} totals_t;
+
+static void player_start(void *user)
+{
+    player_t *player = (player_t *)user;
+    playfield_run(player->playfield, player->seed);
+}
+
+static void player_tick(sim_tick_t *tick, void *user)
+{
+    player_t *player = (player_t *)user;
+    player->host.now = tick->time;
+    control_tick(&player->control, tick);
+}
+
+static uint32_t choose_held(rng_t *rng, uint32_t held)
+{
+    // Mostly tap one rotate button and then the other so blocks go back to
+    // how they were, sometimes give one a second turn first, and every so
+    // often move along to another block.
+    if (held)
+    {
+        return 0;
+    }
+
+    switch (rng_range(rng, 16))
+    {
+        case 0:
+            return INPUT_UP;
+        case 1:
+            return INPUT_DOWN;
+        case 2:
+            return INPUT_LEFT;
+        case 3:
+            return INPUT_RIGHT;
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+        case 9:
+            return INPUT_BUTTON1;
+        case 10:
+        case 11:
+        case 12:
+        case 13:
+        case 14:
+        case 15:
+            return INPUT_BUTTON2;
+    }
+    return 0;
+}
+
+static void record_game(player_t *player, replay_t *replay, uint32_t seed, unsigned int seconds)
+{
+    rng_t rng;
+    rng_seed(&rng, seed);
+
+    // Every replay starts with the tick that pressed start.
+    player->seed = seed;
+    player->host.now = 0;
+    playfield_stop(player->playfield);
+    replay_begin(replay, seed, TICK_US);
+
+    sim_tick_t tick;
+    memset(&tick, 0, sizeof(tick));
+    uint32_t held = 0;
+    for (uint64_t index = 0; index < (uint64_t)seconds * SIM_TICK_RATE; index++)
+    {
+        uint32_t next = index == 0 ? INPUT_START : (rng_range(&rng, 3) == 0 ? choose_held(&rng, held) : held);
+        tick.index = index;
+        tick.time = (index + 1) * TICK_US;
+        tick.pressed = next & ~held;
+        tick.released = held & ~next;
+        tick.held = next;
+        held = next;
+
+        player_tick(&tick, player);
+        replay_record(replay, &tick);
+    }
+
+    replay_finish(replay, playfield_state_hash(player->playfield), player->playfield->score);
+}
+
+static void play_back(player_t *player, replay_t *replay, int uncached, totals_t *totals)
+{
+    playfield_t *playfield = player->playfield;
+
+    playfield->uncached = uncached;
+    playfield->solves = 0;
+    playfield->solve_hits = 0;
+    for (int i = 0; i < PLAYFIELD_SOLVE_CACHE; i++)
+    {
+        playfield->cache[i].valid = 0;
+    }
+
+    player->seed = replay->seed;
+    player->host.now = 0;
+    playfield_stop(playfield);
+
+    uint64_t start = host_wall_us();
+    int ticks = replay_play(replay, &player_tick, player);
+    totals->us += host_wall_us() - start;
+
+    if (ticks < 0 || playfield_state_hash(playfield) != replay->final_hash || playfield->score != replay->final_score)
+    {
+        totals->failed++;
+    }
+    totals->games++;
+    totals->ticks += ticks > 0 ? ticks : 0;
+    totals->solves += playfield->solves;
+    totals->hits += playfield->solve_hits;
+}
+
+static void report(const char *name, totals_t *cached, totals_t *uncached)
+{
+    double saved = uncached->us > cached->us ? (double)(uncached->us - cached->us) : 0.0;
+    printf("%-10s %5u %9llu %9llu %7.1f%% %10.3f %10.3f %7.1f%% %8.2f\n",
+        name, cached->games, (unsigned long long)cached->ticks, (unsigned long long)cached->solves,
+        cached->solves ? (100.0 * cached->hits) / cached->solves : 0.0,
+        uncached->us / 1000000.0, cached->us / 1000000.0,
+        uncached->us ? (100.0 * saved) / uncached->us : 0.0,
+        cached->hits ? saved / cached->hits : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int games = DEFAULT_GAMES;
+    unsigned int seconds = DEFAULT_SECONDS;
+    uint32_t seed = DEFAULT_SEED;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            games = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "usage: %s [--games N] [--seconds N] [--seed S] [replay...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static replay_t replay;
+    player_t player;
+    memset(&player, 0, sizeof(player));
+    host_platform_init(&player.host, 0);
+    playfield_rules_t rules;
+    totals_t cached;
+    totals_t uncached;
+    int failed = 0;
+
+    printf("%-10s %5s %9s %9s %8s %10s %10s %8s %8s\n", "replays", "games", "ticks", "solves", "hits", "uncached s", "cached s", "saved", "us/hit");
+
+    // Rotation mode, recorded and played back right here.
+    playfield_default_rules(&rules);
+    rules.placing = 0;
+    rules.placetimer = 0;
+    rules.rotation = 1;
+    player.playfield = playfield_new(&player.host.platform, &rules, 0, PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT);
+    control_init(&player.control, player.playfield, &player_start, &player);
+
+    memset(&cached, 0, sizeof(cached));
+    memset(&uncached, 0, sizeof(uncached));
+    for (unsigned int game = 0; game < games; game++)
+    {
+        record_game(&player, &replay, (seed + game) * 2654435761u, seconds);
+        play_back(&player, &replay, 1, &uncached);
+        play_back(&player, &replay, 0, &cached);
+    }
+    report("rotation", &cached, &uncached);
+    failed |= cached.failed || uncached.failed;
+    playfield_free(player.playfield);
+
+    // Anything recorded by the game or headless, with the shipping rules.
+    player.playfield = host_playfield_new(&player.host);
+    control_init(&player.control, player.playfield, &player_start, &player);
+
+    memset(&cached, 0, sizeof(cached));
+    memset(&uncached, 0, sizeof(uncached));
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-')
+        {
+            i++;
+            continue;
+        }
+
+        FILE *fp = fopen(argv[i], "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "Can't open %s!\n", argv[i]);
+            return 1;
+        }
+
+        while (replay_read(&replay, fp))
+        {
+            play_back(&player, &replay, 1, &uncached);
+            play_back(&player, &replay, 0, &cached);
+        }
+        fclose(fp);
+    }
+    if (cached.games)
+    {
+        report("files", &cached, &uncached);
+        failed |= cached.failed || uncached.failed;
+    }
+    playfield_free(player.playfield);
+
+    printf("%s\n", failed ? "Some replays didn't play back the same!" : "Every replay played back the same with and without the cache.");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,1184 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "rng.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "batch.h"
+#include "tiles.h"
+
+// Throws random boards, random light sources and random edits at every
+// connection solver, playfield_check_connections() included, and at a frozen
+// copy of the original recursive solver, which is the reference, and checks
+// that they agree on every color, every age and every sound after every
+// solve. Boards are fuzzed at the shipping size and at a couple of very
+// large sizes, where the engine takes its paths for huge boards. When colors
+// disagree on a shipping size board it is whittled down to as few blocks and
+// sources as still disagree and printed next to what each solver made of it,
+// using the same pipe characters as the boardbench corpus. Bigger boards
+// are only reported by seed. Runs for --seconds (or --rounds) and exits
+// nonzero if anything disagreed, so it can gate solver changes.
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_SEED 1
+#define FUZZ_EDITS 48
+
+// Only report this many disagreements before giving up.
+#define MAX_REPORTS 5
+
+// A board size to fuzz at, how many boards of it to keep going at once and
+// the tiles to check tiles.h with. At the shipping size the tiles leave
+// partial tiles along two edges.
+typedef struct
+{
+    int width;
+    int height;
+    int tile_size;
+    unsigned int boards;
+} fuzz_size_t;
+
+static const fuzz_size_t sizes[] = {
+    { PLAYFIELD_WIDTH, PLAYFIELD_HEIGHT, 4, 64 },
+    { 64, 64, 32, 8 },
+    { 256, 256, 32, 1 },
+};
+
+#define SIZE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+// The size being fuzzed right now.
+static const fuzz_size_t *fuzzing;
+
+#define FUZZ_CELLS (fuzzing->width * fuzzing->height)
+#define FUZZ_SOURCES ((fuzzing->width * 2) + (fuzzing->height * 2))
+
+// Everything the solvers look at, for whittling down. Only ever done at the
+// shipping size.
+typedef struct
+{
+    unsigned int pipes[PLAYFIELD_WIDTH * PLAYFIELD_HEIGHT];
+    unsigned int sources[(PLAYFIELD_WIDTH * 2) + (PLAYFIELD_HEIGHT * 2)];
+} fuzz_case_t;
+
+// A solver to check against the reference. Every engine holds some number
+// of boards that all share one set of sources, takes boards in from and
+// hands them back out as playfields and solves all of them at once.
+typedef struct
+{
+    const char *name;
+    void *(*create)(unsigned int boards);
+    void (*destroy)(void *engine);
+    void (*sources)(void *engine, const unsigned int *sources);
+    void (*load)(void *engine, unsigned int board, playfield_t *playfield);
+    void (*solve)(void *engine);
+    void (*store)(void *engine, unsigned int board, playfield_t *playfield);
+    unsigned int (*sounds)(void *engine, unsigned int board, int sound);
+    // Only handles boards of the shipping size.
+    int fixed_size;
+} engine_t;
+
+// The recursive solver playfield_check_connections() used before it learned
+// to handle big boards, kept exactly as it was so that nothing done to the
+// engine's own solver can also change what it gets checked against. The
+// only change is that the visited cells are stamped instead of cleared for
+// every block, which on the big boards took longer than everything else put
+// together. It recurses once per cell along a chain, which is fine here
+// because chains on random boards only run a handful of cells.
+static int reference_touches_light(playfield_t *playfield, int x, int y, int in_direction, int color)
+{
+    // First, if this doesn't have a connection in the in direction, its always false.
+    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+    if ((cur->pipe & in_direction) == 0)
+    {
+        return 0;
+    }
+
+    // Calculate the other direction of the pipe by removing the in direction.
+    unsigned int out_direction = cur->pipe & (~in_direction);
+    switch(out_direction)
+    {
+        case PIPE_CONN_N:
+        {
+            // Goes out north. Either it hits a light block or it goes to another block.
+            if (y == 0)
+            {
+                source_entry_t *source = playfield->sources + (2 * playfield->height) + playfield->width + x;
+                return (source->color & color) == (unsigned int)color;
+            }
+            else
+            {
+                return reference_touches_light(playfield, x, y - 1, PIPE_CONN_S, color);
+            }
+        }
+        case PIPE_CONN_S:
+        {
+            // Goes out south. Either it hits a light block or it goes to another block.
+            if (y == playfield->height - 1)
+            {
+                source_entry_t *source = playfield->sources + (2 * playfield->height) + x;
+                return (source->color & color) == (unsigned int)color;
+            }
+            else
+            {
+                return reference_touches_light(playfield, x, y + 1, PIPE_CONN_N, color);
+            }
+        }
+        case PIPE_CONN_E:
+        {
+            // Goes out east. Either it hits a light block or it goes to another block.
+            if (x == playfield->width - 1)
+            {
+                source_entry_t *source = playfield->sources + playfield->height + y;
+                return (source->color & color) == (unsigned int)color;
+            }
+            else
+            {
+                return reference_touches_light(playfield, x + 1, y, PIPE_CONN_W, color);
+            }
+        }
+        case PIPE_CONN_W:
+        {
+            // Goes out west. Either it hits a light block or it goes to another block.
+            if (x == 0)
+            {
+                source_entry_t *source = playfield->sources + y;
+                return (source->color & color) == (unsigned int)color;
+            }
+            else
+            {
+                return reference_touches_light(playfield, x - 1, y, PIPE_CONN_E, color);
+            }
+        }
+    }
+
+    // If we get here, who knows why, but we don't have a connection.
+    return 0;
+}
+
+static void reference_fill_light(playfield_t *playfield, int x, int y, int in_direction, int color)
+{
+    // First, if this doesn't have a connection in the in direction, don't fill it.
+    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+    if ((cur->pipe & in_direction) == 0)
+    {
+        return;
+    }
+
+    // Calculate the other direction of the pipe by removing the in direction.
+    unsigned int out_direction = cur->pipe & (~in_direction);
+    cur->color = color;
+    switch(out_direction)
+    {
+        case PIPE_CONN_N:
+        {
+            // Goes out north. Either it hits a light block or it goes to another block.
+            if (y > 0)
+            {
+                return reference_fill_light(playfield, x, y - 1, PIPE_CONN_S, color);
+            }
+            break;
+        }
+        case PIPE_CONN_S:
+        {
+            // Goes out south. Either it hits a light block or it goes to another block.
+            if (y < playfield->height - 1)
+            {
+                return reference_fill_light(playfield, x, y + 1, PIPE_CONN_N, color);
+            }
+            break;
+        }
+        case PIPE_CONN_E:
+        {
+            // Goes out east. Either it hits a light block or it goes to another block.
+            if (x < playfield->width - 1)
+            {
+                return reference_fill_light(playfield, x + 1, y, PIPE_CONN_W, color);
+            }
+            break;
+        }
+        case PIPE_CONN_W:
+        {
+            // Goes out west. Either it hits a light block or it goes to another block.
+            if (x > 0)
+            {
+                return reference_fill_light(playfield, x - 1, y, PIPE_CONN_E, color);
+            }
+            break;
+        }
+    }
+}
+
+static int reference_possible_color(playfield_t *playfield, int x, int y, unsigned int *visited, unsigned int stamp, int in_direction)
+{
+    // First, if this doesn't have a connection in the in direction, its always no color.
+    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+    if (visited[x + (y * playfield->width)] == stamp)
+    {
+        // We already visited this, there's a loop or we point inward at ourselves
+        // in a way that's impossible to recover from.
+        return SOURCE_COLOR_IMPOSSIBLE;
+    }
+    if (cur->block == BLOCK_TYPE_NONE)
+    {
+        // No block here, so its possible to place another block change this pipe
+        // to any color.
+        return SOURCE_COLOR_NONE;
+    }
+    if (in_direction != 0)
+    {
+        if ((cur->pipe & in_direction) == 0)
+        {
+            // Block here, but it doesn't connect, so it could possibly be cleared.
+            // We should pretend that this is a no-color.
+            return SOURCE_COLOR_NONE;
+        }
+    }
+
+    // Mark that we visited this block.
+    visited[x + (y * playfield->width)] = stamp;
+
+    // Calculate the other directions of the pipe by removing the in direction.
+    unsigned int out_directions = cur->pipe & (~in_direction);
+    unsigned int source_color = SOURCE_COLOR_NONE;
+    for (int i = 0; i < 4; i++)
+    {
+        // Calculate what direction we need to examine.
+        unsigned int out_direction = out_directions & (1 << i);
+        if (out_direction == 0)
+        {
+            continue;
+        }
+
+        // Calculate the color in that direction.
+        unsigned int direction_color = SOURCE_COLOR_IMPOSSIBLE;
+        switch(out_direction)
+        {
+            case PIPE_CONN_N:
+            {
+                // Goes out north. Either it hits a light block or it goes to another block.
+                if (y == 0)
+                {
+                    source_entry_t *source = playfield->sources + (2 * playfield->height) + playfield->width + x;
+                    direction_color = source->color ? source->color : SOURCE_COLOR_IMPOSSIBLE;
+                }
+                else
+                {
+                    direction_color = reference_possible_color(playfield, x, y - 1, visited, stamp, PIPE_CONN_S);
+                }
+                break;
+            }
+            case PIPE_CONN_S:
+            {
+                // Goes out south. Either it hits a light block or it goes to another block.
+                if (y == playfield->height - 1)
+                {
+                    source_entry_t *source = playfield->sources + (2 * playfield->height) + x;
+                    direction_color = source->color ? source->color : SOURCE_COLOR_IMPOSSIBLE;
+                }
+                else
+                {
+                    direction_color = reference_possible_color(playfield, x, y + 1, visited, stamp, PIPE_CONN_N);
+                }
+                break;
+            }
+            case PIPE_CONN_E:
+            {
+                // Goes out east. Either it hits a light block or it goes to another block.
+                if (x == playfield->width - 1)
+                {
+                    source_entry_t *source = playfield->sources + playfield->height + y;
+                    direction_color = source->color ? source->color : SOURCE_COLOR_IMPOSSIBLE;
+                }
+                else
+                {
+                    direction_color = reference_possible_color(playfield, x + 1, y, visited, stamp, PIPE_CONN_W);
+                }
+                break;
+            }
+            case PIPE_CONN_W:
+            {
+                // Goes out west. Either it hits a light block or it goes to another block.
+                if (x == 0)
+                {
+                    source_entry_t *source = playfield->sources + y;
+                    direction_color = source->color ? source->color : SOURCE_COLOR_IMPOSSIBLE;
+                }
+                else
+                {
+                    direction_color = reference_possible_color(playfield, x - 1, y, visited, stamp, PIPE_CONN_E);
+                }
+                break;
+            }
+        }
+
+        if (direction_color == SOURCE_COLOR_IMPOSSIBLE)
+        {
+            // We got our answer.
+            return SOURCE_COLOR_IMPOSSIBLE;
+        }
+
+        if (source_color == SOURCE_COLOR_NONE && direction_color != SOURCE_COLOR_NONE)
+        {
+            source_color = direction_color;
+        }
+        else if (source_color != SOURCE_COLOR_NONE && direction_color == SOURCE_COLOR_NONE)
+        {
+            // This is fine, leave source color alone.
+        }
+        else if (source_color == direction_color)
+        {
+            // This is fine, leave source color alone.
+        }
+        else
+        {
+            if ((source_color & direction_color) == source_color)
+            {
+                // This is okay, the direction color contains more bands than ourselves,
+                // or its identical to the source color, so the color remains the same.
+            }
+            else if ((source_color & direction_color) == direction_color)
+            {
+                // This is okay, the source color contains more bands than the direction
+                // color or it is identical to the source color, so we update to the
+                // direction color.
+                source_color = direction_color;
+            }
+            else
+            {
+                // This is not okay! Wrong color bands touching.
+                return SOURCE_COLOR_IMPOSSIBLE;
+            }
+        }
+    }
+
+    return source_color;
+}
+
+static void reference_mark_impossible(playfield_t *playfield, int x, int y, int in_direction)
+{
+    // First, if this doesn't have a connection in the in direction, don't destroy it.
+    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+    if (cur->color == SOURCE_COLOR_IMPOSSIBLE)
+    {
+        return;
+    }
+    if (cur->block == BLOCK_TYPE_NONE)
+    {
+        // No block here, so do nothing.
+        return;
+    }
+    if (in_direction != 0)
+    {
+        if ((cur->pipe & in_direction) == 0)
+        {
+            return;
+        }
+    }
+
+    // Calculate the other directions of the pipe by removing the in direction.
+    unsigned int out_directions = cur->pipe & (~in_direction);
+    cur->color = SOURCE_COLOR_IMPOSSIBLE;
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned int out_direction = out_directions & (1 << i);
+        switch(out_direction)
+        {
+            case PIPE_CONN_N:
+            {
+                // Goes out north. Either it hits a light block or it goes to another block.
+                if (y > 0)
+                {
+                    reference_mark_impossible(playfield, x, y - 1, PIPE_CONN_S);
+                }
+                break;
+            }
+            case PIPE_CONN_S:
+            {
+                // Goes out south. Either it hits a light block or it goes to another block.
+                if (y < playfield->height - 1)
+                {
+                    reference_mark_impossible(playfield, x, y + 1, PIPE_CONN_N);
+                }
+                break;
+            }
+            case PIPE_CONN_E:
+            {
+                // Goes out east. Either it hits a light block or it goes to another block.
+                if (x < playfield->width - 1)
+                {
+                    reference_mark_impossible(playfield, x + 1, y, PIPE_CONN_W);
+                }
+                break;
+            }
+            case PIPE_CONN_W:
+            {
+                // Goes out west. Either it hits a light block or it goes to another block.
+                if (x > 0)
+                {
+                    reference_mark_impossible(playfield, x - 1, y, PIPE_CONN_E);
+                }
+                break;
+            }
+        }
+    }
+}
+
+static void reference_solve(playfield_t *playfield)
+{
+    for (int y = 0; y < playfield->height; y++)
+    {
+        for (int x = 0; x < playfield->width; x++)
+        {
+            // Turn off all connections and then recalculate.
+            playfield_entry(playfield, x, y)->color = SOURCE_COLOR_NONE;
+        }
+    }
+
+    // Now, go through each light source and see if it connects to another of its color.
+    for (int lsy = 0; lsy < playfield->height; lsy++)
+    {
+        source_entry_t *source = playfield->sources + lsy;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (reference_touches_light(playfield, 0, lsy, PIPE_CONN_W, source->color))
+            {
+                reference_fill_light(playfield, 0, lsy, PIPE_CONN_W, source->color);
+            }
+        }
+
+        source = playfield->sources + lsy + playfield->height;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (reference_touches_light(playfield, playfield->width - 1, lsy, PIPE_CONN_E, source->color))
+            {
+                reference_fill_light(playfield, playfield->width - 1, lsy, PIPE_CONN_E, source->color);
+            }
+        }
+    }
+
+    for (int lsx = 0; lsx < playfield->width; lsx++)
+    {
+        source_entry_t *source = playfield->sources + (2 * playfield->height) + lsx;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (reference_touches_light(playfield, lsx, playfield->height - 1, PIPE_CONN_S, source->color))
+            {
+                reference_fill_light(playfield, lsx, playfield->height - 1, PIPE_CONN_S, source->color);
+            }
+        }
+
+        source = playfield->sources + (2 * playfield->height) + playfield->width + lsx;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (reference_touches_light(playfield, lsx, 0, PIPE_CONN_N, source->color))
+            {
+                reference_fill_light(playfield, lsx, 0, PIPE_CONN_N, source->color);
+            }
+        }
+    }
+
+    // Now, find and mark impossible chunks of pipes.
+    if (playfield->rules.placing)
+    {
+        unsigned int *visited = calloc(playfield->width * playfield->height, sizeof(unsigned int));
+        unsigned int stamp = 0;
+        for (int y = 0; y < playfield->height; y++)
+        {
+            for (int x = 0; x < playfield->width; x++)
+            {
+                playfield_entry_t *cur = playfield_entry(playfield, x, y);
+                if (cur->block != BLOCK_TYPE_NONE && cur->color == SOURCE_COLOR_NONE)
+                {
+                    if (reference_possible_color(playfield, x, y, visited, ++stamp, 0) == SOURCE_COLOR_IMPOSSIBLE)
+                    {
+                        reference_mark_impossible(playfield, x, y, 0);
+                    }
+                }
+            }
+        }
+        free(visited);
+    }
+}
+
+
+static void reference_check_connections(playfield_t *playfield, unsigned int *sounds)
+{
+    // Same as playfield_check_connections() always did around the solve,
+    // without any of the caching.
+    int cells = playfield->width * playfield->height;
+    uint8_t *oldcolors = malloc(cells);
+    for (int i = 0; i < cells; i++)
+    {
+        oldcolors[i] = playfield->entries[i].color;
+    }
+
+    reference_solve(playfield);
+
+    int activated = 0;
+    int wrong = 0;
+    for (int i = 0; i < cells; i++)
+    {
+        playfield_entry_t *cur = playfield->entries + i;
+        if (cur->color != oldcolors[i])
+        {
+            if (cur->color == SOURCE_COLOR_IMPOSSIBLE)
+            {
+                wrong = 1;
+            }
+            else if (cur->color != SOURCE_COLOR_NONE)
+            {
+                activated = 1;
+            }
+            cur->age = 0;
+        }
+    }
+
+    sounds[PLAYFIELD_SOUND_ACTIVATE] += activated;
+    sounds[PLAYFIELD_SOUND_BAD] += wrong;
+    free(oldcolors);
+}
+
+static playfield_t *fuzz_playfield_new(host_platform_t *host)
+{
+    playfield_rules_t rules;
+    playfield_default_rules(&rules);
+    return playfield_new(&host->platform, &rules, 0, fuzzing->width, fuzzing->height);
+}
+
+static void *batch_engine_create(unsigned int boards)
+{
+    return batch_new(boards);
+}
+
+static void batch_engine_destroy(void *engine)
+{
+    batch_free((batch_t *)engine);
+}
+
+static void batch_engine_sources(void *engine, const unsigned int *sources)
+{
+    batch_t *batch = (batch_t *)engine;
+    for (int i = 0; i < BATCH_SOURCES; i++)
+    {
+        batch->sources[i] = sources[i];
+    }
+}
+
+static void batch_engine_load(void *engine, unsigned int board, playfield_t *playfield)
+{
+    batch_import((batch_t *)engine, board, playfield);
+}
+
+static void batch_engine_solve(void *engine)
+{
+    batch_solve((batch_t *)engine);
+}
+
+static void batch_engine_store(void *engine, unsigned int board, playfield_t *playfield)
+{
+    batch_export((batch_t *)engine, board, playfield);
+}
+
+static unsigned int batch_engine_sounds(void *engine, unsigned int board, int sound)
+{
+    batch_t *batch = (batch_t *)engine;
+    return batch->sounds[(sound * batch->count) + board];
+}
+
+// The engine's own solver, playfield_check_connections(). Either handed
+// whole boards, so it solves them from scratch unless it remembers them, or
+// only handed what changed between solves the way a game would, so it works
+// out colors for just the chains those changes touched. Or with tiles,
+// solving every board from scratch a tile at a time.
+typedef struct
+{
+    unsigned int count;
+    host_platform_t *hosts;
+    playfield_t **playfields;
+    tiles_t *tiles;
+} incremental_t;
+
+static void *incremental_engine_create(unsigned int boards)
+{
+    incremental_t *incremental = malloc(sizeof(incremental_t));
+    incremental->count = boards;
+    incremental->hosts = malloc(sizeof(host_platform_t) * boards);
+    incremental->playfields = malloc(sizeof(playfield_t *) * boards);
+    incremental->tiles = 0;
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        host_platform_init(&incremental->hosts[board], 0);
+        incremental->playfields[board] = fuzz_playfield_new(&incremental->hosts[board]);
+    }
+    return incremental;
+}
+
+static void incremental_engine_destroy(void *engine)
+{
+    incremental_t *incremental = (incremental_t *)engine;
+    for (unsigned int board = 0; board < incremental->count; board++)
+    {
+        playfield_free(incremental->playfields[board]);
+    }
+    if (incremental->tiles)
+    {
+        tiles_free(incremental->tiles);
+    }
+    free(incremental->hosts);
+    free(incremental->playfields);
+    free(incremental);
+}
+
+static void *tiles_engine_create(unsigned int boards)
+{
+    incremental_t *incremental = incremental_engine_create(boards);
+    incremental->tiles = tiles_new(fuzzing->width, fuzzing->height, fuzzing->tile_size);
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        incremental->playfields[board]->uncached = 1;
+        incremental->playfields[board]->solver = &tiles_solver;
+        incremental->playfields[board]->solver_user = incremental->tiles;
+    }
+    return incremental;
+}
+
+static void incremental_engine_sources(void *engine, const unsigned int *sources)
+{
+    incremental_t *incremental = (incremental_t *)engine;
+    for (unsigned int board = 0; board < incremental->count; board++)
+    {
+        playfield_t *playfield = incremental->playfields[board];
+        for (int i = 0; i < FUZZ_SOURCES; i++)
+        {
+            playfield->sources[i].color = sources[i];
+        }
+        playfield_rehash(playfield);
+    }
+}
+
+static void playfield_engine_load(void *engine, unsigned int board, playfield_t *playfield)
+{
+    playfield_t *mine = ((incremental_t *)engine)->playfields[board];
+    memcpy(mine->entries, playfield->entries, sizeof(playfield_entry_t) * FUZZ_CELLS);
+    playfield_rehash(mine);
+}
+
+static void incremental_engine_load(void *engine, unsigned int board, playfield_t *playfield)
+{
+    // Only write what's different, same as the game would have.
+    playfield_t *mine = ((incremental_t *)engine)->playfields[board];
+    for (int y = 0; y < fuzzing->height; y++)
+    {
+        for (int x = 0; x < fuzzing->width; x++)
+        {
+            playfield_entry_t *entry = playfield_entry(playfield, x, y);
+            if (memcmp(playfield_entry(mine, x, y), entry, sizeof(playfield_entry_t)) != 0)
+            {
+                playfield_put_entry(mine, x, y, entry);
+            }
+        }
+    }
+}
+
+static void incremental_engine_solve(void *engine)
+{
+    incremental_t *incremental = (incremental_t *)engine;
+    for (unsigned int board = 0; board < incremental->count; board++)
+    {
+        playfield_check_connections(incremental->playfields[board]);
+    }
+}
+
+static void incremental_engine_store(void *engine, unsigned int board, playfield_t *playfield)
+{
+    playfield_t *mine = ((incremental_t *)engine)->playfields[board];
+    memcpy(playfield->entries, mine->entries, sizeof(playfield_entry_t) * FUZZ_CELLS);
+}
+
+static unsigned int incremental_engine_sounds(void *engine, unsigned int board, int sound)
+{
+    return ((incremental_t *)engine)->hosts[board].sounds[sound];
+}
+
+static const engine_t engines[] = {
+    {
+        "batch",
+        &batch_engine_create, &batch_engine_destroy, &batch_engine_sources, &batch_engine_load,
+        &batch_engine_solve, &batch_engine_store, &batch_engine_sounds, 1,
+    },
+    {
+        "playfield",
+        &incremental_engine_create, &incremental_engine_destroy, &incremental_engine_sources, &playfield_engine_load,
+        &incremental_engine_solve, &incremental_engine_store, &incremental_engine_sounds, 0,
+    },
+    {
+        "incremental",
+        &incremental_engine_create, &incremental_engine_destroy, &incremental_engine_sources, &incremental_engine_load,
+        &incremental_engine_solve, &incremental_engine_store, &incremental_engine_sounds, 0,
+    },
+    {
+        "tiles",
+        &tiles_engine_create, &incremental_engine_destroy, &incremental_engine_sources, &incremental_engine_load,
+        &incremental_engine_solve, &incremental_engine_store, &incremental_engine_sounds, 0,
+    },
+};
+
+#define ENGINE_COUNT (sizeof(engines) / sizeof(engines[0]))
+
+static const unsigned int shapes[6] = {
+    PIPE_CONN_N | PIPE_CONN_S, PIPE_CONN_E | PIPE_CONN_W,
+    PIPE_CONN_N | PIPE_CONN_E, PIPE_CONN_N | PIPE_CONN_W,
+    PIPE_CONN_S | PIPE_CONN_E, PIPE_CONN_S | PIPE_CONN_W,
+};
+
+static void random_sources(rng_t *rng, unsigned int *sources)
+{
+    // About half the edge dark, and the rest any mix of colors, which is a
+    // lot nastier than the layout the game actually uses.
+    for (int i = 0; i < FUZZ_SOURCES; i++)
+    {
+        sources[i] = rng_range(rng, 2) ? rng_range(rng, 7) + 1 : SOURCE_COLOR_NONE;
+    }
+}
+
+static void set_sources(playfield_t *playfield, const unsigned int *sources)
+{
+    for (int i = 0; i < FUZZ_SOURCES; i++)
+    {
+        playfield->sources[i].color = sources[i];
+    }
+    playfield_rehash(playfield);
+}
+
+static void set_pipe(playfield_entry_t *entry, rng_t *rng, unsigned int pipe)
+{
+    entry->block = pipe ? rng_range(rng, 4) + BLOCK_TYPE_PURPLE : BLOCK_TYPE_NONE;
+    entry->pipe = pipe;
+}
+
+static void random_board(rng_t *rng, playfield_t *playfield)
+{
+    unsigned int percent = rng_range(rng, 101);
+    for (int cell = 0; cell < FUZZ_CELLS; cell++)
+    {
+        playfield_entry_t *entry = playfield->entries + cell;
+        memset(entry, 0, sizeof(playfield_entry_t));
+        if (rng_range(rng, 100) < percent)
+        {
+            set_pipe(entry, rng, shapes[rng_range(rng, 6)]);
+        }
+    }
+    playfield_rehash(playfield);
+}
+
+static void random_edit(rng_t *rng, playfield_t *playfield)
+{
+    // The kinds of things that happen to a board during a game, plus a few
+    // that can't but might still trip a solver up.
+    playfield_entry_t *entry = playfield->entries + rng_range(rng, FUZZ_CELLS);
+    switch (rng_range(rng, 4))
+    {
+        case 0:
+        {
+            // Drop a block, or replace one.
+            set_pipe(entry, rng, shapes[rng_range(rng, 6)]);
+            entry->color = SOURCE_COLOR_NONE;
+            entry->age = 0;
+            break;
+        }
+        case 1:
+        {
+            // Clear it like it aged out.
+            memset(entry, 0, sizeof(playfield_entry_t));
+            break;
+        }
+        case 2:
+        {
+            // Turn it a quarter.
+            unsigned int pipe = entry->pipe;
+            entry->pipe = ((pipe << 1) | (pipe >> 3)) & 0xF;
+            break;
+        }
+        default:
+        {
+            // Swap it with a neighbor, which can slide whole beams around.
+            int other = (entry - playfield->entries) + 1;
+            if (other < FUZZ_CELLS)
+            {
+                playfield_entry_t swap = *entry;
+                *entry = playfield->entries[other];
+                playfield->entries[other] = swap;
+            }
+            break;
+        }
+    }
+    playfield_rehash(playfield);
+}
+
+static void get_case(playfield_t *playfield, fuzz_case_t *fuzz_case)
+{
+    for (int cell = 0; cell < FUZZ_CELLS; cell++)
+    {
+        fuzz_case->pipes[cell] = playfield->entries[cell].pipe;
+    }
+    for (int i = 0; i < FUZZ_SOURCES; i++)
+    {
+        fuzz_case->sources[i] = playfield->sources[i].color;
+    }
+}
+
+static void put_case(playfield_t *playfield, fuzz_case_t *fuzz_case)
+{
+    for (int cell = 0; cell < FUZZ_CELLS; cell++)
+    {
+        playfield_entry_t *entry = playfield->entries + cell;
+        memset(entry, 0, sizeof(playfield_entry_t));
+        entry->block = fuzz_case->pipes[cell] ? BLOCK_TYPE_PURPLE : BLOCK_TYPE_NONE;
+        entry->pipe = fuzz_case->pipes[cell];
+    }
+    // Rehashes everything, not just the sources.
+    set_sources(playfield, fuzz_case->sources);
+}
+
+static int colors_differ(playfield_t *expected, playfield_t *actual)
+{
+    for (int cell = 0; cell < FUZZ_CELLS; cell++)
+    {
+        if (expected->entries[cell].color != actual->entries[cell].color)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int case_differs(const engine_t *engine, void *single, fuzz_case_t *fuzz_case, playfield_t *reference, playfield_t *result)
+{
+    // Solve a fresh board from nothing with both. Only colors get compared
+    // here, so nobody needs to hear the reference.
+    unsigned int sounds[PLAYFIELD_SOUND_COUNT] = { 0 };
+    put_case(reference, fuzz_case);
+    engine->sources(single, fuzz_case->sources);
+    engine->load(single, 0, reference);
+    reference_check_connections(reference, sounds);
+    engine->solve(single);
+    engine->store(single, 0, result);
+    return colors_differ(reference, result);
+}
+
+static char pipe_char(unsigned int pipe)
+{
+    switch (pipe)
+    {
+        case PIPE_CONN_N | PIPE_CONN_S:
+            return '|';
+        case PIPE_CONN_E | PIPE_CONN_W:
+            return '-';
+        case PIPE_CONN_N | PIPE_CONN_E:
+            return 'L';
+        case PIPE_CONN_N | PIPE_CONN_W:
+            return 'J';
+        case PIPE_CONN_S | PIPE_CONN_E:
+            return 'r';
+        case PIPE_CONN_S | PIPE_CONN_W:
+            return '7';
+        default:
+            return '.';
+    }
+}
+
+static void print_case(fuzz_case_t *fuzz_case, playfield_t *expected, playfield_t *actual)
+{
+    static const char *sides[4] = { "west", "east", "south", "north" };
+    static const int starts[4] = { 0, PLAYFIELD_HEIGHT, 2 * PLAYFIELD_HEIGHT, (2 * PLAYFIELD_HEIGHT) + PLAYFIELD_WIDTH };
+    static const int lengths[4] = { PLAYFIELD_HEIGHT, PLAYFIELD_HEIGHT, PLAYFIELD_WIDTH, PLAYFIELD_WIDTH };
+
+    // Same characters as the boardbench corpus, then what each solver made of
+    // every cell.
+    printf("    board        reference    engine\n");
+    for (int y = 0; y < PLAYFIELD_HEIGHT; y++)
+    {
+        printf("    ");
+        for (int x = 0; x < PLAYFIELD_WIDTH; x++)
+        {
+            putchar(pipe_char(fuzz_case->pipes[(y * PLAYFIELD_WIDTH) + x]));
+        }
+        printf("    ");
+        for (int x = 0; x < PLAYFIELD_WIDTH; x++)
+        {
+            printf("%x", expected->entries[(y * PLAYFIELD_WIDTH) + x].color);
+        }
+        printf("    ");
+        for (int x = 0; x < PLAYFIELD_WIDTH; x++)
+        {
+            printf("%x", actual->entries[(y * PLAYFIELD_WIDTH) + x].color);
+        }
+        printf("\n");
+    }
+
+    for (int side = 0; side < 4; side++)
+    {
+        printf("    %-5s ", sides[side]);
+        for (int i = 0; i < lengths[side]; i++)
+        {
+            printf("%x", fuzz_case->sources[starts[side] + i]);
+        }
+        printf("\n");
+    }
+}
+
+static void minimize(const engine_t *engine, fuzz_case_t *fuzz_case, playfield_t *reference, playfield_t *result)
+{
+    // Keep taking away blocks and sources for as long as that still leaves
+    // the solvers disagreeing.
+    void *single = engine->create(1);
+    int shrunk = 1;
+
+    while (shrunk)
+    {
+        shrunk = 0;
+        for (int cell = 0; cell < FUZZ_CELLS; cell++)
+        {
+            unsigned int pipe = fuzz_case->pipes[cell];
+            if (pipe == PIPE_CONN_NONE)
+            {
+                continue;
+            }
+
+            fuzz_case->pipes[cell] = PIPE_CONN_NONE;
+            if (case_differs(engine, single, fuzz_case, reference, result))
+            {
+                shrunk = 1;
+            }
+            else
+            {
+                fuzz_case->pipes[cell] = pipe;
+            }
+        }
+        for (int i = 0; i < FUZZ_SOURCES; i++)
+        {
+            unsigned int color = fuzz_case->sources[i];
+            if (color == SOURCE_COLOR_NONE)
+            {
+                continue;
+            }
+
+            fuzz_case->sources[i] = SOURCE_COLOR_NONE;
+            if (case_differs(engine, single, fuzz_case, reference, result))
+            {
+                shrunk = 1;
+            }
+            else
+            {
+                fuzz_case->sources[i] = color;
+            }
+        }
+    }
+
+    // Leave the final disagreement in the playfields for printing.
+    case_differs(engine, single, fuzz_case, reference, result);
+    engine->destroy(single);
+}
+
+static int fuzz_engine(const engine_t *engine, uint32_t seed, uint64_t deadline, unsigned int max_rounds, unsigned int *reports)
+{
+    unsigned int boards = fuzzing->boards;
+    host_platform_t *hosts = malloc(sizeof(host_platform_t) * boards);
+    playfield_t **playfields = malloc(sizeof(playfield_t *) * boards);
+    int *bad = malloc(sizeof(int) * boards);
+    unsigned int *sources = malloc(sizeof(unsigned int) * FUZZ_SOURCES);
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        host_platform_init(&hosts[board], 0);
+        playfields[board] = fuzz_playfield_new(&hosts[board]);
+    }
+
+    host_platform_t quiet;
+    host_platform_init(&quiet, 0);
+    playfield_t *result = fuzz_playfield_new(&quiet);
+    playfield_t *reference = fuzz_playfield_new(&quiet);
+    int shipping = fuzzing->width == PLAYFIELD_WIDTH && fuzzing->height == PLAYFIELD_HEIGHT;
+
+    unsigned int round;
+    unsigned long solves = 0;
+    unsigned int failures = 0;
+    uint64_t start = host_wall_us();
+
+    for (round = 0; (!max_rounds || round < max_rounds) && (max_rounds || host_wall_us() < deadline); round++)
+    {
+        // Every round gets its own seed, so any one of them can be rerun
+        // with --seed and --rounds 1.
+        uint32_t round_seed = seed + round;
+        rng_t rng;
+        rng_seed(&rng, round_seed);
+
+        void *alternative = engine->create(boards);
+        random_sources(&rng, sources);
+        engine->sources(alternative, sources);
+
+        for (unsigned int board = 0; board < boards; board++)
+        {
+            memset(hosts[board].sounds, 0, sizeof(hosts[board].sounds));
+            set_sources(playfields[board], sources);
+            random_board(&rng, playfields[board]);
+            engine->load(alternative, board, playfields[board]);
+        }
+
+        memset(bad, 0, sizeof(int) * boards);
+        for (int edit = 0; edit <= FUZZ_EDITS; edit++)
+        {
+            for (unsigned int board = 0; board < boards; board++)
+            {
+                reference_check_connections(playfields[board], hosts[board].sounds);
+            }
+            engine->solve(alternative);
+            solves += boards;
+
+            for (unsigned int board = 0; board < boards; board++)
+            {
+                if (bad[board])
+                {
+                    continue;
+                }
+
+                engine->store(alternative, board, result);
+                const char *what = 0;
+                if (colors_differ(playfields[board], result))
+                {
+                    what = "colors";
+                }
+                else
+                {
+                    for (int cell = 0; cell < FUZZ_CELLS; cell++)
+                    {
+                        if (playfields[board]->entries[cell].age != result->entries[cell].age)
+                        {
+                            what = "ages";
+                        }
+                    }
+                    for (int sound = 0; sound < PLAYFIELD_SOUND_COUNT; sound++)
+                    {
+                        if (hosts[board].sounds[sound] != engine->sounds(alternative, board, sound))
+                        {
+                            what = "sounds";
+                        }
+                    }
+                }
+
+                if (what)
+                {
+                    bad[board] = 1;
+                    failures++;
+                    if (*reports < MAX_REPORTS)
+                    {
+                        (*reports)++;
+                        printf("%s %dx%d: seed %u board %u edit %d: %s differ\n", engine->name, fuzzing->width, fuzzing->height, round_seed, board, edit, what);
+                        if (what[0] == 'c' && shipping)
+                        {
+                            fuzz_case_t fuzz_case;
+                            get_case(playfields[board], &fuzz_case);
+                            minimize(engine, &fuzz_case, reference, result);
+                            print_case(&fuzz_case, reference, result);
+                        }
+                    }
+                }
+            }
+
+            // Edit every board a little and hand it back, even the ones
+            // that already went wrong so the rest stay in step.
+            for (unsigned int board = 0; board < boards; board++)
+            {
+                random_edit(&rng, playfields[board]);
+                engine->load(alternative, board, playfields[board]);
+            }
+        }
+
+        engine->destroy(alternative);
+    }
+
+    double seconds = (host_wall_us() - start) / 1000000.0;
+    printf("%s %dx%d: %u rounds, %lu board solves in %.1f s, %u disagreements\n", engine->name, fuzzing->width, fuzzing->height, round, solves, seconds, failures);
+
+    for (unsigned int board = 0; board < boards; board++)
+    {
+        playfield_free(playfields[board]);
+    }
+    playfield_free(result);
+    playfield_free(reference);
+    free(hosts);
+    free(playfields);
+    free(bad);
+    free(sources);
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int seconds = DEFAULT_SECONDS;
+    unsigned int rounds = 0;
+    uint32_t seed = DEFAULT_SEED;
+    const char *only = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+        {
+            rounds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+        {
+            only = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--seconds N] [--rounds N] [--seed S] [--engine NAME]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Split the time evenly between every engine being checked at every
+    // size it handles.
+    unsigned int checking = 0;
+    unsigned int engines_checked = 0;
+    for (unsigned int e = 0; e < ENGINE_COUNT; e++)
+    {
+        if (!only || strcmp(only, engines[e].name) == 0)
+        {
+            checking += engines[e].fixed_size ? 1 : SIZE_COUNT;
+            engines_checked++;
+        }
+    }
+    if (!engines_checked)
+    {
+        fprintf(stderr, "No engine called %s!\n", only);
+        return 1;
+    }
+
+    unsigned int failures = 0;
+    unsigned int reports = 0;
+    for (unsigned int e = 0; e < ENGINE_COUNT; e++)
+    {
+        if (only && strcmp(only, engines[e].name) != 0)
+        {
+            continue;
+        }
+
+        for (unsigned int size = 0; size < (engines[e].fixed_size ? 1 : SIZE_COUNT); size++)
+        {
+            fuzzing = &sizes[size];
+            uint64_t deadline = host_wall_us() + (((uint64_t)seconds * 1000000) / checking);
+            failures += fuzz_engine(&engines[e], seed, deadline, rounds, &reports);
+        }
+    }
+
+    printf("%s\n", failures ? "Solvers disagree with the reference!" : "Every solver agreed with the reference.");
+    return failures ? 1 : 0;
+}
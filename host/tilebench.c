@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rng.h"
+#include "playfield.h"
+#include "hostplatform.h"
+#include "tiles.h"
+
+// Times solving a huge board from scratch with the tile solver in tiles.h
+// on 1 thread, then 2, 4 and so on up to the thread count, against the
+// normal solver that traces every source on one thread. Every solve's
+// colors get checked against the normal solver's, and it exits nonzero if
+// any of them are different. Two boards get solved:
+//
+//  random: partly filled with random pipes, so almost every chain is short
+//          and stays inside one tile
+//  snake:  one pipe winding through every row, so one chain crosses every
+//          tile and joining them up is as much work as it gets
+//
+// Total times include everything playfield_check_connections() does around
+// the solve itself, since that's what a game would wait for, and speedups
+// are for the solve alone.
+
+#define DEFAULT_SIZE 1024
+#define DEFAULT_REPEATS 5
+#define DEFAULT_SEED 1
+#define FILL_PERCENT 60
+
+typedef struct
+{
+    tiles_t *tiles;
+    playfield_t *playfield;
+    int coloring;
+
+    // Handed out to threads a tile at a time.
+    unsigned int next;
+    unsigned int threads;
+    pthread_t *handles;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    int quit;
+} pool_t;
+
+// Runs on the wall clock, same as the game would.
+static host_platform_t host;
+
+static const unsigned int shapes[6] = {
+    PIPE_CONN_N | PIPE_CONN_S, PIPE_CONN_E | PIPE_CONN_W,
+    PIPE_CONN_N | PIPE_CONN_E, PIPE_CONN_N | PIPE_CONN_W,
+    PIPE_CONN_S | PIPE_CONN_E, PIPE_CONN_S | PIPE_CONN_W,
+};
+
+static void pool_work(pool_t *pool)
+{
+    while (1)
+    {
+        unsigned int which = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (which >= (unsigned int)pool->tiles->count)
+        {
+            break;
+        }
+
+        if (pool->coloring)
+        {
+            tiles_color(pool->tiles, pool->playfield, which);
+        }
+        else
+        {
+            tiles_gather(pool->tiles, pool->playfield, which);
+        }
+    }
+}
+
+static void *pool_thread(void *param)
+{
+    pool_t *pool = (pool_t *)param;
+
+    while (1)
+    {
+        pthread_barrier_wait(&pool->start);
+        if (pool->quit)
+        {
+            break;
+        }
+        pool_work(pool);
+        pthread_barrier_wait(&pool->done);
+    }
+
+    return 0;
+}
+
+static void pool_run(pool_t *pool, int coloring)
+{
+    pool->coloring = coloring;
+    pool->next = 0;
+    pthread_barrier_wait(&pool->start);
+    pool_work(pool);
+    pthread_barrier_wait(&pool->done);
+}
+
+static void pool_solver(playfield_t *playfield, void *user)
+{
+    pool_t *pool = (pool_t *)user;
+    pool->playfield = playfield;
+    pool_run(pool, 0);
+    tiles_join(pool->tiles, playfield);
+    pool_run(pool, 1);
+}
+
+static pool_t *pool_new(tiles_t *tiles, unsigned int threads)
+{
+    pool_t *pool = malloc(sizeof(pool_t));
+    memset(pool, 0, sizeof(pool_t));
+    pool->tiles = tiles;
+    pool->threads = threads;
+
+    // The calling thread works on tiles too, so start one less.
+    pthread_barrier_init(&pool->start, 0, threads);
+    pthread_barrier_init(&pool->done, 0, threads);
+    pool->handles = malloc(sizeof(pthread_t) * threads);
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        pthread_create(&pool->handles[i], 0, &pool_thread, pool);
+    }
+
+    return pool;
+}
+
+static void pool_free(pool_t *pool)
+{
+    pool->quit = 1;
+    pthread_barrier_wait(&pool->start);
+    for (unsigned int i = 1; i < pool->threads; i++)
+    {
+        pthread_join(pool->handles[i], 0);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->done);
+    free(pool->handles);
+    free(pool);
+}
+
+static void fill_random(playfield_t *playfield, uint32_t seed)
+{
+    rng_t rng;
+    rng_seed(&rng, seed);
+    for (int cell = 0; cell < playfield->width * playfield->height; cell++)
+    {
+        memset(playfield->entries + cell, 0, sizeof(playfield_entry_t));
+        if (rng_range(&rng, 100) < FILL_PERCENT)
+        {
+            playfield->entries[cell].block = rng_range(&rng, 4) + BLOCK_TYPE_PURPLE;
+            playfield->entries[cell].pipe = shapes[rng_range(&rng, 6)];
+        }
+    }
+    playfield_rehash(playfield);
+}
+
+static void fill_snake(playfield_t *playfield, uint32_t seed)
+{
+    // One pipe coming in from the west on the first row with a source and
+    // zigzagging down every row after it to leave on the east side.
+    int top = 1;
+    int bottom = top;
+    while (bottom + 2 < playfield->height - 1)
+    {
+        bottom += 2;
+    }
+
+    memset(playfield->entries, 0, sizeof(playfield_entry_t) * playfield->width * playfield->height);
+    for (int y = top; y <= bottom; y++)
+    {
+        int east = ((y - top) % 2) == 0;
+        for (int x = 0; x < playfield->width; x++)
+        {
+            int first = east ? x == 0 : x == playfield->width - 1;
+            int last = east ? x == playfield->width - 1 : x == 0;
+            unsigned int in = first ? (y == top ? PIPE_CONN_W : PIPE_CONN_N) : (east ? PIPE_CONN_W : PIPE_CONN_E);
+            unsigned int out = last ? (y == bottom ? PIPE_CONN_E : PIPE_CONN_S) : (east ? PIPE_CONN_E : PIPE_CONN_W);
+            playfield_entry(playfield, x, y)->block = BLOCK_TYPE_PURPLE;
+            playfield_entry(playfield, x, y)->pipe = in | out;
+        }
+    }
+    playfield_rehash(playfield);
+}
+
+static void null_solver(playfield_t *playfield, void *user)
+{
+    // Leaves the colors as they were.
+}
+
+static double time_solve(playfield_t *playfield, int repeats)
+{
+    uint64_t best = 0;
+    for (int i = 0; i < repeats; i++)
+    {
+        uint64_t start = host_wall_us();
+        playfield_check_connections(playfield);
+        uint64_t elapsed = host_wall_us() - start;
+        if (i == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best / 1000.0;
+}
+
+static int bench_board(const char *name, void (*fill)(playfield_t *, uint32_t), int size, int tile, unsigned int threads, int repeats, uint32_t seed)
+{
+    playfield_rules_t rules;
+    playfield_default_rules(&rules);
+    playfield_t *playfield = playfield_new(&host.platform, &rules, 0, size, size);
+    playfield_run(playfield, seed);
+    fill(playfield, seed);
+    playfield->uncached = 1;
+
+    int cells = size * size;
+    uint8_t *expected = malloc(cells);
+    double serial = time_solve(playfield, repeats);
+    for (int cell = 0; cell < cells; cell++)
+    {
+        expected[cell] = playfield->entries[cell].color;
+    }
+
+    // What playfield_check_connections() costs around the solve, which no
+    // number of threads makes any faster.
+    playfield->solver = &null_solver;
+    double around = time_solve(playfield, repeats);
+    playfield->solver = 0;
+
+    tiles_t *tiles = tiles_new(size, size, tile);
+    int crossing = 0;
+    printf("%s %dx%d, %d tiles of %dx%d, %.2f ms around every solve\n", name, size, size, tiles->count, tiles->size, tiles->size, around);
+    printf("         total     solve   speedup\n");
+    printf("  serial %8.2f ms %8.2f ms\n", serial, serial - around);
+
+    int failed = 0;
+    for (unsigned int count = 1; ; count = (count * 2 > threads && count < threads) ? threads : count * 2)
+    {
+        pool_t *pool = pool_new(tiles, count);
+        playfield->solver = &pool_solver;
+        playfield->solver_user = pool;
+
+        // Start from no colors, so a solver that misses a cell can't pass
+        // on what the last one left behind.
+        for (int cell = 0; cell < cells; cell++)
+        {
+            playfield->entries[cell].color = SOURCE_COLOR_NONE;
+        }
+        playfield_rehash(playfield);
+        double ms = time_solve(playfield, repeats);
+
+        int wrong = 0;
+        for (int cell = 0; cell < cells; cell++)
+        {
+            wrong += playfield->entries[cell].color != expected[cell];
+        }
+        failed |= wrong != 0;
+
+        if (count == 1)
+        {
+            for (int i = 0; i < tiles->count; i++)
+            {
+                crossing += tiles->tiles[i].crossing_count;
+            }
+        }
+
+        printf("  %2u thr %8.2f ms %8.2f ms %7.2fx  %s\n", count, ms, ms - around, (serial - around) / (ms - around), wrong ? "MISMATCH" : "ok");
+
+        playfield->solver = 0;
+        pool_free(pool);
+        if (count >= threads)
+        {
+            break;
+        }
+    }
+    printf("  %d of the chain pieces crossed a tile edge\n", crossing);
+
+    tiles_free(tiles);
+    free(expected);
+    playfield_free(playfield);
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    host_platform_init(&host, 1);
+
+    int size = DEFAULT_SIZE;
+    int tile = TILES_DEFAULT_SIZE;
+    int repeats = DEFAULT_REPEATS;
+    uint32_t seed = DEFAULT_SEED;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = cores > 0 ? cores : 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc)
+        {
+            tile = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+        {
+            repeats = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], 0, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--size SIDE] [--tile SIDE] [--threads N] [--repeats N] [--seed S]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size < 3 || tile < 1 || threads == 0 || repeats < 1)
+    {
+        fprintf(stderr, "Need a board at least 3 wide, a tile, a thread and a repeat!\n");
+        return 1;
+    }
+
+    int failed = 0;
+    failed |= bench_board("random", &fill_random, size, tile, threads, repeats, seed);
+    failed |= bench_board("snake", &fill_snake, size, tile, threads, repeats, seed);
+
+    printf("%s\n", failed ? "Tiles disagree with the serial solver!" : "Tiles agreed with the serial solver at every thread count.");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <string.h>
+#include <naomi/thread.h>
+#include "input.h"
+#include "clock.h"
+
+static void input_push(input_t *input, uint64_t timestamp, uint32_t button, uint32_t type)
+{
+    uint32_t head = input->head;
+    uint32_t tail = __atomic_load_n(&input->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= INPUT_QUEUE_SIZE)
+    {
+        // Game loop isn't keeping up, better to lose an event than block polling.
+        input->overflows++;
+        return;
+    }
+
+    input_event_t *event = &input->queue[head & (INPUT_QUEUE_SIZE - 1)];
+    event->timestamp = timestamp;
+    event->button = button;
+    event->type = type;
+
+    __atomic_store_n(&input->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void *input_thread_main(void *param)
+{
+    input_t *input = (input_t *)param;
+    uint32_t last = 0;
+
+    while (input->exit == 0)
+    {
+        uint32_t current = input->sample(input->user);
+        uint64_t now = clock_us();
+        uint32_t changed = current ^ last;
+
+        for (int i = 0; i < INPUT_BUTTON_COUNT && changed; i++)
+        {
+            uint32_t button = 1 << i;
+            if (changed & button)
+            {
+                input_push(input, now, button, (current & button) ? INPUT_EVENT_PRESS : INPUT_EVENT_RELEASE);
+                changed &= ~button;
+            }
+        }
+
+        last = current;
+        input->polls++;
+        thread_sleep(input->poll_us);
+    }
+
+    return 0;
+}
+
+void input_init(input_t *input, uint32_t (*sample)(void *user), void *user, uint32_t poll_us)
+{
+    memset(input, 0, sizeof(input_t));
+    input->sample = sample;
+    input->user = user;
+    input->poll_us = poll_us;
+
+    input->thread = thread_create("input", &input_thread_main, input);
+    thread_priority(input->thread, 2);
+    thread_start(input->thread);
+}
+
+void input_free(input_t *input)
+{
+    input->exit = 1;
+    thread_join(input->thread);
+}
+
+int input_next_event(input_t *input, input_event_t *event)
+{
+    uint32_t tail = input->tail;
+    uint32_t head = __atomic_load_n(&input->head, __ATOMIC_ACQUIRE);
+
+    if (tail == head)
+    {
+        return 0;
+    }
+
+    memcpy(event, &input->queue[tail & (INPUT_QUEUE_SIZE - 1)], sizeof(input_event_t));
+    __atomic_store_n(&input->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void input_frame(input_t *input, input_frame_t *frame)
+{
+    frame->pressed = 0;
+    frame->released = 0;
+    frame->first_press = 0;
+    frame->num_events = 0;
+
+    input_event_t event;
+    while (frame->num_events < INPUT_QUEUE_SIZE && input_next_event(input, &event))
+    {
+        memcpy(&frame->events[frame->num_events++], &event, sizeof(input_event_t));
+
+        if (event.type == INPUT_EVENT_PRESS)
+        {
+            // A tap that starts and ends between two frames still counts as a press.
+            input->current |= event.button;
+            frame->pressed |= event.button;
+            if (frame->first_press == 0)
+            {
+                frame->first_press = event.timestamp;
+            }
+        }
+        else
+        {
+            input->current &= ~event.button;
+            frame->released |= event.button;
+        }
+    }
+
+    frame->held = input->current;
+}
@@ -0,0 +1,83 @@
+#ifndef __INPUT_H
+#define __INPUT_H
+
+#include <stdint.h>
+
+// Buttons the game cares about, as bits in an input mask.
+#define INPUT_UP 0x0001
+#define INPUT_DOWN 0x0002
+#define INPUT_LEFT 0x0004
+#define INPUT_RIGHT 0x0008
+#define INPUT_BUTTON1 0x0010
+#define INPUT_BUTTON2 0x0020
+#define INPUT_BUTTON3 0x0040
+#define INPUT_START 0x0080
+#define INPUT_SERVICE 0x0100
+#define INPUT_TEST 0x0200
+#define INPUT_PSW1 0x0400
+#define INPUT_PSW2 0x0800
+
+#define INPUT_BUTTON_COUNT 12
+
+// How often the input thread samples the controls. Every sample is a
+// request on the maple bus, so this is kept to four a frame, which is the
+// slowest rate that still catches every tap in host/inputlatency.
+#define INPUT_POLL_RATE 240
+
+// Must be a power of two.
+#define INPUT_QUEUE_SIZE 256
+
+#define INPUT_EVENT_PRESS 1
+#define INPUT_EVENT_RELEASE 2
+
+typedef struct
+{
+    uint64_t timestamp;
+    uint32_t button;
+    uint32_t type;
+} input_event_t;
+
+// Everything that happened to the controls since the last input_frame().
+typedef struct
+{
+    uint32_t pressed;
+    uint32_t held;
+    uint32_t released;
+    // Time of the earliest press this frame, or zero if there wasn't one.
+    uint64_t first_press;
+    unsigned int num_events;
+    input_event_t events[INPUT_QUEUE_SIZE];
+} input_frame_t;
+
+typedef struct
+{
+    // Returns the mask of buttons currently held down.
+    uint32_t (*sample)(void *user);
+    void *user;
+    uint32_t poll_us;
+
+    // Single producer (the input thread), single consumer (the game loop).
+    input_event_t queue[INPUT_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+
+    uint32_t current;
+    uint32_t overflows;
+    uint32_t polls;
+
+    uint32_t thread;
+    volatile int exit;
+} input_t;
+
+// Starts an input thread sampling the controls poll_us apart. sample is only
+// ever called from the input thread.
+void input_init(input_t *input, uint32_t (*sample)(void *user), void *user, uint32_t poll_us);
+void input_free(input_t *input);
+
+// Pops the oldest pending event, returns 0 if there aren't any.
+int input_next_event(input_t *input, input_event_t *event);
+
+// Drains every pending event, in order, into a per-frame summary.
+void input_frame(input_t *input, input_frame_t *frame);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "latency.h"
+
+void latency_init(latency_t *latency)
+{
+    memset(latency, 0, sizeof(latency_t));
+}
+
+void latency_tag(latency_t *latency, uint64_t input)
+{
+    // If several presses land in the same frame, the oldest one waited longest.
+    if (latency->pending == 0 || input < latency->pending)
+    {
+        latency->pending = input;
+    }
+}
+
+void latency_present(latency_t *latency, uint64_t now)
+{
+    if (latency->pending == 0)
+    {
+        return;
+    }
+
+    latency_sample_t *sample = &latency->samples[latency->count % LATENCY_SAMPLES];
+    sample->input = latency->pending;
+    sample->present = now;
+    latency->count++;
+    latency->pending = 0;
+}
+
+static int latency_compare(const void *a, const void *b)
+{
+    uint32_t first = *((const uint32_t *)a);
+    uint32_t second = *((const uint32_t *)b);
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+void latency_stats(latency_t *latency, latency_stats_t *stats)
+{
+    static uint32_t sorted[LATENCY_SAMPLES];
+    unsigned int count = latency->count < LATENCY_SAMPLES ? latency->count : LATENCY_SAMPLES;
+
+    memset(stats, 0, sizeof(latency_stats_t));
+    stats->count = latency->count;
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        sorted[i] = (uint32_t)(latency->samples[i].present - latency->samples[i].input);
+    }
+    qsort(sorted, count, sizeof(uint32_t), &latency_compare);
+
+    stats->min = sorted[0];
+    stats->median = sorted[count / 2];
+    stats->p99 = sorted[((count * 99) + 99) / 100 - 1];
+    stats->max = sorted[count - 1];
+}
+
+void latency_write_log(latency_t *latency, FILE *fp)
+{
+    unsigned int count = latency->count < LATENCY_SAMPLES ? latency->count : LATENCY_SAMPLES;
+    unsigned int first = latency->count - count;
+
+    fprintf(fp, "input_us,present_us,latency_us\n");
+    for (unsigned int i = first; i < latency->count; i++)
+    {
+        latency_sample_t *sample = &latency->samples[i % LATENCY_SAMPLES];
+        fprintf(
+            fp, "%llu,%llu,%u\n",
+            (unsigned long long)sample->input,
+            (unsigned long long)sample->present,
+            (uint32_t)(sample->present - sample->input)
+        );
+    }
+}
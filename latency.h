@@ -0,0 +1,57 @@
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Tracks how long it takes from a button press to the frame showing what it
+// did to the board being presented. Only the most recent LATENCY_SAMPLES
+// presses are kept.
+#define LATENCY_SAMPLES 256
+
+// Measuring costs a clock read every frame and a board hash on every first
+// press, so it's only on by default in builds with -DLATENCY, which is
+// everything but RELEASE=1.
+#ifdef LATENCY
+#define LATENCY_DEFAULT 1
+#else
+#define LATENCY_DEFAULT 0
+#endif
+
+typedef struct
+{
+    uint64_t input;
+    uint64_t present;
+} latency_sample_t;
+
+typedef struct
+{
+    unsigned int count;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+} latency_stats_t;
+
+typedef struct
+{
+    latency_sample_t samples[LATENCY_SAMPLES];
+    unsigned int count;
+    // Timestamp of the press that mutated the board in the frame being built.
+    uint64_t pending;
+} latency_t;
+
+void latency_init(latency_t *latency);
+
+// Call when the board changed this frame because of a press at input.
+void latency_tag(latency_t *latency, uint64_t input);
+
+// Call right after the frame has been handed to the display.
+void latency_present(latency_t *latency, uint64_t now);
+
+void latency_stats(latency_t *latency, latency_stats_t *stats);
+
+// Writes the kept samples as CSV, oldest first.
+void latency_write_log(latency_t *latency, FILE *fp);
+
+#endif
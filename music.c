@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <naomi/audio.h>
+#include <naomi/thread.h>
+#include <naomi/timer.h>
+#include <xmp.h>
+#include "music.h"
+#include "trace.h"
+
+#define BUFSIZE 8192
+#define SAMPLERATE 44100
+
+// How many stereo samples we render and mix at a time.
+#define CHUNK_SAMPLES 512
+
+// Gains are fixed point, with this meaning full volume.
+#define GAIN_FULL 256
+
+typedef struct
+{
+    music_track_t *track;
+    int started;
+    // Gain ramps from start_gain to end_gain over length samples.
+    unsigned int pos;
+    unsigned int length;
+    int start_gain;
+    int end_gain;
+} music_voice_t;
+
+typedef struct
+{
+    mutex_t lock;
+    uint32_t thread;
+    volatile int exit;
+
+    // Handoff from music_play()/music_stop(), protected by lock.
+    int pending;
+    music_track_t *requested;
+    unsigned int requested_fade;
+    int requested_profile;
+
+    volatile uint32_t latency;
+} music_mixer_t;
+
+static music_mixer_t mixer;
+
+static void *music_load_main(void *param)
+{
+    music_track_t *track = (music_track_t *)param;
+
+    if (xmp_load_module(track->ctx, track->filename) < 0)
+    {
+        track->state = MUSIC_STATE_ERROR;
+    }
+    else
+    {
+        track->state = MUSIC_STATE_LOADED;
+    }
+
+    return 0;
+}
+
+music_track_t *music_preload(char *filename)
+{
+    music_track_t *track = malloc(sizeof(music_track_t));
+    memset(track, 0, sizeof(music_track_t));
+    strncpy(track->filename, filename, sizeof(track->filename) - 1);
+
+    track->state = MUSIC_STATE_LOADING;
+    track->ctx = xmp_create_context();
+    track->thread = thread_create("music_load", &music_load_main, track);
+    thread_start(track->thread);
+    return track;
+}
+
+static void music_destroy(music_track_t *track)
+{
+    if (track->state == MUSIC_STATE_LOADED)
+    {
+        xmp_release_module(track->ctx);
+    }
+    xmp_free_context(track->ctx);
+    free(track);
+}
+
+void music_free(music_track_t *track)
+{
+    if (track == 0)
+    {
+        return;
+    }
+
+    thread_join(track->thread);
+
+    // If the mixer still has a hold of this, it will free it when it lets go.
+    mutex_lock(&mixer.lock);
+    if (track->playing || (mixer.pending && mixer.requested == track))
+    {
+        track->release = 1;
+        track = 0;
+    }
+    mutex_unlock(&mixer.lock);
+
+    if (track)
+    {
+        music_destroy(track);
+    }
+}
+
+static void music_request(music_track_t *track, unsigned int fade_us, int profile)
+{
+    music_track_t *orphan = 0;
+
+    mutex_lock(&mixer.lock);
+    if (mixer.pending)
+    {
+        // The mixer never saw the last request, so it is superseded. If that
+        // track was freed in the meantime, nobody else is going to clean it up.
+        if (mixer.requested && mixer.requested->release && !mixer.requested->playing)
+        {
+            orphan = mixer.requested;
+        }
+        if (mixer.requested_profile >= 0)
+        {
+            profile_end(mixer.requested_profile);
+        }
+    }
+    mixer.pending = 1;
+    mixer.latency = 0;
+    mixer.requested = track;
+    mixer.requested_fade = fade_us;
+    mixer.requested_profile = profile;
+    mutex_unlock(&mixer.lock);
+
+    if (orphan)
+    {
+        music_destroy(orphan);
+    }
+}
+
+void music_play(music_track_t *track, unsigned int fade_us)
+{
+    music_request(track, fade_us, track ? profile_start() : -1);
+}
+
+void music_stop(unsigned int fade_us)
+{
+    music_request(0, fade_us, -1);
+}
+
+uint32_t music_start_latency()
+{
+    return mixer.latency;
+}
+
+static void music_voice_drop(music_voice_t *voice)
+{
+    if (voice->track)
+    {
+        if (voice->started)
+        {
+            xmp_end_player(voice->track->ctx);
+        }
+
+        mutex_lock(&mixer.lock);
+        voice->track->playing = 0;
+        music_track_t *release = voice->track->release ? voice->track : 0;
+        mutex_unlock(&mixer.lock);
+
+        if (release)
+        {
+            music_destroy(release);
+        }
+    }
+
+    memset(voice, 0, sizeof(music_voice_t));
+}
+
+static int music_voice_gain(music_voice_t *voice)
+{
+    if (voice->pos >= voice->length)
+    {
+        return voice->end_gain;
+    }
+
+    return voice->start_gain + (((voice->end_gain - voice->start_gain) * (int)voice->pos) / (int)voice->length);
+}
+
+static int music_voice_render(music_voice_t *voice, int16_t *samples)
+{
+    if (!voice->track)
+    {
+        return 0;
+    }
+
+    if (!voice->started)
+    {
+        // Still waiting on the loader, or it failed.
+        if (voice->track->state == MUSIC_STATE_ERROR)
+        {
+            music_voice_drop(voice);
+            return 0;
+        }
+        if (voice->track->state != MUSIC_STATE_LOADED)
+        {
+            return 0;
+        }
+        if (xmp_start_player(voice->track->ctx, SAMPLERATE, 0) != 0)
+        {
+            music_voice_drop(voice);
+            return 0;
+        }
+        voice->started = 1;
+    }
+
+    if (xmp_play_buffer(voice->track->ctx, samples, CHUNK_SAMPLES * 4, 0) != 0)
+    {
+        // Module finished playing.
+        music_voice_drop(voice);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void *music_mixer_main(void *param)
+{
+    static int16_t incoming[CHUNK_SAMPLES * 2];
+    static int16_t outgoing[CHUNK_SAMPLES * 2];
+    static int16_t mixed[CHUNK_SAMPLES * 2];
+
+    music_voice_t current;
+    music_voice_t fading;
+    memset(&current, 0, sizeof(current));
+    memset(&fading, 0, sizeof(fading));
+    int latency_profile = -1;
+
+    audio_register_ringbuffer(AUDIO_FORMAT_16BIT, SAMPLERATE, BUFSIZE);
+
+    while (mixer.exit == 0)
+    {
+        // Pick up any new track to switch to.
+        mutex_lock(&mixer.lock);
+        if (mixer.pending)
+        {
+            music_track_t *track = mixer.requested;
+            unsigned int length = (unsigned int)(((uint64_t)mixer.requested_fade * SAMPLERATE) / 1000000);
+            if (latency_profile >= 0)
+            {
+                profile_end(latency_profile);
+            }
+            latency_profile = mixer.requested_profile;
+            mixer.pending = 0;
+            if (track && track != current.track)
+            {
+                track->playing = 1;
+            }
+            mutex_unlock(&mixer.lock);
+
+            if (track != current.track)
+            {
+                if (current.track)
+                {
+                    // Whatever was fading out already gets cut for the track we're leaving.
+                    int gain = music_voice_gain(&current);
+                    music_voice_drop(&fading);
+                    fading = current;
+                    fading.pos = 0;
+                    fading.length = length;
+                    fading.start_gain = gain;
+                    fading.end_gain = 0;
+                }
+
+                memset(&current, 0, sizeof(current));
+                current.track = track;
+                current.length = length;
+                current.start_gain = 0;
+                current.end_gain = GAIN_FULL;
+            }
+        }
+        else
+        {
+            mutex_unlock(&mixer.lock);
+        }
+
+        TRACE_BEGIN("music mix");
+        int have_incoming = music_voice_render(&current, incoming);
+        int have_outgoing = music_voice_render(&fading, outgoing);
+
+        if (!have_incoming && !have_outgoing)
+        {
+            TRACE_END("music mix");
+
+            // Nothing to play, check back in a bit.
+            thread_sleep((int)(1000000.0 * ((float)CHUNK_SAMPLES / (float)SAMPLERATE)));
+            continue;
+        }
+
+        for (int i = 0; i < CHUNK_SAMPLES; i++)
+        {
+            int in_gain = have_incoming ? music_voice_gain(&current) : 0;
+            int out_gain = have_outgoing ? music_voice_gain(&fading) : 0;
+
+            for (int channel = 0; channel < 2; channel++)
+            {
+                int sample = 0;
+                if (have_incoming)
+                {
+                    sample += (incoming[(i * 2) + channel] * in_gain) / GAIN_FULL;
+                }
+                if (have_outgoing)
+                {
+                    sample += (outgoing[(i * 2) + channel] * out_gain) / GAIN_FULL;
+                }
+                if (sample > 32767)
+                {
+                    sample = 32767;
+                }
+                if (sample < -32768)
+                {
+                    sample = -32768;
+                }
+                mixed[(i * 2) + channel] = sample;
+            }
+
+            if (have_incoming)
+            {
+                current.pos++;
+            }
+            if (have_outgoing)
+            {
+                fading.pos++;
+            }
+        }
+
+        if (fading.track && fading.pos >= fading.length)
+        {
+            music_voice_drop(&fading);
+        }
+
+        TRACE_END("music mix");
+
+        TRACE_BEGIN("music write");
+        unsigned int numsamples = CHUNK_SAMPLES;
+        uint32_t *samples = (uint32_t *)mixed;
+        while (numsamples > 0 && mixer.exit == 0)
+        {
+            unsigned int actual_written = audio_write_stereo_data(samples, numsamples);
+            if (actual_written < numsamples)
+            {
+                numsamples -= actual_written;
+                samples += actual_written;
+
+                // Sleep for the time it takes to play half our buffer so we can wake up and
+                // fill it again.
+                thread_sleep((int)(1000000.0 * (((float)BUFSIZE / 4.0) / (float)SAMPLERATE)));
+            }
+            else
+            {
+                numsamples = 0;
+            }
+        }
+        TRACE_END("music write");
+
+        if (have_incoming && latency_profile >= 0)
+        {
+            // First audible chunk of the new track is now queued.
+            mixer.latency = profile_end(latency_profile);
+            latency_profile = -1;
+        }
+    }
+
+    music_voice_drop(&current);
+    music_voice_drop(&fading);
+    audio_unregister_ringbuffer();
+    return 0;
+}
+
+void music_init()
+{
+    memset(&mixer, 0, sizeof(mixer));
+    mutex_init(&mixer.lock);
+    mixer.requested_profile = -1;
+
+    mixer.thread = thread_create("audio", &music_mixer_main, 0);
+    thread_priority(mixer.thread, 1);
+    thread_start(mixer.thread);
+}
@@ -0,0 +1,45 @@
+#ifndef __MUSIC_H
+#define __MUSIC_H
+
+#include <stdint.h>
+#include <xmp.h>
+
+#define MUSIC_STATE_LOADING 0
+#define MUSIC_STATE_LOADED 1
+#define MUSIC_STATE_ERROR -1
+
+typedef struct
+{
+    char filename[1024];
+    xmp_context ctx;
+    volatile int state;
+    // Set by the mixer while it has a player running for this track.
+    volatile int playing;
+    // Set when music_free() was called while the mixer was still using it.
+    volatile int release;
+    uint32_t thread;
+} music_track_t;
+
+// Starts the mixer thread, which owns the audio ringbuffer for as long as
+// the game is running. Must be called after audio_init().
+void music_init();
+
+// Kicks off loading of a module on a background thread so that a later
+// music_play() doesn't have to wait for it.
+music_track_t *music_preload(char *filename);
+
+// Crossfade from whatever is playing to the given track over fade_us.
+// If the track hasn't finished loading yet, it starts once it has.
+void music_play(music_track_t *track, unsigned int fade_us);
+
+// Fade out whatever is playing over fade_us.
+void music_stop(unsigned int fade_us);
+
+// Waits for the mixer to let go of a track and frees it.
+void music_free(music_track_t *track);
+
+// Microseconds between the last music_play() and the first samples of that
+// track making it into the ringbuffer, or zero if it hasn't started yet.
+uint32_t music_start_latency();
+
+#endif
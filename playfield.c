@@ -0,0 +1,1713 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "playfield.h"
+#include "sim.h"
+#include "profiler.h"
+#include "trace.h"
+
+void playfield_default_rules(playfield_rules_t *rules)
+{
+    rules->gravity = 0;
+    rules->rotation = 0;
+    rules->dragging = 0;
+    rules->placing = 1;
+    rules->placetimer = 1;
+}
+
+static void playfield_sound(playfield_t *playfield, int sound)
+{
+    playfield->platform->sound(sound, playfield->platform->user);
+}
+
+playfield_entry_t *playfield_entry(playfield_t *playfield, int x, int y)
+{
+    return playfield->entries + (y * playfield->width) + x;
+}
+
+// Zobrist keys are worked out from where and what they're for rather than
+// kept in a table, so they're the same for every playfield of any size and
+// there's nothing to set up. Cells get one key per pipe, sources one per
+// color, and the placing rule one of its own since it changes the solve.
+static uint64_t playfield_zobrist_key(uint32_t which)
+{
+    // splitmix64
+    uint64_t key = ((uint64_t)which + 1) * 0x9E3779B97F4A7C15ull;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+static void playfield_mark_dirty(playfield_t *playfield, int cell)
+{
+    // Entries get hashed out and back in around every change, so the same
+    // cell tends to turn up twice in a row. Past the end we only remember
+    // that there was too much.
+    if (playfield->dirty_count > playfield->dirty_size)
+    {
+        return;
+    }
+    if (playfield->dirty_count > 0 && playfield->dirty[playfield->dirty_count - 1] == cell)
+    {
+        return;
+    }
+    if (playfield->dirty_count < playfield->dirty_size)
+    {
+        playfield->dirty[playfield->dirty_count] = cell;
+    }
+    playfield->dirty_count++;
+}
+
+// Keeps a cell's place in the active list in step with whether it has a
+// color, so call it after anything that might have changed one.
+static void playfield_track(playfield_t *playfield, int cell)
+{
+    int colored = playfield->entries[cell].color != SOURCE_COLOR_NONE;
+    int at = playfield->active_at[cell];
+    if (colored && at < 0)
+    {
+        playfield->active_at[cell] = playfield->active_count;
+        playfield->active[playfield->active_count++] = cell;
+    }
+    else if (!colored && at >= 0)
+    {
+        int last = playfield->active[--playfield->active_count];
+        playfield->active[at] = last;
+        playfield->active_at[last] = at;
+        playfield->active_at[cell] = -1;
+    }
+}
+
+static void playfield_track_all(playfield_t *playfield)
+{
+    playfield->active_count = 0;
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        playfield->active_at[i] = -1;
+    }
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        playfield_track(playfield, i);
+    }
+}
+
+static void playfield_reset_beams(playfield_t *playfield)
+{
+    playfield->beam_count = 0;
+    playfield->beam_used = 0;
+    playfield->beam_dead = 0;
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        playfield->beam_at[i] = -1;
+    }
+}
+
+// Drops a beam that a solve is about to work out again. It stays where it
+// is with nothing in it until the beams get packed back together.
+static void playfield_kill_beam(playfield_t *playfield, int beam)
+{
+    playfield_beam_t *dead = playfield->beams + beam;
+    for (int i = 0; i < dead->length; i++)
+    {
+        int cell = playfield->beam_cells[dead->first + i];
+        if (playfield->beam_at[cell] == beam)
+        {
+            playfield->beam_at[cell] = -1;
+        }
+    }
+    dead->length = 0;
+    playfield->beam_dead++;
+}
+
+static void playfield_pack_beams(playfield_t *playfield)
+{
+    int count = 0;
+    int used = 0;
+    for (int i = 0; i < playfield->beam_count; i++)
+    {
+        playfield_beam_t beam = playfield->beams[i];
+        if (beam.length == 0)
+        {
+            continue;
+        }
+
+        memmove(playfield->beam_cells + used, playfield->beam_cells + beam.first, sizeof(int) * beam.length);
+        for (int j = 0; j < beam.length; j++)
+        {
+            playfield->beam_at[playfield->beam_cells[used + j]] = count;
+        }
+        beam.first = used;
+        playfield->beams[count++] = beam;
+        used += beam.length;
+    }
+
+    playfield->beam_count = count;
+    playfield->beam_used = used;
+    playfield->beam_dead = 0;
+}
+
+int playfield_beam_at(playfield_t *playfield, int x, int y)
+{
+    return playfield->beam_at[x + (y * playfield->width)];
+}
+
+// Toggles an entry in or out of the hash, so call it once before changing
+// an entry and once after. Empty cells aren't in the hash at all.
+static void playfield_hash_entry(playfield_t *playfield, playfield_entry_t *entry)
+{
+    if (entry->block != BLOCK_TYPE_NONE)
+    {
+        uint32_t cell = entry - playfield->entries;
+        playfield->zobrist ^= playfield_zobrist_key((((cell * 16) + (entry->pipe & 0xF)) * 2));
+        playfield_mark_dirty(playfield, cell);
+    }
+}
+
+static void playfield_hash_source(playfield_t *playfield, source_entry_t *source)
+{
+    if (source->color != SOURCE_COLOR_NONE)
+    {
+        int index = source - playfield->sources;
+        playfield->zobrist ^= playfield_zobrist_key((((index * 16) + (source->color & 0xF)) * 2) + 1);
+
+        // Whatever chain runs into this source starts at the cell next to it.
+        int width = playfield->width;
+        int height = playfield->height;
+        if (index < height)
+        {
+            playfield_mark_dirty(playfield, index * width);
+        }
+        else if (index < 2 * height)
+        {
+            playfield_mark_dirty(playfield, ((index - height) * width) + width - 1);
+        }
+        else if (index < (2 * height) + width)
+        {
+            playfield_mark_dirty(playfield, ((height - 1) * width) + (index - (2 * height)));
+        }
+        else
+        {
+            playfield_mark_dirty(playfield, index - (2 * height) - width);
+        }
+    }
+}
+
+static void playfield_swap_entries(playfield_t *playfield, playfield_entry_t *first, playfield_entry_t *second)
+{
+    playfield_entry_t temp;
+
+    playfield_hash_entry(playfield, first);
+    playfield_hash_entry(playfield, second);
+    memcpy(&temp, first, sizeof(playfield_entry_t));
+    memcpy(first, second, sizeof(playfield_entry_t));
+    memcpy(second, &temp, sizeof(playfield_entry_t));
+    playfield_hash_entry(playfield, first);
+    playfield_hash_entry(playfield, second);
+    playfield_track(playfield, first - playfield->entries);
+    playfield_track(playfield, second - playfield->entries);
+}
+
+void playfield_rehash(playfield_t *playfield)
+{
+    playfield->zobrist = 0;
+    playfield->colored_valid = 0;
+    playfield->dirty_count = 0;
+    playfield_track_all(playfield);
+    playfield_reset_beams(playfield);
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        playfield_hash_entry(playfield, playfield->entries + i);
+    }
+    for (int i = 0; i < (playfield->width * 2) + (playfield->height * 2); i++)
+    {
+        playfield_hash_source(playfield, playfield->sources + i);
+    }
+
+    // Colors could have been written too.
+    playfield_track_all(playfield);
+}
+
+void playfield_put_entry(playfield_t *playfield, int x, int y, playfield_entry_t *entry)
+{
+    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+    playfield_hash_entry(playfield, cur);
+    memcpy(cur, entry, sizeof(playfield_entry_t));
+    playfield_hash_entry(playfield, cur);
+    playfield_mark_dirty(playfield, cur - playfield->entries);
+    playfield_track(playfield, cur - playfield->entries);
+}
+
+void playfield_copy(playfield_t *dst, playfield_t *src)
+{
+    playfield_entry_t *entries = dst->entries;
+    source_entry_t *sources = dst->sources;
+    playfield_entry_t *upnext = dst->upnext;
+    solve_cache_t *cache = dst->cache;
+    int *dirty = dst->dirty;
+    int *active = dst->active;
+    int *active_at = dst->active_at;
+    uint32_t *labels = dst->labels;
+    uint32_t label = dst->label;
+    int *members_x = dst->members_x;
+    int *members_y = dst->members_y;
+    int *blocked = dst->blocked;
+    playfield_beam_t *beams = dst->beams;
+    int *beam_cells = dst->beam_cells;
+    int *beam_at = dst->beam_at;
+    unsigned int solves = dst->solves;
+    unsigned int solve_hits = dst->solve_hits;
+    int uncached = dst->uncached;
+    void (*solver)(playfield_t *playfield, void *user) = dst->solver;
+    void *solver_user = dst->solver_user;
+    int cells = src->width * src->height;
+
+    memcpy(dst, src, sizeof(playfield_t));
+    dst->entries = entries;
+    dst->sources = sources;
+    dst->upnext = upnext;
+    dst->cache = cache;
+    dst->dirty = dirty;
+    dst->active = active;
+    dst->active_at = active_at;
+    dst->labels = labels;
+    dst->label = label;
+    dst->members_x = members_x;
+    dst->members_y = members_y;
+    dst->blocked = blocked;
+    dst->beams = beams;
+    dst->beam_cells = beam_cells;
+    dst->beam_at = beam_at;
+    dst->solves = solves;
+    dst->solve_hits = solve_hits;
+    dst->uncached = uncached;
+    dst->solver = solver;
+    dst->solver_user = solver_user;
+    memcpy(dst->entries, src->entries, sizeof(playfield_entry_t) * cells);
+    memcpy(dst->sources, src->sources, sizeof(source_entry_t) * ((src->width * 2) + (src->height * 2)));
+    memcpy(dst->upnext, src->upnext, sizeof(playfield_entry_t) * UPNEXT_AMOUNT);
+    memcpy(dst->dirty, src->dirty, sizeof(int) * (src->dirty_count < src->dirty_size ? src->dirty_count : src->dirty_size));
+    memcpy(dst->active, src->active, sizeof(int) * src->active_count);
+    memcpy(dst->active_at, src->active_at, sizeof(int) * cells);
+    memcpy(dst->beams, src->beams, sizeof(playfield_beam_t) * src->beam_count);
+    memcpy(dst->beam_cells, src->beam_cells, sizeof(int) * src->beam_used);
+    memcpy(dst->beam_at, src->beam_at, sizeof(int) * cells);
+}
+
+int playfield_game_over(playfield_t *playfield)
+{
+    for (int y = 0; y < playfield->height; y++)
+    {
+        for (int x = 0; x < playfield->width; x++)
+        {
+            playfield_entry_t *cur = playfield_entry(playfield, x, y);
+            if (cur->block == BLOCK_TYPE_NONE)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+playfield_t *playfield_new(playfield_platform_t *platform, playfield_rules_t *rules, int vertical, int width, int height)
+{
+    playfield_entry_t *entries = malloc(sizeof(playfield_entry_t) * width * height);
+    memset(entries, 0, sizeof(playfield_entry_t) * width * height);
+
+    source_entry_t *sources = malloc(sizeof(source_entry_t) * ((width * 2) + (height * 2)));
+    memset(sources, 0, sizeof(source_entry_t) * ((width * 2) + (height * 2)));
+
+    playfield_entry_t *upnext = malloc(sizeof(playfield_entry_t) * UPNEXT_AMOUNT);
+    memset(upnext, 0, sizeof(playfield_entry_t) * UPNEXT_AMOUNT);
+
+    int dirty_size = (width * height) / 4;
+    if (dirty_size < PLAYFIELD_DIRTY_MIN)
+    {
+        dirty_size = PLAYFIELD_DIRTY_MIN;
+    }
+
+    solve_cache_t *cache = malloc(sizeof(solve_cache_t) * PLAYFIELD_SOLVE_CACHE);
+    memset(cache, 0, sizeof(solve_cache_t) * PLAYFIELD_SOLVE_CACHE);
+    for (int i = 0; i < PLAYFIELD_SOLVE_CACHE; i++)
+    {
+        cache[i].colors = malloc(width * height);
+    }
+
+    playfield_t *playfield = malloc(sizeof(playfield_t));
+    memset(playfield, 0, sizeof(playfield_t));
+    playfield->width = width;
+    playfield->height = height;
+    playfield->vertical = vertical;
+    playfield->entries = entries;
+    playfield->sources = sources;
+    playfield->upnext = upnext;
+    playfield->cache = cache;
+    playfield->dirty = malloc(sizeof(int) * dirty_size);
+    playfield->dirty_size = dirty_size;
+    playfield->active = malloc(sizeof(int) * width * height);
+    playfield->active_at = malloc(sizeof(int) * width * height);
+    playfield->labels = malloc(sizeof(uint32_t) * width * height);
+    memset(playfield->labels, 0, sizeof(uint32_t) * width * height);
+    playfield->members_x = malloc(sizeof(int) * width * height);
+    playfield->members_y = malloc(sizeof(int) * width * height);
+    playfield->blocked = malloc(sizeof(int) * width * height * 4);
+
+    // Every beam uses up two sources, so there can't be more than this.
+    playfield->beam_size = width + height;
+    playfield->beams = malloc(sizeof(playfield_beam_t) * playfield->beam_size);
+    playfield->beam_cells = malloc(sizeof(int) * width * height);
+    playfield->beam_at = malloc(sizeof(int) * width * height);
+    playfield->platform = platform;
+    memcpy(&playfield->rules, rules, sizeof(playfield_rules_t));
+
+    playfield->curx = width / 2;
+    playfield->cury = height / 2;
+    playfield_track_all(playfield);
+    playfield_reset_beams(playfield);
+
+    return playfield;
+}
+
+void playfield_free(playfield_t *playfield)
+{
+    free(playfield->entries);
+    free(playfield->sources);
+    free(playfield->upnext);
+    for (int i = 0; i < PLAYFIELD_SOLVE_CACHE; i++)
+    {
+        free(playfield->cache[i].colors);
+    }
+    free(playfield->cache);
+    free(playfield->dirty);
+    free(playfield->active);
+    free(playfield->active_at);
+    free(playfield->labels);
+    free(playfield->members_x);
+    free(playfield->members_y);
+    free(playfield->blocked);
+    free(playfield->beams);
+    free(playfield->beam_cells);
+    free(playfield->beam_at);
+    free(playfield);
+}
+
+void playfield_set_block(playfield_t *playfield, int x, int y, unsigned int block, unsigned int pipe)
+{
+    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+    playfield_hash_entry(playfield, cur);
+    cur->block = block;
+    cur->pipe = pipe;
+    playfield_hash_entry(playfield, cur);
+}
+
+void playfield_generate_block(playfield_t *playfield, int x, int y, unsigned int block_percent)
+{
+    static const unsigned int bits[4] = { PIPE_CONN_N, PIPE_CONN_E, PIPE_CONN_S, PIPE_CONN_W };
+
+    if (rng_chance(&playfield->rng, block_percent, 100))
+    {
+        // First handle the color chance (asthetic only).
+        playfield_entry_t *cur = playfield_entry(playfield, x, y);
+        int color = rng_range(&playfield->rng, 4) + BLOCK_TYPE_PURPLE;
+        playfield_hash_entry(playfield, cur);
+        cur->block = color;
+
+        // Now handle the connections.
+        int corner = rng_range(&playfield->rng, 4) + playfield->block_rotation;
+        int second = rng_range(&playfield->rng, 3);
+        cur->pipe = bits[corner % 4] | bits[(corner + (second > 0 ? 2 : 1)) % 4];
+        playfield_hash_entry(playfield, cur);
+        playfield->block_rotation++;
+    }
+}
+
+void playfield_generate_upnext(playfield_t *playfield)
+{
+    static const unsigned int bits[4] = { PIPE_CONN_N, PIPE_CONN_E, PIPE_CONN_S, PIPE_CONN_W };
+
+    for (int i = 0; i < UPNEXT_AMOUNT; i++)
+    {
+        playfield_entry_t *cur = playfield->upnext + i;
+
+        if (cur->block == BLOCK_TYPE_NONE)
+        {
+            int color = rng_range(&playfield->rng, 4) + BLOCK_TYPE_PURPLE;
+            cur->block = color;
+
+            int corner = rng_range(&playfield->rng, 4) + playfield->upnext_rotation;
+            int second = rng_range(&playfield->rng, 2);
+
+            cur->pipe = bits[corner % 4] | bits[(corner + (second > 0 ? 2 : 1)) % 4];
+            playfield->upnext_rotation++;
+        }
+    }
+
+    if (playfield->rules.placetimer)
+    {
+        playfield->timeleft = PLACE_TIME;
+    }
+}
+
+void playfield_set_source(playfield_t *playfield, int x, int y, unsigned int color)
+{
+    source_entry_t *cur = 0;
+    if (x == -1)
+    {
+        cur = playfield->sources + y;
+    }
+    else if (x == playfield->width)
+    {
+        cur = playfield->sources + playfield->height + y;
+    }
+    else if (y == playfield->height)
+    {
+        cur = playfield->sources + (2 * playfield->height) + x;
+    }
+    else if (y == -1)
+    {
+        cur = playfield->sources + (2 * playfield->height) + playfield->width + x;
+    }
+
+    if (cur)
+    {
+        playfield_hash_source(playfield, cur);
+        cur->color = color;
+        playfield_hash_source(playfield, cur);
+    }
+}
+
+// Where the pipe leaving x, y in the out direction goes. Moves x and y onto
+// the next cell and returns which way the pipe comes into it, or returns 0
+// with source set to whatever it runs into off the edge of the board.
+static unsigned int playfield_follow(playfield_t *playfield, int *x, int *y, unsigned int out_direction, source_entry_t **source)
+{
+    *source = 0;
+    switch(out_direction)
+    {
+        case PIPE_CONN_N:
+        {
+            if (*y == 0)
+            {
+                *source = playfield->sources + (2 * playfield->height) + playfield->width + *x;
+                return 0;
+            }
+            (*y)--;
+            return PIPE_CONN_S;
+        }
+        case PIPE_CONN_S:
+        {
+            if (*y == playfield->height - 1)
+            {
+                *source = playfield->sources + (2 * playfield->height) + *x;
+                return 0;
+            }
+            (*y)++;
+            return PIPE_CONN_N;
+        }
+        case PIPE_CONN_E:
+        {
+            if (*x == playfield->width - 1)
+            {
+                *source = playfield->sources + playfield->height + *y;
+                return 0;
+            }
+            (*x)++;
+            return PIPE_CONN_W;
+        }
+        case PIPE_CONN_W:
+        {
+            if (*x == 0)
+            {
+                *source = playfield->sources + *y;
+                return 0;
+            }
+            (*x)--;
+            return PIPE_CONN_E;
+        }
+    }
+
+    // Not a single direction, so it doesn't go anywhere.
+    return 0;
+}
+
+int playfield_touches_light(playfield_t *playfield, int x, int y, int in_direction, int color)
+{
+    // A chain coming in from a source can't branch or loop back on itself,
+    // so this is a walk along it no matter how big the board gets.
+    while (1)
+    {
+        // If this doesn't have a connection in the in direction, its always false.
+        playfield_entry_t *cur = playfield_entry(playfield, x, y);
+        if ((cur->pipe & in_direction) == 0)
+        {
+            return 0;
+        }
+
+        // Calculate the other direction of the pipe by removing the in direction.
+        source_entry_t *source;
+        in_direction = playfield_follow(playfield, &x, &y, cur->pipe & (~in_direction), &source);
+        if (in_direction == 0)
+        {
+            // Either it hits a light block, or who knows why, but we don't
+            // have a connection.
+            return source != 0 && (source->color & color) == (unsigned int)color;
+        }
+    }
+}
+
+void playfield_fill_light(playfield_t *playfield, int x, int y, int in_direction, int color, int from)
+{
+    // A beam between two sources of the same color gets lit from both ends,
+    // but it only needs writing down once.
+    if (playfield->beam_at[x + (y * playfield->width)] >= 0)
+    {
+        return;
+    }
+
+    int beam = playfield->beam_count++;
+    playfield->beams[beam].first = playfield->beam_used;
+    playfield->beams[beam].length = 0;
+    playfield->beams[beam].color = color;
+    playfield->beams[beam].from = from;
+    playfield->beams[beam].to = -1;
+
+    while (1)
+    {
+        // If this doesn't have a connection in the in direction, don't fill it.
+        playfield_entry_t *cur = playfield_entry(playfield, x, y);
+        if ((cur->pipe & in_direction) == 0)
+        {
+            return;
+        }
+
+        cur->color = color;
+        int cell = x + (y * playfield->width);
+        playfield->beam_cells[playfield->beam_used++] = cell;
+        playfield->beam_at[cell] = beam;
+        playfield->beams[beam].length++;
+
+        source_entry_t *source;
+        in_direction = playfield_follow(playfield, &x, &y, cur->pipe & (~in_direction), &source);
+        if (in_direction == 0)
+        {
+            playfield->beams[beam].to = source ? source - playfield->sources : -1;
+            return;
+        }
+    }
+}
+
+// Writes down the beams on a board that got its colors without lighting
+// them up one at a time, from a cache or another solver.
+static void playfield_trace_beams(playfield_t *playfield)
+{
+    for (int i = 0; i < (playfield->width * 2) + (playfield->height * 2); i++)
+    {
+        if (playfield->sources[i].color == SOURCE_COLOR_NONE)
+        {
+            continue;
+        }
+
+        int x;
+        int y;
+        int in_direction;
+        if (i < playfield->height)
+        {
+            x = 0;
+            y = i;
+            in_direction = PIPE_CONN_W;
+        }
+        else if (i < 2 * playfield->height)
+        {
+            x = playfield->width - 1;
+            y = i - playfield->height;
+            in_direction = PIPE_CONN_E;
+        }
+        else if (i < (2 * playfield->height) + playfield->width)
+        {
+            x = i - (2 * playfield->height);
+            y = playfield->height - 1;
+            in_direction = PIPE_CONN_S;
+        }
+        else
+        {
+            x = i - (2 * playfield->height) - playfield->width;
+            y = 0;
+            in_direction = PIPE_CONN_N;
+        }
+
+        playfield_entry_t *cur = playfield_entry(playfield, x, y);
+        if (cur->color != SOURCE_COLOR_NONE && cur->color != SOURCE_COLOR_IMPOSSIBLE && (cur->pipe & in_direction) != 0)
+        {
+            // Already the right color, so this only writes it down.
+            playfield_fill_light(playfield, x, y, in_direction, cur->color, i);
+        }
+    }
+}
+
+// How two ends of the same chain merge. A chain can only take on one color,
+// so one end has to be all of the other, and it ends up the one with fewer
+// bands in it.
+static unsigned int playfield_combine_color(unsigned int color, unsigned int end)
+{
+    if (color == SOURCE_COLOR_IMPOSSIBLE || end == SOURCE_COLOR_IMPOSSIBLE)
+    {
+        return SOURCE_COLOR_IMPOSSIBLE;
+    }
+    if (color == SOURCE_COLOR_NONE || (color & end) == end)
+    {
+        return end == SOURCE_COLOR_NONE ? color : end;
+    }
+    if ((color & end) == color)
+    {
+        return color;
+    }
+
+    // Wrong color bands touching.
+    return SOURCE_COLOR_IMPOSSIBLE;
+}
+
+static int playfield_connects(playfield_entry_t *entry, unsigned int in_direction)
+{
+    return entry->block != BLOCK_TYPE_NONE && (entry->pipe & in_direction) != 0;
+}
+
+// Starts a round of gathering chains, and returns the label every chain
+// gathered from here on will be above. Labels only get cleared on the rare
+// occasion they'd run out partway through a round.
+static uint32_t playfield_start_pass(playfield_t *playfield)
+{
+    int cells = playfield->width * playfield->height;
+    if (playfield->label > UINT32_MAX - (uint32_t)cells)
+    {
+        memset(playfield->labels, 0, sizeof(uint32_t) * cells);
+        playfield->label = 0;
+    }
+    return playfield->label;
+}
+
+// Gathers up every block connected to the one at x, y into the members
+// lists, and works out what color the whole chain should be. That's the
+// lit color if both ends run into sources that agree, impossible if it
+// loops, runs off the edge where there's no source, dead ends into any part
+// of itself, or has sources at both ends that can never agree, and none
+// otherwise.
+static unsigned int playfield_chain_color(playfield_t *playfield, int x, int y, int *count)
+{
+    uint32_t label = ++playfield->label;
+    uint32_t *labels = playfield->labels;
+    // Kept as coordinates rather than cells, since dividing them back out
+    // every step costs more than everything else in here put together.
+    int *members_x = playfield->members_x;
+    int *members_y = playfield->members_y;
+    // Blocks that loose ends run into without connecting. Whether they're
+    // part of the same chain is only known once all of it's gathered up.
+    int *blocked = playfield->blocked;
+
+    unsigned int color = SOURCE_COLOR_NONE;
+    int loose = 0;
+    int sourced = 0;
+    int ends = 0;
+    int gathered = 0;
+    labels[x + (y * playfield->width)] = label;
+    members_x[gathered] = x;
+    members_y[gathered] = y;
+    gathered++;
+    for (int i = 0; i < gathered; i++)
+    {
+        int cx = members_x[i];
+        int cy = members_y[i];
+        unsigned int pipe = playfield_entry(playfield, cx, cy)->pipe;
+        for (int d = 0; d < 4; d++)
+        {
+            if ((pipe & (1 << d)) == 0)
+            {
+                continue;
+            }
+
+            int nx = cx;
+            int ny = cy;
+            source_entry_t *source;
+            unsigned int in_direction = playfield_follow(playfield, &nx, &ny, 1 << d, &source);
+            if (in_direction == 0)
+            {
+                // Runs off the edge, which had better be into a source.
+                loose++;
+                if (source->color != SOURCE_COLOR_NONE)
+                {
+                    sourced++;
+                }
+                color = playfield_combine_color(color, source->color ? source->color : SOURCE_COLOR_IMPOSSIBLE);
+                continue;
+            }
+
+            int next = nx + (ny * playfield->width);
+            if (playfield_connects(playfield->entries + next, in_direction))
+            {
+                // Connected, so this isn't an end at all.
+                if (labels[next] != label)
+                {
+                    labels[next] = label;
+                    members_x[gathered] = nx;
+                    members_y[gathered] = ny;
+                    gathered++;
+                }
+                continue;
+            }
+
+            loose++;
+            blocked[ends++] = next;
+        }
+    }
+
+    // A block that doesn't connect could be cleared, unless it's part of
+    // this same chain.
+    for (int i = 0; i < ends; i++)
+    {
+        if (labels[blocked[i]] == label)
+        {
+            color = SOURCE_COLOR_IMPOSSIBLE;
+        }
+    }
+
+    if (loose == 0 && playfield_entry(playfield, x, y)->pipe != PIPE_CONN_NONE)
+    {
+        // No loose ends at all, so it loops.
+        color = SOURCE_COLOR_IMPOSSIBLE;
+    }
+
+    *count = gathered;
+    if (color == SOURCE_COLOR_IMPOSSIBLE || (loose > 0 && sourced == loose))
+    {
+        return color;
+    }
+    return SOURCE_COLOR_NONE;
+}
+
+// Marks every chain of pipes that isn't lit and can never be lit, no matter
+// what gets placed later. Every chain gets gathered up once and then has
+// its loose ends looked at, so this stays linear in the size of the board.
+static void playfield_mark_impossible(playfield_t *playfield)
+{
+    uint32_t pass = playfield_start_pass(playfield);
+    for (int y = 0; y < playfield->height; y++)
+    {
+        for (int x = 0; x < playfield->width; x++)
+        {
+            playfield_entry_t *first = playfield_entry(playfield, x, y);
+            if (first->block == BLOCK_TYPE_NONE || first->color != SOURCE_COLOR_NONE)
+            {
+                continue;
+            }
+            if (playfield->labels[x + (y * playfield->width)] > pass)
+            {
+                // Already part of a chain we looked at.
+                continue;
+            }
+
+            int count;
+            if (playfield_chain_color(playfield, x, y, &count) == SOURCE_COLOR_IMPOSSIBLE)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    playfield_entry(playfield, playfield->members_x[i], playfield->members_y[i])->color = SOURCE_COLOR_IMPOSSIBLE;
+                }
+            }
+        }
+    }
+}
+
+// Writes down the beam along the lit chain that was just gathered, starting
+// from whichever end comes up first.
+static void playfield_light_chain(playfield_t *playfield, int count, unsigned int color)
+{
+    if (playfield->beam_used + count > playfield->width * playfield->height || playfield->beam_count == playfield->beam_size)
+    {
+        // Dropped beams are still taking up room.
+        playfield_pack_beams(playfield);
+    }
+
+    for (int m = 0; m < count; m++)
+    {
+        int x = playfield->members_x[m];
+        int y = playfield->members_y[m];
+        unsigned int pipe = playfield_entry(playfield, x, y)->pipe;
+        for (int d = 0; d < 4; d++)
+        {
+            int nx = x;
+            int ny = y;
+            source_entry_t *source;
+            if ((pipe & (1 << d)) != 0 && playfield_follow(playfield, &nx, &ny, 1 << d, &source) == 0)
+            {
+                playfield_fill_light(playfield, x, y, 1 << d, color, source - playfield->sources);
+                return;
+            }
+        }
+    }
+}
+
+// Works out colors again for only the chains that changed cells are or
+// were part of. Every chain a change broke up or joined together has a
+// piece next to a changed cell, and nothing about any other chain has
+// changed, so this gets the same colors as solving from scratch.
+static void playfield_solve_dirty(playfield_t *playfield, int *activated, int *wrong)
+{
+    static const int dx[5] = { 0, 0, 1, 0, -1 };
+    static const int dy[5] = { 0, -1, 0, 1, 0 };
+
+    uint32_t pass = playfield_start_pass(playfield);
+    for (int i = 0; i < playfield->dirty_count; i++)
+    {
+        int cell = playfield->dirty[i];
+        int x = cell % playfield->width;
+        int y = cell / playfield->width;
+        for (int d = 0; d < 5; d++)
+        {
+            int nx = x + dx[d];
+            int ny = y + dy[d];
+            if (nx < 0 || nx >= playfield->width || ny < 0 || ny >= playfield->height)
+            {
+                continue;
+            }
+
+            int next = nx + (ny * playfield->width);
+            playfield_entry_t *cur = playfield->entries + next;
+            if (cur->block == BLOCK_TYPE_NONE)
+            {
+                // Emptied out, and empty cells never have a color.
+                if (playfield->beam_at[next] >= 0)
+                {
+                    playfield_kill_beam(playfield, playfield->beam_at[next]);
+                }
+                if (cur->color != SOURCE_COLOR_NONE)
+                {
+                    cur->color = SOURCE_COLOR_NONE;
+                    playfield_track(playfield, next);
+                }
+                continue;
+            }
+            if (playfield->labels[next] > pass)
+            {
+                continue;
+            }
+
+            int count;
+            unsigned int color = playfield_chain_color(playfield, nx, ny, &count);
+            if (color == SOURCE_COLOR_IMPOSSIBLE && !playfield->rules.placing)
+            {
+                color = SOURCE_COLOR_NONE;
+            }
+
+            for (int m = 0; m < count; m++)
+            {
+                int member = playfield->members_x[m] + (playfield->members_y[m] * playfield->width);
+                playfield_entry_t *entry = playfield->entries + member;
+                if (playfield->beam_at[member] >= 0)
+                {
+                    playfield_kill_beam(playfield, playfield->beam_at[member]);
+                }
+                if (entry->color != color)
+                {
+                    if (color == SOURCE_COLOR_IMPOSSIBLE)
+                    {
+                        *wrong = 1;
+                    }
+                    else if (color != SOURCE_COLOR_NONE)
+                    {
+                        *activated = 1;
+                    }
+                    entry->color = color;
+                    entry->age = 0;
+                    playfield_track(playfield, member);
+                }
+            }
+
+            if (color != SOURCE_COLOR_NONE && color != SOURCE_COLOR_IMPOSSIBLE)
+            {
+                playfield_light_chain(playfield, count, color);
+            }
+        }
+    }
+}
+
+// Works out every cell's color from scratch.
+static void playfield_solve(playfield_t *playfield)
+{
+    for (int y = 0; y < playfield->height; y++)
+    {
+        for (int x = 0; x < playfield->width; x++)
+        {
+            // Turn off all connections and then recalculate.
+            playfield_entry(playfield, x, y)->color = SOURCE_COLOR_NONE;
+        }
+    }
+
+    // Now, go through each light source and see if it connects to another of its color.
+    TRACE_BEGIN("light");
+    for (int lsy = 0; lsy < playfield->height; lsy++)
+    {
+        source_entry_t *source = playfield->sources + lsy;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (playfield_touches_light(playfield, 0, lsy, PIPE_CONN_W, source->color))
+            {
+                playfield_fill_light(playfield, 0, lsy, PIPE_CONN_W, source->color, lsy);
+            }
+        }
+
+        source = playfield->sources + lsy + playfield->height;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (playfield_touches_light(playfield, playfield->width - 1, lsy, PIPE_CONN_E, source->color))
+            {
+                playfield_fill_light(playfield, playfield->width - 1, lsy, PIPE_CONN_E, source->color, playfield->height + lsy);
+            }
+        }
+    }
+
+    for (int lsx = 0; lsx < playfield->width; lsx++)
+    {
+        source_entry_t *source = playfield->sources + (2 * playfield->height) + lsx;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (playfield_touches_light(playfield, lsx, playfield->height - 1, PIPE_CONN_S, source->color))
+            {
+                playfield_fill_light(playfield, lsx, playfield->height - 1, PIPE_CONN_S, source->color, (2 * playfield->height) + lsx);
+            }
+        }
+
+        source = playfield->sources + (2 * playfield->height) + playfield->width + lsx;
+        if (source->color != SOURCE_COLOR_NONE)
+        {
+            if (playfield_touches_light(playfield, lsx, 0, PIPE_CONN_N, source->color))
+            {
+                playfield_fill_light(playfield, lsx, 0, PIPE_CONN_N, source->color, (2 * playfield->height) + playfield->width + lsx);
+            }
+        }
+    }
+
+    TRACE_END("light");
+
+    // Now, find and mark impossible chunks of pipes.
+    if (playfield->rules.placing)
+    {
+        TRACE_BEGIN("impossible");
+        playfield_mark_impossible(playfield);
+        TRACE_END("impossible");
+    }
+}
+
+void playfield_check_connections(playfield_t *playfield)
+{
+    PROFILER_BEGIN(PROFILER_PHASE_CONNECTIONS);
+    playfield->solves++;
+
+    // Colors only depend on what's hashed, so a board we've solved recently
+    // gets the same colors it got last time. This happens every tick that
+    // nothing gets placed or cleared, and whenever a block gets turned back.
+    int cells = playfield->width * playfield->height;
+    uint64_t hash = playfield->zobrist ^ (playfield->rules.placing ? playfield_zobrist_key(UINT32_MAX) : 0);
+    if (!playfield->uncached && playfield->colored_valid && playfield->colored == hash && playfield->dirty_count == 0)
+    {
+        // Nothing's changed since the colors on the board were worked out,
+        // so there's nothing to copy, compare or reset. On big boards this
+        // is most ticks, and it doesn't cost more the bigger they get.
+        playfield->solve_hits++;
+        PROFILER_END(PROFILER_PHASE_CONNECTIONS);
+        return;
+    }
+
+    int activated = 0;
+    int wrong = 0;
+    if (!playfield->uncached && playfield->colored_valid && playfield->dirty_count <= playfield->dirty_size)
+    {
+        // Only a few cells changed since the colors on the board were worked
+        // out, so only their chains need looking at.
+        TRACE_BEGIN("incremental");
+        playfield_solve_dirty(playfield, &activated, &wrong);
+        TRACE_END("incremental");
+    }
+    else
+    {
+        // Keep track of what changed so we can reset countdowns. Colors are
+        // all that can change, so they're all we need to keep.
+        uint8_t *oldcolors = malloc(sizeof(uint8_t) * cells);
+        for (int i = 0; i < cells; i++)
+        {
+            oldcolors[i] = playfield->entries[i].color;
+        }
+
+        playfield_reset_beams(playfield);
+        solve_cache_t *cached = &playfield->cache[hash % PLAYFIELD_SOLVE_CACHE];
+        if (!playfield->uncached && cached->valid && cached->hash == hash)
+        {
+            playfield->solve_hits++;
+            for (int i = 0; i < cells; i++)
+            {
+                playfield->entries[i].color = cached->colors[i];
+            }
+            playfield_trace_beams(playfield);
+        }
+        else
+        {
+            if (playfield->solver)
+            {
+                playfield->solver(playfield, playfield->solver_user);
+                playfield_trace_beams(playfield);
+            }
+            else
+            {
+                playfield_solve(playfield);
+            }
+
+            cached->valid = 1;
+            cached->hash = hash;
+            for (int i = 0; i < cells; i++)
+            {
+                cached->colors[i] = playfield->entries[i].color;
+            }
+        }
+
+        // Now, for anything that changed, reset its age. The active list was
+        // right for the old colors, so only those need moving in or out.
+        for (int i = 0; i < cells; i++)
+        {
+            playfield_entry_t *cur = playfield->entries + i;
+            if (cur->color != oldcolors[i])
+            {
+                if (cur->color == SOURCE_COLOR_IMPOSSIBLE)
+                {
+                    wrong = 1;
+                }
+                else if (cur->color != SOURCE_COLOR_NONE)
+                {
+                    activated = 1;
+                }
+                cur->age = 0;
+                playfield_track(playfield, i);
+            }
+        }
+
+        // Now that we don't need the old colors, free them.
+        free(oldcolors);
+    }
+
+    if (activated)
+    {
+        playfield_sound(playfield, PLAYFIELD_SOUND_ACTIVATE);
+    }
+    if (wrong)
+    {
+        playfield_sound(playfield, PLAYFIELD_SOUND_BAD);
+    }
+
+    if (playfield->beam_dead)
+    {
+        playfield_pack_beams(playfield);
+    }
+
+    playfield->colored = hash;
+    playfield->colored_valid = 1;
+    playfield->dirty_count = 0;
+
+    PROFILER_END(PROFILER_PHASE_CONNECTIONS);
+}
+
+void playfield_cursor_rotate(playfield_t *playfield, int direction)
+{
+    switch(direction)
+    {
+        case CURSOR_ROTATE_LEFT:
+        {
+            playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+
+            if (cur->block != BLOCK_TYPE_NONE)
+            {
+                unsigned int new_rotation = 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_N) ? PIPE_CONN_W : 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_E) ? PIPE_CONN_N : 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_S) ? PIPE_CONN_E : 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_W) ? PIPE_CONN_S : 0;
+                playfield_hash_entry(playfield, cur);
+                cur->pipe = new_rotation;
+                playfield_hash_entry(playfield, cur);
+                playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+            }
+
+            break;
+        }
+        case CURSOR_ROTATE_RIGHT:
+        {
+            playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+
+            if (cur->block != BLOCK_TYPE_NONE)
+            {
+                unsigned int new_rotation = 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_N) ? PIPE_CONN_E : 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_E) ? PIPE_CONN_S : 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_S) ? PIPE_CONN_W : 0;
+                new_rotation |= (cur->pipe & PIPE_CONN_W) ? PIPE_CONN_N : 0;
+                playfield_hash_entry(playfield, cur);
+                cur->pipe = new_rotation;
+                playfield_hash_entry(playfield, cur);
+                playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+            }
+
+            break;
+        }
+    }
+
+    playfield_check_connections(playfield);
+}
+
+void playfield_apply_gravity(playfield_t *playfield)
+{
+    TRACE_BEGIN("gravity");
+
+    // Slide every column's blocks down to the bottom in the same order
+    // they were in, one pass per column.
+    for (int x = 0; x < playfield->width; x++)
+    {
+        int bottom = playfield->height - 1;
+        for (int y = playfield->height - 1; y >= 0; y--)
+        {
+            playfield_entry_t *cur = playfield_entry(playfield, x, y);
+            if (cur->block != BLOCK_TYPE_NONE)
+            {
+                if (y != bottom)
+                {
+                    playfield_swap_entries(playfield, cur, playfield_entry(playfield, x, bottom));
+                }
+                bottom--;
+            }
+        }
+    }
+    TRACE_END("gravity");
+
+    playfield_check_connections(playfield);
+}
+
+void playfield_age(playfield_t *playfield)
+{
+    static const int mult[8] = {0, 1, 1, 2, 1, 2, 2, 4};
+    int cleared = 0;
+
+    // Only lit and impossible cells age, and those are all in the active
+    // list. Going backwards means a cell moved into a cleared one's spot
+    // has already been looked at.
+    for (int i = playfield->active_count - 1; i >= 0; i--)
+    {
+        // Kill any connections with light active that are older than
+        // some age.
+        int cell = playfield->active[i];
+        playfield_entry_t *cur = playfield->entries + cell;
+        if (cur->block != BLOCK_TYPE_NONE && cur->color != SOURCE_COLOR_NONE)
+        {
+            if (cur->age > MAX_AGE)
+            {
+                if (cur->color == SOURCE_COLOR_IMPOSSIBLE)
+                {
+                    playfield->score -= 5;
+                }
+                else
+                {
+                    cleared = 1;
+                    playfield->score += mult[cur->color & 7] * 5;
+                }
+
+                playfield_hash_entry(playfield, cur);
+                memset(cur, 0, sizeof(playfield_entry_t));
+                playfield_track(playfield, cell);
+            }
+            else
+            {
+                cur->age ++;
+            }
+        }
+    }
+
+    if (cleared)
+    {
+        playfield_sound(playfield, PLAYFIELD_SOUND_CLEAR);
+    }
+
+    if (playfield->rules.gravity)
+    {
+        playfield_apply_gravity(playfield);
+    }
+    else
+    {
+        playfield_check_connections(playfield);
+    }
+
+    if (playfield->score < 0)
+    {
+        playfield->score = 0;
+    }
+}
+
+void playfield_cursor_move(playfield_t *playfield, int direction)
+{
+    switch(direction)
+    {
+        case CURSOR_MOVE_UP:
+        {
+            if (playfield->cury > 0)
+            {
+                playfield->cury--;
+                playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+            }
+            break;
+        }
+        case CURSOR_MOVE_DOWN:
+        {
+            if (playfield->cury < (playfield->height - 1))
+            {
+                playfield->cury++;
+                playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+            }
+            break;
+        }
+        case CURSOR_MOVE_LEFT:
+        {
+            if (playfield->curx > 0)
+            {
+                playfield->curx--;
+                playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+            }
+            break;
+        }
+        case CURSOR_MOVE_RIGHT:
+        {
+            if (playfield->curx < (playfield->width - 1))
+            {
+                playfield->curx++;
+                playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+            }
+            break;
+        }
+    }
+}
+
+void playfield_cursor_drag(playfield_t *playfield, int direction)
+{
+    switch(direction)
+    {
+        case CURSOR_MOVE_UP:
+        {
+            if (playfield->cury > 0)
+            {
+                playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+                playfield_entry_t *swap = playfield_entry(playfield, playfield->curx, playfield->cury - 1);
+
+                if (cur->block != BLOCK_TYPE_NONE && swap->block != BLOCK_TYPE_NONE)
+                {
+                    playfield_swap_entries(playfield, cur, swap);
+                    playfield->cury--;
+                    playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                }
+            }
+            break;
+        }
+        case CURSOR_MOVE_DOWN:
+        {
+            if (playfield->cury < (playfield->height - 1))
+            {
+                playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+                playfield_entry_t *swap = playfield_entry(playfield, playfield->curx, playfield->cury + 1);
+
+                if (cur->block != BLOCK_TYPE_NONE && swap->block != BLOCK_TYPE_NONE)
+                {
+                    playfield_swap_entries(playfield, cur, swap);
+                    playfield->cury++;
+                    playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                }
+            }
+            break;
+        }
+        case CURSOR_MOVE_LEFT:
+        {
+            if (playfield->curx > 0)
+            {
+                playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+                playfield_entry_t *swap = playfield_entry(playfield, playfield->curx - 1, playfield->cury);
+
+                if (playfield->rules.gravity)
+                {
+                    // We allow bumping down for horizontal movements.
+                    if (cur->block != BLOCK_TYPE_NONE)
+                    {
+                        int simplemove = swap->block != BLOCK_TYPE_NONE;
+
+                        if (simplemove)
+                        {
+                            playfield->curx--;
+                        }
+                        else
+                        {
+                            playfield->curx--;
+                            while(playfield_entry(playfield, playfield->curx, playfield->cury + 1)->block == BLOCK_TYPE_NONE)
+                            {
+                                playfield->cury++;
+                            }
+                        }
+
+                        playfield_swap_entries(playfield, cur, swap);
+                        playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                    }
+                }
+                else
+                {
+                    if (cur->block != BLOCK_TYPE_NONE && swap->block != BLOCK_TYPE_NONE)
+                    {
+                        playfield_swap_entries(playfield, cur, swap);
+                        playfield->cury++;
+                        playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                    }
+                }
+            }
+            break;
+        }
+        case CURSOR_MOVE_RIGHT:
+        {
+            if (playfield->curx < (playfield->width - 1))
+            {
+                playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+                playfield_entry_t *swap = playfield_entry(playfield, playfield->curx + 1, playfield->cury);
+
+                if (playfield->rules.gravity)
+                {
+                    // We allow bumping down for horizontal movements.
+                    if (cur->block != BLOCK_TYPE_NONE)
+                    {
+                        int simplemove = swap->block != BLOCK_TYPE_NONE;
+
+                        if (simplemove)
+                        {
+                            playfield->curx++;
+                        }
+                        else
+                        {
+                            playfield->curx++;
+                            while(playfield_entry(playfield, playfield->curx, playfield->cury + 1)->block == BLOCK_TYPE_NONE)
+                            {
+                                playfield->cury++;
+                            }
+                        }
+
+                        playfield_swap_entries(playfield, cur, swap);
+                        playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                    }
+                }
+                else
+                {
+                    if (cur->block != BLOCK_TYPE_NONE && swap->block != BLOCK_TYPE_NONE)
+                    {
+                        playfield_swap_entries(playfield, cur, swap);
+                        playfield->cury++;
+                        playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    if (playfield->rules.gravity)
+    {
+        playfield_apply_gravity(playfield);
+    }
+    else
+    {
+        playfield_check_connections(playfield);
+    }
+}
+
+void playfield_cursor_swap(playfield_t *playfield, int direction)
+{
+    switch(direction)
+    {
+        case SWAP_DIRECTION_HORIZONTAL:
+        {
+            if (playfield->curx > 0 && playfield->curx < (playfield->width - 1))
+            {
+                playfield_entry_t *swap1 = playfield_entry(playfield, playfield->curx - 1, playfield->cury);
+                playfield_entry_t *swap2 = playfield_entry(playfield, playfield->curx + 1, playfield->cury);
+
+                if (swap1->block != BLOCK_TYPE_NONE && swap2->block != BLOCK_TYPE_NONE)
+                {
+                    playfield_swap_entries(playfield, swap1, swap2);
+                    playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                }
+            }
+            break;
+        }
+        case SWAP_DIRECTION_VERTICAL:
+        {
+            if (playfield->cury > 0 && playfield->cury < (playfield->height - 1))
+            {
+                playfield_entry_t *swap1 = playfield_entry(playfield, playfield->curx, playfield->cury + 1);
+                playfield_entry_t *swap2 = playfield_entry(playfield, playfield->curx, playfield->cury - 1);
+
+                if (swap1->block != BLOCK_TYPE_NONE && swap2->block != BLOCK_TYPE_NONE)
+                {
+                    playfield_swap_entries(playfield, swap1, swap2);
+                    playfield_sound(playfield, PLAYFIELD_SOUND_SCROLL);
+                }
+            }
+            break;
+        }
+    }
+
+    playfield_check_connections(playfield);
+}
+
+int playfield_cursor_drop(playfield_t *playfield)
+{
+    int dropped = 0;
+    playfield_entry_t *cur = playfield_entry(playfield, playfield->curx, playfield->cury);
+    if (cur->block == BLOCK_TYPE_NONE && playfield->upnext->block != BLOCK_TYPE_NONE)
+    {
+        // Assign the block to the actual playfield.
+        memcpy(cur, playfield->upnext, sizeof(playfield_entry_t));
+        playfield_hash_entry(playfield, cur);
+        playfield_sound(playfield, PLAYFIELD_SOUND_DROP);
+
+        // Prepare the next upnext block.
+        memmove(&playfield->upnext[0], &playfield->upnext[1], sizeof(playfield_entry_t) * (UPNEXT_AMOUNT - 1));
+        memset(&playfield->upnext[UPNEXT_AMOUNT - 1], 0, sizeof(playfield_entry_t));
+        playfield_generate_upnext(playfield);
+        dropped = 1;
+    }
+
+    if (playfield->rules.gravity)
+    {
+        playfield_apply_gravity(playfield);
+    }
+    else
+    {
+        playfield_check_connections(playfield);
+    }
+
+    return dropped;
+}
+
+void playfield_decrease_placetime(playfield_t *playfield, float elapsed)
+{
+    if (playfield->rules.placetimer)
+    {
+        playfield->timeleft -= elapsed;
+    }
+}
+
+void playfield_drop_anywhere(playfield_t *playfield)
+{
+    if (playfield->rules.placetimer)
+    {
+        if (playfield->timeleft <= 0.0 && playfield->upnext->block != BLOCK_TYPE_NONE)
+        {
+            // Try to drop on the cursor.
+            int success = playfield_cursor_drop(playfield);
+            if (success)
+            {
+                return;
+            }
+
+            // Drop randomly.
+            int available = 0;
+            for (int y = 0; y < playfield->height; y++)
+            {
+                for (int x = 0; x < playfield->width; x++)
+                {
+                    playfield_entry_t *cur = playfield_entry(playfield, x, y);
+                    if (cur->block == BLOCK_TYPE_NONE)
+                    {
+                        available++;
+                    }
+                }
+            }
+
+            if (available)
+            {
+                int location = rng_range(&playfield->rng, available);
+                int actual = 0;
+                for (int y = 0; y < playfield->height; y++)
+                {
+                    for (int x = 0; x < playfield->width; x++)
+                    {
+                        playfield_entry_t *cur = playfield_entry(playfield, x, y);
+                        if (cur->block == BLOCK_TYPE_NONE)
+                        {
+                            if (actual == location)
+                            {
+                                // Assign the block to the actual playfield.
+                                memcpy(cur, playfield->upnext, sizeof(playfield_entry_t));
+                                playfield_hash_entry(playfield, cur);
+                                playfield_sound(playfield, PLAYFIELD_SOUND_DROP);
+
+                                // Prepare the next upnext block.
+                                memmove(&playfield->upnext[0], &playfield->upnext[1], sizeof(playfield_entry_t) * (UPNEXT_AMOUNT - 1));
+                                memset(&playfield->upnext[UPNEXT_AMOUNT - 1], 0, sizeof(playfield_entry_t));
+                                playfield_generate_upnext(playfield);
+
+                                if (playfield->rules.gravity)
+                                {
+                                    playfield_apply_gravity(playfield);
+                                }
+                                else
+                                {
+                                    playfield_check_connections(playfield);
+                                }
+
+                                return;
+                            }
+                            actual++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void playfield_run(playfield_t *playfield, uint32_t seed)
+{
+    rng_seed(&playfield->rng, seed);
+    playfield->seed = seed;
+    playfield->block_rotation = 0;
+    playfield->upnext_rotation = 0;
+
+    memset(playfield->entries, 0, sizeof(playfield_entry_t) * playfield->width * playfield->height);
+    memset(playfield->sources, 0, sizeof(source_entry_t) * ((playfield->width * 2) + (playfield->height * 2)));
+    memset(playfield->upnext, 0, sizeof(playfield_entry_t) * UPNEXT_AMOUNT);
+    playfield->zobrist = 0;
+    playfield->colored_valid = 0;
+
+    if (playfield->rules.placing)
+    {
+        playfield_generate_upnext(playfield);
+    }
+    else
+    {
+        for (int y = 0; y < playfield->height; y++)
+        {
+            for (int x = 0; x < playfield->width; x++)
+            {
+                playfield_generate_block(playfield, x, y, 75);
+            }
+        }
+    }
+
+    if (playfield->rules.gravity)
+    {
+        playfield_apply_gravity(playfield);
+    }
+    else
+    {
+        playfield_check_connections(playfield);
+    }
+
+    // Sources go on every other cell along each edge, so bigger boards get
+    // proportionally more of them. The sides cycle through the primary
+    // colors, the top and bottom through the mixes in opposite orders.
+    static const unsigned int side_colors[4] = {
+        SOURCE_COLOR_RED,
+        SOURCE_COLOR_GREEN,
+        SOURCE_COLOR_BLUE,
+        SOURCE_COLOR_GREEN,
+    };
+    static const unsigned int mixed_colors[4] = {
+        SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE,
+        SOURCE_COLOR_RED | SOURCE_COLOR_BLUE,
+        SOURCE_COLOR_RED | SOURCE_COLOR_GREEN,
+        SOURCE_COLOR_RED | SOURCE_COLOR_GREEN | SOURCE_COLOR_BLUE,
+    };
+
+    for (int y = 1; y < playfield->height - 1; y += 2)
+    {
+        playfield_set_source(playfield, -1, y, side_colors[(y / 2) % 4]);
+        playfield_set_source(playfield, playfield->width, y, side_colors[(y / 2) % 4]);
+    }
+
+    int mixed = (playfield->width - 1) / 2;
+    for (int x = 1; x < playfield->width - 1; x += 2)
+    {
+        playfield_set_source(playfield, x, playfield->height, mixed_colors[(x / 2) % 4]);
+        playfield_set_source(playfield, x, -1, mixed_colors[(mixed - 1 - (x / 2)) % 4]);
+    }
+
+    // Every game starts from the same spot, so that the seed and the
+    // controls are all it takes to play a game out again.
+    playfield->curx = playfield->width / 2;
+    playfield->cury = playfield->height / 2;
+
+    playfield->score = 0;
+    playfield->running = 1;
+    playfield->started = playfield->platform->time(playfield->platform->user);
+}
+
+void playfield_stop(playfield_t *playfield)
+{
+    if (playfield->running)
+    {
+        playfield->ended = playfield->platform->time(playfield->platform->user);
+    }
+    playfield->running = 0;
+}
+
+uint32_t playfield_state_hash(playfield_t *playfield)
+{
+    // Cheap FNV-1a over everything a button press can change, so we can tell
+    // whether the input handled this frame actually did anything.
+    uint32_t hash = 2166136261u;
+    int values[4] = { playfield->curx, playfield->cury, playfield->running, playfield->score };
+    uint8_t *chunks[3] = { (uint8_t *)values, (uint8_t *)playfield->entries, (uint8_t *)playfield->upnext };
+    unsigned int lengths[3] = {
+        sizeof(values),
+        sizeof(playfield_entry_t) * playfield->width * playfield->height,
+        sizeof(playfield_entry_t) * UPNEXT_AMOUNT,
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (unsigned int j = 0; j < lengths[i]; j++)
+        {
+            hash = (hash ^ chunks[i][j]) * 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+int playfield_occupied(playfield_t *playfield)
+{
+    int occupied = 0;
+    for (int i = 0; i < playfield->width * playfield->height; i++)
+    {
+        if (playfield->entries[i].block != BLOCK_TYPE_NONE)
+        {
+            occupied++;
+        }
+    }
+
+    return occupied;
+}
+
+int playfield_running(playfield_t *playfield)
+{
+    if (playfield_game_over(playfield))
+    {
+        playfield_stop(playfield);
+    }
+
+    if (playfield->running == 0)
+    {
+        return 0;
+    }
+    else
+    {
+        return 1;
+    }
+}
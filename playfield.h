@@ -0,0 +1,249 @@
+#ifndef __PLAYFIELD_H
+#define __PLAYFIELD_H
+
+#include <stdint.h>
+#include "rng.h"
+#include "sim.h"
+
+// The game engine itself. None of this touches video, audio, controls or
+// timers directly, anything it needs from the outside world goes through
+// the platform below, so the same code runs on the Naomi and headless on
+// the host. All state lives in the playfield, so separate playfields can be
+// run on separate threads at the same time.
+
+// Core game rule adjustments.
+#define PLAYFIELD_WIDTH 9
+#define PLAYFIELD_HEIGHT 11
+#define PLACE_TIME 5.0
+
+// Lit beams clear after about a second of simulation ticks.
+#define MAX_AGE SIM_TICK_RATE
+
+typedef struct
+{
+    int gravity;
+    int rotation;
+    int dragging;
+    int placing;
+    int placetimer;
+} playfield_rules_t;
+
+// Sounds the engine asks the platform to play.
+#define PLAYFIELD_SOUND_ACTIVATE 0
+#define PLAYFIELD_SOUND_BAD 1
+#define PLAYFIELD_SOUND_CLEAR 2
+#define PLAYFIELD_SOUND_DROP 3
+#define PLAYFIELD_SOUND_SCROLL 4
+#define PLAYFIELD_SOUND_COUNT 5
+
+typedef struct
+{
+    // Play one of the PLAYFIELD_SOUND_* effects.
+    void (*sound)(int sound, void *user);
+    // Microseconds on whatever clock the platform likes.
+    uint64_t (*time)(void *user);
+    void *user;
+} playfield_platform_t;
+
+typedef struct
+{
+    unsigned int block;
+    unsigned int pipe;
+    unsigned int color;
+    unsigned int age;
+} playfield_entry_t;
+
+typedef struct
+{
+    unsigned int color;
+} source_entry_t;
+
+#define SOURCE_COLOR_NONE 0
+#define SOURCE_COLOR_RED 0x1
+#define SOURCE_COLOR_GREEN 0x2
+#define SOURCE_COLOR_BLUE 0x4
+#define SOURCE_COLOR_IMPOSSIBLE 0x8
+
+#define UPNEXT_AMOUNT 5
+
+// How many solved boards every playfield remembers.
+#define PLAYFIELD_SOLVE_CACHE 16
+
+// The fewest changed cells a playfield keeps track of between solves. Big
+// boards keep track of up to a quarter of their cells.
+#define PLAYFIELD_DIRTY_MIN 64
+
+// A solved board's colors, looked up by the board's hash.
+typedef struct
+{
+    uint64_t hash;
+    int valid;
+    uint8_t *colors;
+} solve_cache_t;
+
+// A lit beam, running between two sources.
+typedef struct
+{
+    // Where this beam's cells start in the playfield's beam cells and how
+    // many there are, in the order light runs along them.
+    int first;
+    int length;
+    unsigned int color;
+    // The sources at either end, as indexes into sources. Light runs from
+    // the first one to the second.
+    int from;
+    int to;
+} playfield_beam_t;
+
+typedef struct playfield
+{
+    int width;
+    int height;
+    int curx;
+    int cury;
+    int score;
+    int running;
+    int vertical;
+    float timeleft;
+    playfield_entry_t *entries;
+    source_entry_t *sources;
+    playfield_entry_t *upnext;
+    playfield_rules_t rules;
+    playfield_platform_t *platform;
+    // Every game draws its blocks from its own generator, started from a
+    // seed that's kept around so the game can be played out again.
+    rng_t rng;
+    uint32_t seed;
+    // Rotates which way generated pipes face so they don't all look alike.
+    int block_rotation;
+    int upnext_rotation;
+    // Platform time when the current or last game started and ended.
+    uint64_t started;
+    uint64_t ended;
+    // Zobrist hash of every block's pipe and every source's color, kept up
+    // to date by everything in here that changes them.
+    uint64_t zobrist;
+    solve_cache_t *cache;
+    // The hash of the board the colors on it were last worked out for, so
+    // ticks where nothing changed don't have to look at every cell.
+    uint64_t colored;
+    int colored_valid;
+    // Cells changed since the colors were worked out, so the next solve
+    // only has to look at the chains they're part of. Once there's been
+    // more change than there's room for, the whole board gets solved.
+    int *dirty;
+    int dirty_count;
+    int dirty_size;
+    // Every cell that has a color, and where each cell is in there or -1,
+    // so aging only has to look at those.
+    int *active;
+    int *active_at;
+    int active_count;
+    // Scratch space for gathering up chains of pipes. Every chain gets a
+    // label nothing has had before, so nothing needs clearing between them.
+    uint32_t *labels;
+    uint32_t label;
+    int *members_x;
+    int *members_y;
+    int *blocked;
+    // Every lit beam, worked out along with the colors and left alone until
+    // a solve changes them, so nothing has to walk the pipes again to find
+    // out where light runs. Beam cells has every beam's cells one after the
+    // other, and beam at is which beam each cell is part of, or -1.
+    playfield_beam_t *beams;
+    int beam_count;
+    int beam_size;
+    int beam_dead;
+    int *beam_cells;
+    int beam_used;
+    int *beam_at;
+    // Set to solve every board from scratch, for measuring what the cache
+    // saves.
+    int uncached;
+    // Set to work out colors some other way than tracing from every source
+    // on this thread when a board has to be solved from scratch, like with
+    // tiles.h. Has to come up with exactly the same colors.
+    void (*solver)(struct playfield *playfield, void *user);
+    void *solver_user;
+    // How many times connections have been solved, and how many of those
+    // came out of the cache, for diagnostics.
+    unsigned int solves;
+    unsigned int solve_hits;
+} playfield_t;
+
+#define BLOCK_TYPE_NONE 0
+#define BLOCK_TYPE_PURPLE 1
+#define BLOCK_TYPE_ORANGE 2
+#define BLOCK_TYPE_BLUE 3
+#define BLOCK_TYPE_GREEN 4
+#define BLOCK_TYPE_GRAY 5
+
+#define PIPE_CONN_NONE 0
+#define PIPE_CONN_N 0x1
+#define PIPE_CONN_E 0x2
+#define PIPE_CONN_S 0x4
+#define PIPE_CONN_W 0x8
+
+#define CURSOR_ROTATE_LEFT 11
+#define CURSOR_ROTATE_RIGHT 12
+
+#define CURSOR_MOVE_UP 1
+#define CURSOR_MOVE_DOWN 2
+#define CURSOR_MOVE_LEFT 3
+#define CURSOR_MOVE_RIGHT 4
+
+#define SWAP_DIRECTION_HORIZONTAL 21
+#define SWAP_DIRECTION_VERTICAL 22
+
+// The rules the game ships with.
+void playfield_default_rules(playfield_rules_t *rules);
+
+playfield_t *playfield_new(playfield_platform_t *platform, playfield_rules_t *rules, int vertical, int width, int height);
+void playfield_free(playfield_t *playfield);
+playfield_entry_t *playfield_entry(playfield_t *playfield, int x, int y);
+
+// Starting, stopping and checking on a game.
+// Starts a fresh game, with every block it generates coming from seed.
+void playfield_run(playfield_t *playfield, uint32_t seed);
+void playfield_stop(playfield_t *playfield);
+int playfield_running(playfield_t *playfield);
+int playfield_game_over(playfield_t *playfield);
+
+// Player actions.
+void playfield_cursor_move(playfield_t *playfield, int direction);
+void playfield_cursor_drag(playfield_t *playfield, int direction);
+void playfield_cursor_rotate(playfield_t *playfield, int direction);
+void playfield_cursor_swap(playfield_t *playfield, int direction);
+int playfield_cursor_drop(playfield_t *playfield);
+
+// Called once per simulation tick while running.
+void playfield_age(playfield_t *playfield);
+void playfield_decrease_placetime(playfield_t *playfield, float elapsed);
+void playfield_drop_anywhere(playfield_t *playfield);
+
+// Solver, rerun after anything changes the board.
+void playfield_check_connections(playfield_t *playfield);
+void playfield_apply_gravity(playfield_t *playfield);
+
+// Anything outside the engine that writes entries or sources directly has
+// to call this afterwards, or solves will come out of the cache wrong.
+void playfield_rehash(playfield_t *playfield);
+
+// Write one entry the same way the engine does, which keeps everything up
+// to date without a rehash and lets the next solve only look at what
+// changed instead of the whole board.
+void playfield_put_entry(playfield_t *playfield, int x, int y, playfield_entry_t *entry);
+
+// Copy a game in progress into another playfield of the same size, which
+// keeps its own solve cache and solver.
+void playfield_copy(playfield_t *dst, playfield_t *src);
+
+// Which of the playfield's beams the cell at x, y is part of, or -1 if
+// it isn't lit.
+int playfield_beam_at(playfield_t *playfield, int x, int y);
+
+// Diagnostics.
+uint32_t playfield_state_hash(playfield_t *playfield);
+int playfield_occupied(playfield_t *playfield);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "clock.h"
+#include "profiler.h"
+#include "trace.h"
+
+static const char *phase_names[PROFILER_PHASE_COUNT] = {
+    "input",
+    "running",
+    "handling",
+    "age",
+    "connect",
+    "hint",
+    "draw",
+    "vblank",
+};
+
+static struct
+{
+    uint64_t start[PROFILER_PHASE_COUNT];
+    uint32_t current[PROFILER_PHASE_COUNT];
+    uint32_t history[PROFILER_HISTORY][PROFILER_PHASE_COUNT];
+    unsigned int count;
+} profiler;
+
+void profiler_begin(int phase)
+{
+    TRACE_BEGIN(phase_names[phase]);
+    profiler.start[phase] = clock_us();
+}
+
+void profiler_end(int phase)
+{
+    profiler.current[phase] += (uint32_t)(clock_us() - profiler.start[phase]);
+    TRACE_END(phase_names[phase]);
+}
+
+void profiler_frame()
+{
+    memcpy(profiler.history[profiler.count % PROFILER_HISTORY], profiler.current, sizeof(profiler.current));
+    memset(profiler.current, 0, sizeof(profiler.current));
+    profiler.count++;
+}
+
+unsigned int profiler_frames()
+{
+    return profiler.count < PROFILER_HISTORY ? profiler.count : PROFILER_HISTORY;
+}
+
+const char *profiler_phase_name(int phase)
+{
+    return phase_names[phase];
+}
+
+void profiler_current(uint32_t *phases)
+{
+    memcpy(phases, profiler.current, sizeof(profiler.current));
+}
+
+void profiler_stats(int phase, profiler_stats_t *stats)
+{
+    memset(stats, 0, sizeof(profiler_stats_t));
+
+    unsigned int frames = profiler_frames();
+    if (frames == 0)
+    {
+        return;
+    }
+
+    uint64_t total = 0;
+    stats->min = 0xFFFFFFFF;
+    for (unsigned int i = 0; i < frames; i++)
+    {
+        uint32_t time = profiler.history[i][phase];
+        total += time;
+        if (time < stats->min)
+        {
+            stats->min = time;
+        }
+        if (time > stats->max)
+        {
+            stats->max = time;
+        }
+
+        int bucket = 0;
+        while (bucket < (PROFILER_BUCKETS - 1) && time >= ((uint32_t)PROFILER_BUCKET_BASE << bucket))
+        {
+            bucket++;
+        }
+        stats->buckets[bucket]++;
+    }
+    stats->avg = (uint32_t)(total / frames);
+}
+
+void profiler_write_report(FILE *fp)
+{
+    fprintf(fp, "%-10s %8s %8s %8s  histogram (<%dus, doubling)\n", "phase", "min", "avg", "max", PROFILER_BUCKET_BASE);
+    for (int phase = 0; phase < PROFILER_PHASE_COUNT; phase++)
+    {
+        profiler_stats_t stats;
+        profiler_stats(phase, &stats);
+
+        fprintf(fp, "%-10s %8u %8u %8u ", phase_names[phase], stats.min, stats.avg, stats.max);
+        for (int bucket = 0; bucket < PROFILER_BUCKETS; bucket++)
+        {
+            fprintf(fp, " %3u", stats.buckets[bucket]);
+        }
+        fprintf(fp, "\n");
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Per-phase frame profiler. Wrap a phase in PROFILER_BEGIN()/PROFILER_END()
+// and call PROFILER_FRAME() once a frame to roll the frame's totals into the
+// history. Time spent in a phase that runs more than once in a frame is
+// summed. The markers only do anything when built with -DPROFILER, so they
+// cost nothing in release builds. When tracing is also compiled in, every
+// phase shows up in the trace as well.
+#define PROFILER_PHASE_INPUT 0
+#define PROFILER_PHASE_RUNNING 1
+#define PROFILER_PHASE_HANDLING 2
+#define PROFILER_PHASE_AGE 3
+#define PROFILER_PHASE_CONNECTIONS 4
+#define PROFILER_PHASE_HINT 5
+#define PROFILER_PHASE_DRAW 6
+#define PROFILER_PHASE_VBLANK 7
+#define PROFILER_PHASE_COUNT 8
+
+// How many frames of history to keep.
+#define PROFILER_HISTORY 64
+
+// Histogram buckets, each twice as wide as the last starting at
+// PROFILER_BUCKET_BASE us, with the last one catching everything slower.
+#define PROFILER_BUCKETS 8
+#define PROFILER_BUCKET_BASE 64
+
+#ifdef PROFILER
+#define PROFILER_ENABLED 1
+#define PROFILER_BEGIN(phase) profiler_begin(phase)
+#define PROFILER_END(phase) profiler_end(phase)
+#define PROFILER_FRAME() profiler_frame()
+#else
+#define PROFILER_ENABLED 0
+#define PROFILER_BEGIN(phase) do { } while (0)
+#define PROFILER_END(phase) do { } while (0)
+#define PROFILER_FRAME() do { } while (0)
+#endif
+
+typedef struct
+{
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+    uint32_t buckets[PROFILER_BUCKETS];
+} profiler_stats_t;
+
+void profiler_begin(int phase);
+void profiler_end(int phase);
+void profiler_frame();
+
+// How many frames are in the history, which is zero when the markers are
+// compiled out.
+unsigned int profiler_frames();
+
+const char *profiler_phase_name(int phase);
+
+// Copies out the per-phase totals for the frame in progress.
+void profiler_current(uint32_t *phases);
+void profiler_stats(int phase, profiler_stats_t *stats);
+
+// Writes min/avg/max and the histogram for every phase as text.
+void profiler_write_report(FILE *fp);
+
+#endif
@@ -0,0 +1,49 @@
+#include <stdint.h>
+#include "repeat.h"
+
+void repeat_reset(repeat_t *repeat)
+{
+    repeat->armed = 0;
+    repeat->next = 0;
+}
+
+void repeat_press(repeat_t *repeat, uint64_t now)
+{
+    repeat->armed = 1;
+    repeat->next = now + REPEAT_INITIAL_DELAY;
+}
+
+int repeat_update(repeat_t *repeat, unsigned int held, uint64_t now)
+{
+    if (!repeat->armed)
+    {
+        // If we have never pushed this button, don't try repeating
+        // if it happened to be held.
+        return 0;
+    }
+
+    if (held == 0)
+    {
+        // Button isn't held, no repeats.
+        repeat->armed = 0;
+        return 0;
+    }
+
+    if (now < repeat->next)
+    {
+        // Not currently being repeated.
+        return 0;
+    }
+
+    // Schedule off of when the repeat was due rather than when we noticed it,
+    // so the rate doesn't drift with the frame rate. If we fell more than a
+    // whole repeat behind, such as after a long frame, start over from now
+    // instead of firing a burst of catch-up repeats.
+    repeat->next += REPEAT_SUBSEQUENT_DELAY;
+    if (repeat->next <= now)
+    {
+        repeat->next = now + REPEAT_SUBSEQUENT_DELAY;
+    }
+
+    return 1;
+}
@@ -0,0 +1,29 @@
+#ifndef __REPEAT_H
+#define __REPEAT_H
+
+#include <stdint.h>
+
+// A held button will "repeat" itself 30x a second after a 1/2 second hold delay,
+// which at 60Hz is every other frame.
+#define REPEAT_INITIAL_DELAY 500000
+#define REPEAT_SUBSEQUENT_DELAY 33333
+
+// Autorepeat state for one button. Everything is driven off of a monotonic
+// microsecond clock that the caller samples once per frame, so tracking any
+// number of buttons costs no hardware timers.
+typedef struct
+{
+    int armed;
+    uint64_t next;
+} repeat_t;
+
+// Forget any hold in progress, such as when a modifier changes what a button does.
+void repeat_reset(repeat_t *repeat);
+
+// Call on the frame a button is first pressed.
+void repeat_press(repeat_t *repeat, uint64_t now);
+
+// Call on every other frame, returns 1 if the button should repeat this frame.
+int repeat_update(repeat_t *repeat, unsigned int held, uint64_t now);
+
+#endif
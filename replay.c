@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "replay.h"
+
+// Every tick that changed something is stored as how many idle ticks came
+// before it, a byte saying which of the following are present, and then
+// each of those as a varint.
+#define REPLAY_PRESSED 0x1
+#define REPLAY_RELEASED 0x2
+#define REPLAY_HELD 0x4
+#define REPLAY_SKIP 0x8
+
+// Worst case size of one record: the idle count, the flags byte and four
+// five-byte varints.
+#define REPLAY_RECORD_MAX (5 + 1 + (5 * 4))
+
+static void replay_put(replay_t *replay, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        replay->data[replay->length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    replay->data[replay->length++] = value;
+}
+
+static int replay_get(replay_t *replay, unsigned int *pos, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (*pos >= replay->length)
+        {
+            return 0;
+        }
+
+        uint8_t byte = replay->data[(*pos)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void replay_begin(replay_t *replay, uint32_t seed, uint32_t tick_us)
+{
+    replay->seed = seed;
+    replay->tick_us = tick_us;
+    replay->ticks = 0;
+    replay->length = 0;
+    replay->final_hash = 0;
+    replay->final_score = 0;
+    replay->overflowed = 0;
+    replay->recording = 1;
+    replay->last_time = 0;
+    replay->last_held = 0;
+    replay->idle = 0;
+}
+
+void replay_record(replay_t *replay, sim_tick_t *tick)
+{
+    if (!replay->recording)
+    {
+        return;
+    }
+
+    // Ticks are normally evenly spaced, but if the simulation ever had to
+    // skip ahead that changes how held buttons repeat, so keep track of it.
+    if (replay->ticks == 0)
+    {
+        replay->last_time = tick->time - replay->tick_us;
+    }
+    uint32_t skip = (uint32_t)(tick->time - replay->last_time - replay->tick_us);
+    uint32_t held = tick->held ^ replay->last_held;
+    replay->last_time = tick->time;
+    replay->last_held = tick->held;
+    replay->ticks++;
+
+    if (!tick->pressed && !tick->released && !held && !skip)
+    {
+        replay->idle++;
+        return;
+    }
+
+    if (replay->length + REPLAY_RECORD_MAX > REPLAY_MAX_BYTES)
+    {
+        replay->overflowed = 1;
+        replay->recording = 0;
+        return;
+    }
+
+    uint8_t flags = (tick->pressed ? REPLAY_PRESSED : 0) | (tick->released ? REPLAY_RELEASED : 0) | (held ? REPLAY_HELD : 0) | (skip ? REPLAY_SKIP : 0);
+    replay_put(replay, replay->idle);
+    replay->data[replay->length++] = flags;
+    if (flags & REPLAY_PRESSED)
+    {
+        replay_put(replay, tick->pressed);
+    }
+    if (flags & REPLAY_RELEASED)
+    {
+        replay_put(replay, tick->released);
+    }
+    if (flags & REPLAY_HELD)
+    {
+        replay_put(replay, held);
+    }
+    if (flags & REPLAY_SKIP)
+    {
+        replay_put(replay, skip);
+    }
+    replay->idle = 0;
+}
+
+void replay_finish(replay_t *replay, uint32_t final_hash, int final_score)
+{
+    if (!replay->recording)
+    {
+        return;
+    }
+
+    replay->final_hash = final_hash;
+    replay->final_score = final_score;
+    replay->recording = 0;
+}
+
+int replay_valid(replay_t *replay)
+{
+    return !replay->recording && !replay->overflowed && replay->ticks > 0;
+}
+
+int replay_play(replay_t *replay, void (*tick)(sim_tick_t *tick, void *user), void *user)
+{
+    unsigned int pos = 0;
+    uint32_t idle = 0;
+    uint32_t held = 0;
+    uint64_t time = 0;
+    int have_record = replay_get(replay, &pos, &idle);
+
+    for (uint32_t i = 0; i < replay->ticks; i++)
+    {
+        sim_tick_t current;
+        uint32_t skip = 0;
+
+        memset(&current, 0, sizeof(current));
+        if (have_record && idle == 0)
+        {
+            uint32_t value;
+
+            if (pos >= replay->length)
+            {
+                return -1;
+            }
+            uint8_t flags = replay->data[pos++];
+            if ((flags & REPLAY_PRESSED) && !replay_get(replay, &pos, &current.pressed))
+            {
+                return -1;
+            }
+            if ((flags & REPLAY_RELEASED) && !replay_get(replay, &pos, &current.released))
+            {
+                return -1;
+            }
+            if (flags & REPLAY_HELD)
+            {
+                if (!replay_get(replay, &pos, &value))
+                {
+                    return -1;
+                }
+                held ^= value;
+            }
+            if ((flags & REPLAY_SKIP) && !replay_get(replay, &pos, &skip))
+            {
+                return -1;
+            }
+
+            have_record = replay_get(replay, &pos, &idle);
+        }
+        else if (have_record)
+        {
+            idle--;
+        }
+
+        time += replay->tick_us + skip;
+        current.index = i;
+        current.time = time;
+        current.held = held;
+        tick(&current, user);
+    }
+
+    return replay->ticks;
+}
+
+int replay_write(replay_t *replay, FILE *fp)
+{
+    uint32_t header[8] = {
+        REPLAY_MAGIC,
+        REPLAY_VERSION,
+        replay->seed,
+        replay->tick_us,
+        replay->ticks,
+        replay->length,
+        replay->final_hash,
+        (uint32_t)replay->final_score,
+    };
+
+    if (fwrite(header, sizeof(header), 1, fp) != 1)
+    {
+        return 0;
+    }
+    if (replay->length && fwrite(replay->data, replay->length, 1, fp) != 1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+int replay_read(replay_t *replay, FILE *fp)
+{
+    uint32_t header[8];
+
+    if (fread(header, sizeof(header), 1, fp) != 1)
+    {
+        return 0;
+    }
+    if (header[0] != REPLAY_MAGIC || header[1] != REPLAY_VERSION || header[5] > REPLAY_MAX_BYTES)
+    {
+        return 0;
+    }
+
+    memset(replay, 0, offsetof(replay_t, data));
+    replay->seed = header[2];
+    replay->tick_us = header[3];
+    replay->ticks = header[4];
+    replay->length = header[5];
+    replay->final_hash = header[6];
+    replay->final_score = (int32_t)header[7];
+
+    if (replay->length && fread(replay->data, replay->length, 1, fp) != 1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
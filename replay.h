@@ -0,0 +1,64 @@
+#ifndef __REPLAY_H
+#define __REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "sim.h"
+
+// A recording of one game: the seed it was started with and the input for
+// every tick from the one that pressed start to the one where the game
+// ended. Ticks where nothing changed take no space at all, and the rest
+// only store which bits changed, so a whole game fits easily in RAM. Playing
+// one back hands the exact same ticks to a tick function as the simulation
+// did when it was recorded.
+#define REPLAY_MAX_BYTES 65536
+
+#define REPLAY_MAGIC 0x52504C59
+#define REPLAY_VERSION 1
+
+typedef struct
+{
+    uint32_t seed;
+    uint32_t tick_us;
+    uint32_t ticks;
+    uint32_t length;
+
+    // What the game looked like when it ended, so playback can be checked.
+    uint32_t final_hash;
+    int32_t final_score;
+
+    // Set if we ran out of room, in which case the replay is no good.
+    int overflowed;
+
+    // Only used while recording.
+    int recording;
+    uint64_t last_time;
+    uint32_t last_held;
+    uint32_t idle;
+
+    uint8_t data[REPLAY_MAX_BYTES];
+} replay_t;
+
+// Start recording a game that was just started from seed.
+void replay_begin(replay_t *replay, uint32_t seed, uint32_t tick_us);
+
+// Call with every tick of the game, including the one that started it and
+// the one that ended it.
+void replay_record(replay_t *replay, sim_tick_t *tick);
+
+// Stop recording, remembering how the game ended up.
+void replay_finish(replay_t *replay, uint32_t final_hash, int final_score);
+
+// Returns nonzero if this holds a whole game that can be played back.
+int replay_valid(replay_t *replay);
+
+// Feeds every recorded tick to the tick function as fast as possible.
+// Returns the number of ticks played, or -1 if the replay is corrupt.
+int replay_play(replay_t *replay, void (*tick)(sim_tick_t *tick, void *user), void *user);
+
+// Replays can be stored back to back in one file. Read returns zero once
+// there are no more.
+int replay_write(replay_t *replay, FILE *fp);
+int replay_read(replay_t *replay, FILE *fp);
+
+#endif
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include "rng.h"
+
+static uint32_t rotl(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+void rng_seed(rng_t *rng, uint32_t seed)
+{
+    // Spread the seed out with splitmix32 so that nearby seeds don't start
+    // out with nearby states, and so the state is never all zeros.
+    for (int i = 0; i < 4; i++)
+    {
+        seed += 0x9E3779B9;
+        uint32_t z = seed;
+        z = (z ^ (z >> 16)) * 0x85EBCA6B;
+        z = (z ^ (z >> 13)) * 0xC2B2AE35;
+        rng->s[i] = z ^ (z >> 16);
+    }
+}
+
+uint32_t rng_next(rng_t *rng)
+{
+    uint32_t *s = rng->s;
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+
+    return result;
+}
+
+uint32_t rng_range(rng_t *rng, uint32_t range)
+{
+    // Lemire's multiply and shift, rejecting the few low values that would
+    // make some results come up more often than others.
+    uint64_t product = (uint64_t)rng_next(rng) * range;
+    uint32_t low = (uint32_t)product;
+
+    if (low < range)
+    {
+        uint32_t threshold = -range % range;
+        while (low < threshold)
+        {
+            product = (uint64_t)rng_next(rng) * range;
+            low = (uint32_t)product;
+        }
+    }
+
+    return (uint32_t)(product >> 32);
+}
+
+int rng_chance(rng_t *rng, uint32_t numerator, uint32_t denominator)
+{
+    return rng_range(rng, denominator) < numerator;
+}
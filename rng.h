@@ -0,0 +1,27 @@
+#ifndef __RNG_H
+#define __RNG_H
+
+#include <stdint.h>
+
+// Small, fast random number generator (xoshiro128**). Everything is 32 bit
+// integer math so it's cheap on the SH-4, and each owner keeps its own state
+// so the same seed always produces the same sequence no matter what else is
+// drawing random numbers.
+typedef struct
+{
+    uint32_t s[4];
+} rng_t;
+
+// Any seed is fine, including zero.
+void rng_seed(rng_t *rng, uint32_t seed);
+
+// A full 32 bit random number.
+uint32_t rng_next(rng_t *rng);
+
+// A random number from 0 to range - 1, without the bias of a plain modulo.
+uint32_t rng_range(rng_t *rng, uint32_t range);
+
+// Returns 1 numerator out of every denominator calls on average.
+int rng_chance(rng_t *rng, uint32_t numerator, uint32_t denominator);
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdint.h>
+#include <string.h>
+#include "sfx.h"
+
+void sfx_init(sfx_scheduler_t *sfx, int budget, void (*play)(int, float, void *), void (*stop)(int, void *), void *user)
+{
+    memset(sfx, 0, sizeof(sfx_scheduler_t));
+
+    if (budget < 1)
+    {
+        budget = 1;
+    }
+    if (budget > SFX_MAX_VOICES)
+    {
+        budget = SFX_MAX_VOICES;
+    }
+
+    sfx->budget = budget;
+    sfx->play = play;
+    sfx->stop = stop;
+    sfx->user = user;
+
+    for (int i = 0; i < SFX_MAX_VOICES; i++)
+    {
+        sfx->voices[i].sound = -1;
+    }
+}
+
+int sfx_register(sfx_scheduler_t *sfx, int handle, int priority, float volume, uint32_t length_us, uint32_t min_interval_us)
+{
+    if (handle < 0 || sfx->num_sounds >= SFX_MAX_SOUNDS)
+    {
+        return -1;
+    }
+
+    sfx_sound_t *sound = &sfx->sounds[sfx->num_sounds];
+    sound->handle = handle;
+    sound->priority = priority;
+    sound->volume = volume;
+    sound->length_us = length_us;
+    sound->min_interval_us = min_interval_us;
+
+    return sfx->num_sounds++;
+}
+
+void sfx_trigger(sfx_scheduler_t *sfx, int sound)
+{
+    if (sound < 0 || sound >= sfx->num_sounds)
+    {
+        return;
+    }
+
+    sfx->stats.requested++;
+    if (sfx->pending & (1 << sound))
+    {
+        // Already going to play this frame, no reason to stack another copy.
+        sfx->stats.coalesced++;
+        return;
+    }
+
+    sfx->pending |= 1 << sound;
+}
+
+static sfx_voice_t *sfx_find_voice(sfx_scheduler_t *sfx, int priority)
+{
+    sfx_voice_t *victim = 0;
+
+    for (int i = 0; i < sfx->budget; i++)
+    {
+        sfx_voice_t *voice = &sfx->voices[i];
+        if (voice->sound < 0)
+        {
+            return voice;
+        }
+
+        // Only ever steal from something less important, and prefer the
+        // least important, oldest sound since most of it has been heard.
+        if (voice->priority >= priority)
+        {
+            continue;
+        }
+        if (
+            victim == 0 ||
+            voice->priority < victim->priority ||
+            (voice->priority == victim->priority && voice->started < victim->started)
+        )
+        {
+            victim = voice;
+        }
+    }
+
+    if (victim)
+    {
+        if (sfx->stop)
+        {
+            sfx->stop(sfx->sounds[victim->sound].handle, sfx->user);
+        }
+        sfx->stats.stolen++;
+    }
+
+    return victim;
+}
+
+void sfx_flush(sfx_scheduler_t *sfx, uint64_t now)
+{
+    // Free up any voices that have finished playing.
+    for (int i = 0; i < SFX_MAX_VOICES; i++)
+    {
+        if (sfx->voices[i].sound >= 0 && sfx->voices[i].ends <= now)
+        {
+            sfx->voices[i].sound = -1;
+        }
+    }
+
+    // Hand out voices in priority order so a burst of low priority sounds
+    // can't starve out the important ones.
+    while (sfx->pending)
+    {
+        int best = -1;
+        for (int i = 0; i < sfx->num_sounds; i++)
+        {
+            if ((sfx->pending & (1 << i)) && (best < 0 || sfx->sounds[i].priority > sfx->sounds[best].priority))
+            {
+                best = i;
+            }
+        }
+
+        sfx->pending &= ~(1 << best);
+        sfx_sound_t *sound = &sfx->sounds[best];
+
+        if (sfx->ever_started[best] && sound->min_interval_us > 0 && (now - sfx->last_started[best]) < sound->min_interval_us)
+        {
+            sfx->stats.rate_limited++;
+            continue;
+        }
+
+        sfx_voice_t *voice = sfx_find_voice(sfx, sound->priority);
+        if (voice == 0)
+        {
+            sfx->stats.dropped++;
+            continue;
+        }
+
+        voice->sound = best;
+        voice->priority = sound->priority;
+        voice->started = now;
+        voice->ends = now + sound->length_us;
+
+        sfx->last_started[best] = now;
+        sfx->ever_started[best] = 1;
+        sfx->stats.started++;
+
+        sfx->play(sound->handle, sound->volume, sfx->user);
+    }
+}
+
+void sfx_reset_stats(sfx_scheduler_t *sfx)
+{
+    memset(&sfx->stats, 0, sizeof(sfx_stats_t));
+}
@@ -0,0 +1,78 @@
+#ifndef __SFX_H
+#define __SFX_H
+
+#include <stdint.h>
+
+// Per-frame sound effect scheduler. Game code calls sfx_trigger() as often
+// as it likes, and once a frame sfx_flush() decides what actually gets a
+// voice. Identical triggers in one frame collapse into a single voice,
+// repeating sounds are rate limited, and only a fixed number of voices are
+// allowed to be busy at once, with higher priority sounds stealing voices
+// from lower priority ones.
+#define SFX_MAX_SOUNDS 16
+#define SFX_MAX_VOICES 8
+#define SFX_DEFAULT_BUDGET 3
+
+#define SFX_PRIORITY_LOW 0
+#define SFX_PRIORITY_NORMAL 1
+#define SFX_PRIORITY_HIGH 2
+
+typedef struct
+{
+    // Backend handle, for libnaomi this is what audio_register_sound() gave us.
+    int handle;
+    int priority;
+    float volume;
+    // How long a voice playing this sound stays busy.
+    uint32_t length_us;
+    // Minimum time between two starts of this sound, zero for no limit.
+    uint32_t min_interval_us;
+} sfx_sound_t;
+
+typedef struct
+{
+    int sound;
+    int priority;
+    uint64_t started;
+    uint64_t ends;
+} sfx_voice_t;
+
+typedef struct
+{
+    uint32_t requested;
+    uint32_t coalesced;
+    uint32_t rate_limited;
+    uint32_t dropped;
+    uint32_t stolen;
+    uint32_t started;
+} sfx_stats_t;
+
+typedef struct
+{
+    // Start playing a registered sound on the backend.
+    void (*play)(int handle, float volume, void *user);
+    // Optionally cut a sound short when its voice is stolen, may be null.
+    void (*stop)(int handle, void *user);
+    void *user;
+
+    sfx_sound_t sounds[SFX_MAX_SOUNDS];
+    int num_sounds;
+
+    sfx_voice_t voices[SFX_MAX_VOICES];
+    int budget;
+
+    // Bitmask of sounds triggered since the last flush.
+    uint32_t pending;
+    uint64_t last_started[SFX_MAX_SOUNDS];
+    int ever_started[SFX_MAX_SOUNDS];
+
+    sfx_stats_t stats;
+} sfx_scheduler_t;
+
+void sfx_init(sfx_scheduler_t *sfx, int budget, void (*play)(int, float, void *), void (*stop)(int, void *), void *user);
+int sfx_register(sfx_scheduler_t *sfx, int handle, int priority, float volume, uint32_t length_us, uint32_t min_interval_us);
+void sfx_trigger(sfx_scheduler_t *sfx, int sound);
+void sfx_flush(sfx_scheduler_t *sfx, uint64_t now);
+void sfx_reset_stats(sfx_scheduler_t *sfx);
+
+#endif
@@ -0,0 +1,95 @@
+#include <stdint.h>
+#include <string.h>
+#include "sim.h"
+
+void sim_init(sim_t *sim, uint32_t tick_rate, uint64_t now)
+{
+    memset(sim, 0, sizeof(sim_t));
+    sim->tick_us = 1000000 / tick_rate;
+    sim->time = now;
+    sim->last = now;
+}
+
+void sim_queue_events(sim_t *sim, input_event_t *events, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (sim->num_pending >= SIM_PENDING_EVENTS)
+        {
+            sim->dropped_events++;
+            continue;
+        }
+
+        memcpy(&sim->pending[sim->num_pending++], &events[i], sizeof(input_event_t));
+    }
+}
+
+int sim_advance(sim_t *sim, uint64_t now, void (*tick)(sim_tick_t *tick, void *user), void *user)
+{
+    if (now > sim->last)
+    {
+        sim->accumulator += now - sim->last;
+    }
+    sim->last = now;
+
+    int ran = 0;
+    while (sim->accumulator >= sim->tick_us)
+    {
+        if (ran == SIM_MAX_TICKS_PER_FRAME)
+        {
+            // Give up on catching up. Skip simulation time forward so that
+            // whatever input was waiting just lands in the next tick we run.
+            uint64_t skipped = sim->accumulator - (sim->accumulator % sim->tick_us);
+            sim->dropped_time += skipped;
+            sim->time += skipped;
+            sim->accumulator -= skipped;
+            break;
+        }
+
+        sim_tick_t current;
+        memset(&current, 0, sizeof(current));
+        current.index = sim->ticks;
+        current.time = sim->time + sim->tick_us;
+
+        // Everything that happened before the end of this tick belongs to it.
+        unsigned int consumed = 0;
+        while (consumed < sim->num_pending && sim->pending[consumed].timestamp < current.time)
+        {
+            input_event_t *event = &sim->pending[consumed++];
+            if (event->type == INPUT_EVENT_PRESS)
+            {
+                sim->held |= event->button;
+                current.pressed |= event->button;
+                if (current.first_press == 0)
+                {
+                    current.first_press = event->timestamp;
+                }
+            }
+            else
+            {
+                sim->held &= ~event->button;
+                current.released |= event->button;
+            }
+        }
+        if (consumed)
+        {
+            sim->num_pending -= consumed;
+            memmove(sim->pending, sim->pending + consumed, sizeof(input_event_t) * sim->num_pending);
+        }
+        current.held = sim->held;
+
+        tick(&current, user);
+
+        sim->ticks++;
+        sim->time = current.time;
+        sim->accumulator -= sim->tick_us;
+        ran++;
+    }
+
+    return ran;
+}
+
+float sim_alpha(sim_t *sim)
+{
+    return (float)sim->accumulator / (float)sim->tick_us;
+}
@@ -0,0 +1,59 @@
+#ifndef __SIM_H
+#define __SIM_H
+
+#include <stdint.h>
+#include "input.h"
+
+// Fixed timestep driver. The display loop feeds it input events and the
+// current time, and it runs however many whole ticks of game logic have
+// elapsed. Events are handed to the tick their timestamp falls in, so the
+// same input log produces the same ticks no matter what rate frames are
+// drawn at.
+#define SIM_TICK_RATE 60
+
+// Never run more than this many ticks in one frame. If we fall further
+// behind than that, the game slows down rather than spiraling.
+#define SIM_MAX_TICKS_PER_FRAME 8
+
+#define SIM_PENDING_EVENTS (INPUT_QUEUE_SIZE * 2)
+
+typedef struct
+{
+    // Which tick this is, counting from zero.
+    uint64_t index;
+    // Simulation time at the end of this tick.
+    uint64_t time;
+    uint32_t pressed;
+    uint32_t held;
+    uint32_t released;
+    // Timestamp of the first press in this tick, or zero if there wasn't one.
+    uint64_t first_press;
+} sim_tick_t;
+
+typedef struct
+{
+    uint32_t tick_us;
+    uint64_t time;
+    uint64_t ticks;
+    uint64_t accumulator;
+    uint64_t last;
+    uint32_t held;
+
+    input_event_t pending[SIM_PENDING_EVENTS];
+    unsigned int num_pending;
+    uint32_t dropped_events;
+    uint32_t dropped_time;
+} sim_t;
+
+void sim_init(sim_t *sim, uint32_t tick_rate, uint64_t now);
+
+// Queue up input events, which must be in timestamp order.
+void sim_queue_events(sim_t *sim, input_event_t *events, unsigned int count);
+
+// Run every tick that has fully elapsed by now, returns how many ran.
+int sim_advance(sim_t *sim, uint64_t now, void (*tick)(sim_tick_t *tick, void *user), void *user);
+
+// How far we are into the next tick, from 0.0 to 1.0, for interpolating.
+float sim_alpha(sim_t *sim);
+
+#endif
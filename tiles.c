@@ -0,0 +1,463 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tiles.h"
+
+tiles_t *tiles_new(int width, int height, int size)
+{
+    if (size <= 0)
+    {
+        size = TILES_DEFAULT_SIZE;
+    }
+
+    tiles_t *tiles = malloc(sizeof(tiles_t));
+    memset(tiles, 0, sizeof(tiles_t));
+    tiles->width = width;
+    tiles->height = height;
+    tiles->size = size;
+    tiles->across = (width + size - 1) / size;
+    tiles->down = (height + size - 1) / size;
+    tiles->count = tiles->across * tiles->down;
+
+    tiles->tiles = malloc(sizeof(tile_t) * tiles->count);
+    memset(tiles->tiles, 0, sizeof(tile_t) * tiles->count);
+    for (int i = 0; i < tiles->count; i++)
+    {
+        tiles->tiles[i].members = malloc(sizeof(int) * size * size * 2);
+    }
+
+    int cells = width * height;
+    tiles->chain = malloc(sizeof(int) * cells);
+    tiles->parent = malloc(sizeof(int) * cells);
+    tiles->loose = malloc(sizeof(int) * cells);
+    tiles->sourced = malloc(sizeof(int) * cells);
+    tiles->color = malloc(sizeof(uint8_t) * cells);
+    tiles->piped = malloc(sizeof(uint8_t) * cells);
+    tiles->impossible = malloc(sizeof(uint8_t) * cells);
+
+    return tiles;
+}
+
+void tiles_free(tiles_t *tiles)
+{
+    for (int i = 0; i < tiles->count; i++)
+    {
+        free(tiles->tiles[i].crossing);
+        free(tiles->tiles[i].waiting);
+        free(tiles->tiles[i].blocked_from);
+        free(tiles->tiles[i].blocked_to);
+        free(tiles->tiles[i].members);
+    }
+    free(tiles->tiles);
+    free(tiles->chain);
+    free(tiles->parent);
+    free(tiles->loose);
+    free(tiles->sourced);
+    free(tiles->color);
+    free(tiles->piped);
+    free(tiles->impossible);
+    free(tiles);
+}
+
+static void tiles_push_crossing(tile_t *tile, int id)
+{
+    if (tile->crossing_count == tile->crossing_size)
+    {
+        tile->crossing_size = tile->crossing_size ? tile->crossing_size * 2 : 64;
+        tile->crossing = realloc(tile->crossing, sizeof(int) * tile->crossing_size);
+    }
+    tile->crossing[tile->crossing_count++] = id;
+}
+
+static void tiles_push_waiting(tile_t *tile, int cell)
+{
+    if (tile->waiting_count == tile->waiting_size)
+    {
+        tile->waiting_size = tile->waiting_size ? tile->waiting_size * 2 : 256;
+        tile->waiting = realloc(tile->waiting, sizeof(int) * tile->waiting_size);
+    }
+    tile->waiting[tile->waiting_count++] = cell;
+}
+
+static void tiles_push_blocked(tile_t *tile, int from, int to)
+{
+    if (tile->blocked_count == tile->blocked_size)
+    {
+        tile->blocked_size = tile->blocked_size ? tile->blocked_size * 2 : 64;
+        tile->blocked_from = realloc(tile->blocked_from, sizeof(int) * tile->blocked_size);
+        tile->blocked_to = realloc(tile->blocked_to, sizeof(int) * tile->blocked_size);
+    }
+    tile->blocked_from[tile->blocked_count] = from;
+    tile->blocked_to[tile->blocked_count] = to;
+    tile->blocked_count++;
+}
+
+static unsigned int tiles_combine(unsigned int color, unsigned int end)
+{
+    // Same as playfield_combine_color(). A chain only ever has two ends, so
+    // the order these get merged in doesn't matter.
+    if (color == SOURCE_COLOR_IMPOSSIBLE || end == SOURCE_COLOR_IMPOSSIBLE)
+    {
+        return SOURCE_COLOR_IMPOSSIBLE;
+    }
+    if (color == SOURCE_COLOR_NONE || (color & end) == end)
+    {
+        return end == SOURCE_COLOR_NONE ? color : end;
+    }
+    if ((color & end) == color)
+    {
+        return color;
+    }
+    return SOURCE_COLOR_IMPOSSIBLE;
+}
+
+static unsigned int tiles_final(tiles_t *tiles, playfield_t *playfield, int id)
+{
+    // Lit if every loose end runs into a source and they all agree, and
+    // impossible if it loops, dead ends into itself or can never agree.
+    unsigned int color = tiles->color[id];
+    if (tiles->impossible[id] || (tiles->loose[id] == 0 && tiles->piped[id]))
+    {
+        color = SOURCE_COLOR_IMPOSSIBLE;
+    }
+    else if (color != SOURCE_COLOR_IMPOSSIBLE && (tiles->loose[id] == 0 || tiles->sourced[id] != tiles->loose[id]))
+    {
+        color = SOURCE_COLOR_NONE;
+    }
+
+    if (color == SOURCE_COLOR_IMPOSSIBLE && !playfield->rules.placing)
+    {
+        // Nothing to place, so nothing's ever impossible.
+        color = SOURCE_COLOR_NONE;
+    }
+    return color;
+}
+
+void tiles_gather(tiles_t *tiles, playfield_t *playfield, int which)
+{
+    static const int dx[4] = { 0, 1, 0, -1 };
+    static const int dy[4] = { -1, 0, 1, 0 };
+
+    tile_t *tile = tiles->tiles + which;
+    int width = tiles->width;
+    int height = tiles->height;
+    int left = (which % tiles->across) * tiles->size;
+    int top = (which / tiles->across) * tiles->size;
+    int right = left + tiles->size < width ? left + tiles->size : width;
+    int bottom = top + tiles->size < height ? top + tiles->size : height;
+    int *members_x = tile->members;
+    int *members_y = tile->members + (tiles->size * tiles->size);
+    playfield_entry_t *entries = playfield->entries;
+
+    tile->crossing_count = 0;
+    tile->waiting_count = 0;
+    tile->blocked_count = 0;
+    for (int y = top; y < bottom; y++)
+    {
+        for (int x = left; x < right; x++)
+        {
+            tiles->chain[x + (y * width)] = -1;
+        }
+    }
+
+    for (int y = top; y < bottom; y++)
+    {
+        for (int x = left; x < right; x++)
+        {
+            int id = x + (y * width);
+            if (entries[id].block == BLOCK_TYPE_NONE)
+            {
+                entries[id].color = SOURCE_COLOR_NONE;
+                continue;
+            }
+            if (tiles->chain[id] >= 0)
+            {
+                continue;
+            }
+
+            // Gather up every block in this tile that connects to this one,
+            // counting up how it ends and where it leaves the tile.
+            unsigned int color = SOURCE_COLOR_NONE;
+            int loose = 0;
+            int sourced = 0;
+            int crosses = 0;
+            int piped = 0;
+            int impossible = 0;
+            int blocked = tile->blocked_count;
+            int count = 0;
+            tiles->chain[id] = id;
+            members_x[count] = x;
+            members_y[count] = y;
+            count++;
+            for (int i = 0; i < count; i++)
+            {
+                int cx = members_x[i];
+                int cy = members_y[i];
+                unsigned int pipe = entries[cx + (cy * width)].pipe;
+                piped |= pipe != PIPE_CONN_NONE;
+                for (int d = 0; d < 4; d++)
+                {
+                    if ((pipe & (1 << d)) == 0)
+                    {
+                        continue;
+                    }
+
+                    int nx = cx + dx[d];
+                    int ny = cy + dy[d];
+                    if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+                    {
+                        // Runs off the edge, which had better be into a source.
+                        unsigned int source;
+                        if (nx < 0)
+                        {
+                            source = playfield->sources[cy].color;
+                        }
+                        else if (nx >= width)
+                        {
+                            source = playfield->sources[height + cy].color;
+                        }
+                        else if (ny >= height)
+                        {
+                            source = playfield->sources[(2 * height) + cx].color;
+                        }
+                        else
+                        {
+                            source = playfield->sources[(2 * height) + width + cx].color;
+                        }
+
+                        loose++;
+                        sourced += source != SOURCE_COLOR_NONE;
+                        color = tiles_combine(color, source ? source : SOURCE_COLOR_IMPOSSIBLE);
+                        continue;
+                    }
+
+                    int next = nx + (ny * width);
+                    if (entries[next].block != BLOCK_TYPE_NONE && (entries[next].pipe & (1 << ((d + 2) % 4))) != 0)
+                    {
+                        // Connected, so this isn't an end at all, just maybe
+                        // not one we can follow from here.
+                        if (nx < left || nx >= right || ny < top || ny >= bottom)
+                        {
+                            crosses++;
+                        }
+                        else if (tiles->chain[next] < 0)
+                        {
+                            tiles->chain[next] = id;
+                            members_x[count] = nx;
+                            members_y[count] = ny;
+                            count++;
+                        }
+                        continue;
+                    }
+
+                    loose++;
+                    if (entries[next].block != BLOCK_TYPE_NONE)
+                    {
+                        tiles_push_blocked(tile, id, next);
+                    }
+                }
+            }
+
+            // Anything in this tile that a loose end ran into is finished
+            // being gathered, so we know if it's part of this chain.
+            // Anything outside of it belongs to another thread for now.
+            for (int i = blocked; i < tile->blocked_count; i++)
+            {
+                int to = tile->blocked_to[i];
+                int tx = to % width;
+                int ty = to / width;
+                if (tx >= left && tx < right && ty >= top && ty < bottom && tiles->chain[to] == id)
+                {
+                    impossible = 1;
+                }
+            }
+
+            tiles->loose[id] = loose;
+            tiles->sourced[id] = sourced;
+            tiles->color[id] = color;
+            tiles->piped[id] = piped;
+            tiles->impossible[id] = impossible;
+
+            if (crosses)
+            {
+                // The rest of it's in other tiles, so it has to wait.
+                tiles->parent[id] = id;
+                tiles_push_crossing(tile, id);
+                for (int i = 0; i < count; i++)
+                {
+                    tiles_push_waiting(tile, members_x[i] + (members_y[i] * width));
+                }
+                continue;
+            }
+
+            // All of it's right here, and nothing it ran into can be part
+            // of it unless it's in here too.
+            tiles->parent[id] = -1;
+            tile->blocked_count = blocked;
+            unsigned int final = tiles_final(tiles, playfield, id);
+            for (int i = 0; i < count; i++)
+            {
+                entries[members_x[i] + (members_y[i] * width)].color = final;
+            }
+        }
+    }
+}
+
+static int tiles_find(tiles_t *tiles, int id)
+{
+    while (tiles->parent[id] != id)
+    {
+        tiles->parent[id] = tiles->parent[tiles->parent[id]];
+        id = tiles->parent[id];
+    }
+    return id;
+}
+
+static void tiles_union(tiles_t *tiles, int first, int second)
+{
+    first = tiles_find(tiles, first);
+    second = tiles_find(tiles, second);
+    if (first < second)
+    {
+        tiles->parent[second] = first;
+    }
+    else if (second < first)
+    {
+        tiles->parent[first] = second;
+    }
+}
+
+void tiles_join(tiles_t *tiles, playfield_t *playfield)
+{
+    int width = tiles->width;
+    int height = tiles->height;
+    playfield_entry_t *entries = playfield->entries;
+
+    // Join up pipes that connect across the right and bottom edge of every
+    // tile, which gets every edge between two tiles once.
+    for (int which = 0; which < tiles->count; which++)
+    {
+        int left = (which % tiles->across) * tiles->size;
+        int top = (which / tiles->across) * tiles->size;
+        int right = left + tiles->size < width ? left + tiles->size : width;
+        int bottom = top + tiles->size < height ? top + tiles->size : height;
+
+        if (right < width)
+        {
+            for (int y = top; y < bottom; y++)
+            {
+                int cell = (right - 1) + (y * width);
+                if (entries[cell].block != BLOCK_TYPE_NONE && (entries[cell].pipe & PIPE_CONN_E) != 0 &&
+                    entries[cell + 1].block != BLOCK_TYPE_NONE && (entries[cell + 1].pipe & PIPE_CONN_W) != 0)
+                {
+                    tiles_union(tiles, tiles->chain[cell], tiles->chain[cell + 1]);
+                }
+            }
+        }
+        if (bottom < height)
+        {
+            for (int x = left; x < right; x++)
+            {
+                int cell = x + ((bottom - 1) * width);
+                if (entries[cell].block != BLOCK_TYPE_NONE && (entries[cell].pipe & PIPE_CONN_S) != 0 &&
+                    entries[cell + width].block != BLOCK_TYPE_NONE && (entries[cell + width].pipe & PIPE_CONN_N) != 0)
+                {
+                    tiles_union(tiles, tiles->chain[cell], tiles->chain[cell + width]);
+                }
+            }
+        }
+    }
+
+    // Add every piece's ends onto the whole chain it's part of.
+    for (int which = 0; which < tiles->count; which++)
+    {
+        tile_t *tile = tiles->tiles + which;
+        for (int i = 0; i < tile->crossing_count; i++)
+        {
+            int id = tile->crossing[i];
+            int root = tiles_find(tiles, id);
+            if (root != id)
+            {
+                tiles->loose[root] += tiles->loose[id];
+                tiles->sourced[root] += tiles->sourced[id];
+                tiles->color[root] = tiles_combine(tiles->color[root], tiles->color[id]);
+                tiles->piped[root] |= tiles->piped[id];
+                tiles->impossible[root] |= tiles->impossible[id];
+            }
+        }
+    }
+
+    // Now that chains are whole, see which ones dead end into themselves.
+    for (int which = 0; which < tiles->count; which++)
+    {
+        tile_t *tile = tiles->tiles + which;
+        for (int i = 0; i < tile->blocked_count; i++)
+        {
+            int to = tiles->chain[tile->blocked_to[i]];
+            if (tiles->parent[to] >= 0)
+            {
+                int root = tiles_find(tiles, tile->blocked_from[i]);
+                if (tiles_find(tiles, to) == root)
+                {
+                    tiles->impossible[root] = 1;
+                }
+            }
+        }
+    }
+
+    // Work out every whole chain's color, then hand it to every piece so
+    // coloring doesn't need to look anything up.
+    for (int which = 0; which < tiles->count; which++)
+    {
+        tile_t *tile = tiles->tiles + which;
+        for (int i = 0; i < tile->crossing_count; i++)
+        {
+            int id = tile->crossing[i];
+            if (tiles_find(tiles, id) == id)
+            {
+                tiles->color[id] = tiles_final(tiles, playfield, id);
+            }
+        }
+    }
+    for (int which = 0; which < tiles->count; which++)
+    {
+        tile_t *tile = tiles->tiles + which;
+        for (int i = 0; i < tile->crossing_count; i++)
+        {
+            int id = tile->crossing[i];
+            int root = tiles_find(tiles, id);
+            if (root != id)
+            {
+                tiles->color[id] = tiles->color[root];
+            }
+        }
+    }
+}
+
+void tiles_color(tiles_t *tiles, playfield_t *playfield, int which)
+{
+    // Everything that stayed inside the tile got colored while gathering.
+    tile_t *tile = tiles->tiles + which;
+    for (int i = 0; i < tile->waiting_count; i++)
+    {
+        int cell = tile->waiting[i];
+        playfield->entries[cell].color = tiles->color[tiles->chain[cell]];
+    }
+}
+
+void tiles_solve(tiles_t *tiles, playfield_t *playfield)
+{
+    for (int which = 0; which < tiles->count; which++)
+    {
+        tiles_gather(tiles, playfield, which);
+    }
+    tiles_join(tiles, playfield);
+    for (int which = 0; which < tiles->count; which++)
+    {
+        tiles_color(tiles, playfield, which);
+    }
+}
+
+void tiles_solver(playfield_t *playfield, void *user)
+{
+    tiles_solve((tiles_t *)user, playfield);
+}
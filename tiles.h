@@ -0,0 +1,94 @@
+#ifndef __TILES_H
+#define __TILES_H
+
+#include <stdint.h>
+#include "playfield.h"
+
+// Solves connections on huge boards by splitting them into square tiles
+// that can be worked on by different threads at the same time. Every tile
+// gathers up the chains inside of it on its own. Chains that stay inside a
+// tile get their colors right there, and the ones that cross a tile's edge
+// get joined up with the rest of themselves afterwards on one thread, which
+// is only as much work as there are chains along tile edges. Gives exactly
+// the colors playfield_check_connections() would, for boards where every
+// block is a pipe with two ends like the game makes.
+//
+// The engine doesn't know anything about threads, so solving happens in
+// three steps and whoever owns the threads runs them:
+//
+//  tiles_gather() for every tile, on any threads, all at the same time
+//  tiles_join() once, on one thread, after every tile's been gathered
+//  tiles_color() for every tile, on any threads, all at the same time
+//
+// Or tiles_solve() does all three on the calling thread.
+
+// Tiles this big keep everything a thread touches in cache on most hosts,
+// and leave few enough chains along their edges that joining them is
+// quick.
+#define TILES_DEFAULT_SIZE 64
+
+typedef struct
+{
+    // Chains in this tile that cross its edge, by id, and every cell in
+    // them, which get colored once the chains are joined up.
+    int *crossing;
+    int crossing_count;
+    int crossing_size;
+    int *waiting;
+    int waiting_count;
+    int waiting_size;
+
+    // Cells that loose ends of crossing chains run into without
+    // connecting, and which chain each came from. Whether they're the same
+    // chain is only known once they've been joined up.
+    int *blocked_from;
+    int *blocked_to;
+    int blocked_count;
+    int blocked_size;
+
+    // Scratch space for gathering chains.
+    int *members;
+} tile_t;
+
+typedef struct
+{
+    int width;
+    int height;
+    int size;
+    int across;
+    int down;
+    int count;
+    tile_t *tiles;
+
+    // Which chain every cell is in, or -1 for empty cells. A chain's id is
+    // the first cell in it that got gathered, so ids never need handing out.
+    int *chain;
+
+    // Indexed by chain id. Everything about a chain that its color depends
+    // on, added up across every tile it's in once it's joined. Parent is
+    // where to look next to find the chain a crossing chain got joined into,
+    // and -1 for chains that stay inside one tile.
+    int *parent;
+    int *loose;
+    int *sourced;
+    uint8_t *color;
+    uint8_t *piped;
+    uint8_t *impossible;
+} tiles_t;
+
+// Set up tiles for boards of the given size, or size 0 for the default.
+tiles_t *tiles_new(int width, int height, int size);
+void tiles_free(tiles_t *tiles);
+
+void tiles_gather(tiles_t *tiles, playfield_t *playfield, int tile);
+void tiles_join(tiles_t *tiles, playfield_t *playfield);
+void tiles_color(tiles_t *tiles, playfield_t *playfield, int tile);
+
+// All three of the above, one after another.
+void tiles_solve(tiles_t *tiles, playfield_t *playfield);
+
+// Matches playfield_t's solver, with user being a tiles_t of the same
+// size as the playfield, so it can be used there directly.
+void tiles_solver(playfield_t *playfield, void *user);
+
+#endif
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <naomi/thread.h>
+#include "clock.h"
+#include "trace.h"
+
+static trace_event_t events[TRACE_EVENTS];
+static uint32_t next_event;
+
+void trace_event(const char *name, int type)
+{
+    // Every writer claims its own slot, so nobody has to take a lock, and the
+    // timestamp comes from peeking at the clock so that doesn't either. The
+    // sequence is cleared while we fill the slot in and published last, so a
+    // reader can tell a finished event from a half written one.
+    uint32_t index = __atomic_fetch_add(&next_event, 1, __ATOMIC_RELAXED);
+    trace_event_t *event = &events[index % TRACE_EVENTS];
+
+    __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->timestamp = clock_peek();
+    event->thread = thread_id();
+    event->type = type;
+    event->name = name;
+    __atomic_store_n(&event->sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+void trace_write_json(FILE *fp)
+{
+    uint32_t end = __atomic_load_n(&next_event, __ATOMIC_ACQUIRE);
+    uint32_t start = end > TRACE_EVENTS ? end - TRACE_EVENTS : 0;
+    int first = 1;
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (uint32_t index = start; index < end; index++)
+    {
+        trace_event_t *slot = &events[index % TRACE_EVENTS];
+        trace_event_t event;
+
+        // Copy the event out, and skip it if it was being written or got
+        // overwritten while we were looking at it.
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != index + 1)
+        {
+            continue;
+        }
+        memcpy(&event, slot, sizeof(trace_event_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != index + 1)
+        {
+            continue;
+        }
+
+        fprintf(
+            fp,
+            "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u}",
+            first ? "" : ",\n",
+            event.name,
+            (char)event.type,
+            (unsigned long long)event.timestamp,
+            event.thread
+        );
+        first = 0;
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
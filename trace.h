@@ -0,0 +1,42 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Records begin/end events from any thread into a fixed-size ring, which can
+// be written out as Chrome trace JSON to look at individual frames in a trace
+// viewer. Once the ring wraps, the oldest events are overwritten. Like the
+// profiler markers, TRACE_BEGIN()/TRACE_END() only do anything when built
+// with -DTRACE. Names must be string constants, only the pointer is kept.
+#define TRACE_EVENTS 32768
+
+#define TRACE_TYPE_BEGIN 'B'
+#define TRACE_TYPE_END 'E'
+
+#ifdef TRACE
+#define TRACE_ENABLED 1
+#define TRACE_BEGIN(name) trace_event(name, TRACE_TYPE_BEGIN)
+#define TRACE_END(name) trace_event(name, TRACE_TYPE_END)
+#else
+#define TRACE_ENABLED 0
+#define TRACE_BEGIN(name) do { } while (0)
+#define TRACE_END(name) do { } while (0)
+#endif
+
+typedef struct
+{
+    // Which event this slot holds plus one, or zero while it is being written.
+    uint32_t sequence;
+    uint32_t thread;
+    uint32_t type;
+    const char *name;
+    uint64_t timestamp;
+} trace_event_t;
+
+void trace_event(const char *name, int type);
+
+// Writes everything still in the ring as a Chrome trace JSON object.
+void trace_write_json(FILE *fp);
+
+#endif
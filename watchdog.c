@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "watchdog.h"
+
+#define WATCHDOG_MAGIC 0x57444F47
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t budget;
+    uint32_t count;
+    watchdog_snapshot_t snapshots[WATCHDOG_SNAPSHOTS];
+    uint32_t checksum;
+} watchdog_log_t;
+
+// Lives in the .noinit section noinit.ld adds, outside of .bss so startup
+// doesn't zero it, and outside of the binary so loading it doesn't either.
+static watchdog_log_t watchdog __attribute__((section(".noinit")));
+
+static uint32_t watchdog_checksum()
+{
+    // FNV-1a over everything but the checksum itself.
+    const uint8_t *data = (const uint8_t *)&watchdog;
+    uint32_t hash = 2166136261U;
+
+    for (unsigned int i = 0; i < offsetof(watchdog_log_t, checksum); i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+static void watchdog_seal()
+{
+    watchdog.checksum = watchdog_checksum();
+}
+
+void watchdog_init()
+{
+    if (watchdog.magic == WATCHDOG_MAGIC && watchdog.checksum == watchdog_checksum())
+    {
+        return;
+    }
+
+    memset(&watchdog, 0, sizeof(watchdog));
+    watchdog.magic = WATCHDOG_MAGIC;
+    watchdog.budget = WATCHDOG_DEFAULT_BUDGET;
+    watchdog_seal();
+}
+
+uint32_t watchdog_budget()
+{
+    return watchdog.budget;
+}
+
+void watchdog_set_budget(uint32_t budget)
+{
+    watchdog.budget = budget;
+    watchdog_seal();
+}
+
+int watchdog_over_budget(uint32_t uspf)
+{
+    return uspf > watchdog.budget;
+}
+
+void watchdog_record(watchdog_snapshot_t *snapshot)
+{
+    memcpy(&watchdog.snapshots[watchdog.count % WATCHDOG_SNAPSHOTS], snapshot, sizeof(watchdog_snapshot_t));
+    watchdog.count++;
+    watchdog_seal();
+}
+
+void watchdog_clear()
+{
+    uint32_t budget = watchdog.budget;
+
+    memset(&watchdog, 0, sizeof(watchdog));
+    watchdog.magic = WATCHDOG_MAGIC;
+    watchdog.budget = budget;
+    watchdog_seal();
+}
+
+unsigned int watchdog_count()
+{
+    return watchdog.count < WATCHDOG_SNAPSHOTS ? watchdog.count : WATCHDOG_SNAPSHOTS;
+}
+
+void watchdog_snapshot(unsigned int which, watchdog_snapshot_t *snapshot)
+{
+    unsigned int index = (watchdog.count - 1 - which) % WATCHDOG_SNAPSHOTS;
+    memcpy(snapshot, &watchdog.snapshots[index], sizeof(watchdog_snapshot_t));
+}
+
+void watchdog_write_log(FILE *fp)
+{
+    fprintf(fp, "frame,uspf,budget");
+    for (int phase = 0; phase < PROFILER_PHASE_COUNT; phase++)
+    {
+        fprintf(fp, ",%s_us", profiler_phase_name(phase));
+    }
+    fprintf(fp, ",occupied,cells,solves,ticks\n");
+
+    for (int which = watchdog_count() - 1; which >= 0; which--)
+    {
+        watchdog_snapshot_t snapshot;
+        watchdog_snapshot(which, &snapshot);
+
+        fprintf(fp, "%u,%u,%u", snapshot.frame, snapshot.uspf, snapshot.budget);
+        for (int phase = 0; phase < PROFILER_PHASE_COUNT; phase++)
+        {
+            fprintf(fp, ",%u", snapshot.phases[phase]);
+        }
+        fprintf(fp, ",%u,%u,%u,%u\n", snapshot.occupied, snapshot.cells, snapshot.solves, snapshot.ticks);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __WATCHDOG_H
+#define __WATCHDOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "profiler.h"
+
+// Frame budget watchdog. Whenever a frame takes longer than the budget, the
+// main loop records a snapshot of what was going on in that frame. The most
+// recent WATCHDOG_SNAPSHOTS are kept in memory that isn't cleared on startup,
+// so that they can still be looked at from the test menu after leaving the
+// game. The log is checksummed and thrown away if it doesn't survive intact.
+// The default budget is a bit over one 60hz frame, since every frame includes
+// waiting for vblank and a frame that makes it in time still jitters a bit.
+#define WATCHDOG_DEFAULT_BUDGET 17500
+#define WATCHDOG_SNAPSHOTS 16
+
+typedef struct
+{
+    // Which frame this was since the game started.
+    uint32_t frame;
+    uint32_t uspf;
+    uint32_t budget;
+    // Per-phase timings, all zero if the profiler isn't compiled in.
+    uint32_t phases[PROFILER_PHASE_COUNT];
+    // How many playfield cells had a block in them, out of how many.
+    uint32_t occupied;
+    uint32_t cells;
+    // How many times connections were solved this frame.
+    uint32_t solves;
+    // How many simulation ticks ran this frame.
+    uint16_t ticks;
+} watchdog_snapshot_t;
+
+// Picks up a log that survived from before, or starts a fresh one.
+void watchdog_init();
+
+uint32_t watchdog_budget();
+void watchdog_set_budget(uint32_t budget);
+
+// Returns nonzero if a frame that took uspf should be recorded.
+int watchdog_over_budget(uint32_t uspf);
+
+void watchdog_record(watchdog_snapshot_t *snapshot);
+void watchdog_clear();
+
+// How many snapshots are kept, and fetch one with zero being the newest.
+unsigned int watchdog_count();
+void watchdog_snapshot(unsigned int which, watchdog_snapshot_t *snapshot);
+
+// Writes all kept snapshots as CSV, oldest first.
+void watchdog_write_log(FILE *fp);
+
+#endif